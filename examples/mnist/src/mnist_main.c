@@ -6,14 +6,73 @@
 #include <mlframework/network.h>
 #include <mlframework/base_defs.h>
 #include <mlframework/mg_arena.h>
+#include <mlframework/os.h>
+
+// Training images used to calibrate the int8 network in quant-bench
+#define QUANT_CALIBRATION_SIZE 1000
 
 void print_usage() {
     printf("Usage:\n");
     printf("  MLFramework train <layout.tsl> <data_dir> <train_desc.tsd>\n");
     printf("  MLFramework infer <model.tsn> <input_file>\n");
+    printf("  MLFramework quant-bench <model.tsn> <data_dir>\n");
     printf("  MLFramework snake [train|play] <model_path?>\n");
 }
 
+// Runs every test image through the network, returns the total time in microseconds.
+// Quantized runs int8 layers with network_feedforward_quantized
+u64 evaluate_network(
+    mg_arena* arena, const network* nn, b32 quantized,
+    const tensor* inputs, const tensor* labels, f32* accuracy
+) {
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    tensor* out = tensor_create_uninit(scratch.arena, (tensor_shape){ labels->shape.width, labels->shape.height, 1 });
+
+    tensor input = { 0 };
+    tensor label = { 0 };
+    u32 num_correct = 0;
+
+    u64 start = now_usec();
+    for (u32 i = 0; i < inputs->shape.depth; i++) {
+        tensor_2d_view(&input, inputs, i);
+        tensor_2d_view(&label, labels, i);
+
+        if (quantized) {
+            network_feedforward_quantized(nn, out, &input);
+        } else {
+            network_feedforward(nn, out, &input);
+        }
+
+        tensor_index out_index = tensor_argmax(out);
+        tensor_index label_index = tensor_argmax(&label);
+        num_correct += out_index.x == label_index.x && out_index.y == label_index.y;
+    }
+    u64 elapsed = now_usec() - start;
+
+    mga_scratch_release(scratch);
+
+    *accuracy = (f32)num_correct / (f32)inputs->shape.depth;
+    return elapsed;
+}
+
+// Layers of `nn` that network_feedforward_quantized runs with int8 arithmetic
+u32 count_quantized_layers(const network* nn) {
+    u32 count = 0;
+
+    for (u32 i = 0; i < nn->num_layers; i++) {
+        const layer* l = nn->layers[i];
+
+        if (l->type == LAYER_DENSE) {
+            count += l->dense_backend.quant_weight != NULL;
+        } else if (l->type == LAYER_CONV_2D) {
+            count += l->conv_2d_backend.quant_kernels != NULL;
+        }
+    }
+
+    return count;
+}
+
 // Forward declare snake main
 int snake_main(int argc, char** argv);
 
@@ -120,6 +179,64 @@ int main(int argc, char** argv) {
         // Or specific input format?
          // For simplicity, let's just make a dummy input or load one from file
          printf("Inference on %s not fully implemented for generic files yet.\n", input_file);
+    } else if (strcmp(command, "quant-bench") == 0) {
+        if (argc < 4) {
+             printf("Error: Missing arguments for quant-bench.\n");
+             print_usage();
+             return 1;
+        }
+        char* model_file = argv[2];
+        char* data_dir = argv[3];
+
+        time_init();
+
+        string8 model_path = str8_from_cstr((u8*)model_file);
+        string8 train_img_path = str8_pushf(arena, "%s/train_images.mat", data_dir);
+        string8 test_img_path = str8_pushf(arena, "%s/test_images.mat", data_dir);
+        string8 test_lbl_path = str8_pushf(arena, "%s/test_labels.mat", data_dir);
+
+        tensor* calibration_inputs = tensor_load_mnist_images(arena, train_img_path, QUANT_CALIBRATION_SIZE);
+        tensor* test_inputs = tensor_load_mnist_images(arena, test_img_path, 10000);
+        tensor* test_outputs = tensor_load_mnist_labels(arena, test_lbl_path, 10000);
+
+        if (!calibration_inputs || !test_inputs || !test_outputs) {
+            printf("Failed to load data.\n");
+            return 1;
+        }
+
+        printf("Loading model from %s...\n", model_file);
+        network* nn = network_load(arena, model_path, false);
+        network* nn_quant = network_load_quantized(arena, model_path, (string8){ 0 }, calibration_inputs);
+        if (!nn || !nn_quant) {
+             printf("Failed to load model.\n");
+             return 1;
+        }
+
+        // Without quantized layers both runs take the f32 path, and the comparison means nothing
+        u32 num_quantized = count_quantized_layers(nn_quant);
+        if (num_quantized == 0) {
+            printf("int8 path unavailable: no dense or convolutional layer was quantized.\n");
+            return 1;
+        }
+        printf("%u of %u layers run in int8\n", num_quantized, nn_quant->num_layers);
+
+        f32 accuracy = 0.0f;
+        f32 quant_accuracy = 0.0f;
+        u64 usec = evaluate_network(arena, nn, false, test_inputs, test_outputs, &accuracy);
+        u64 quant_usec = evaluate_network(arena, nn_quant, true, test_inputs, test_outputs, &quant_accuracy);
+
+        f64 num_images = (f64)test_inputs->shape.depth;
+        printf("f32:  %8.2f us/image, top-1 %6.2f%%\n", (f64)usec / num_images, accuracy * 100.0f);
+        printf("int8: %8.2f us/image, top-1 %6.2f%%\n", (f64)quant_usec / num_images, quant_accuracy * 100.0f);
+        printf(
+            "delta: %.2fx speedup, %+.2f%% top-1\n",
+            (f64)usec / (f64)MAX(quant_usec, 1), (quant_accuracy - accuracy) * 100.0f
+        );
+
+        // Only the int8 weights, load them next to the model with network_load_quantized
+        string8 quant_path = str8_pushf(arena, "%.*s_int8.tst", (int)(model_path.size >= 4 ? model_path.size - 4 : model_path.size), model_path.str);
+        network_quant_save(nn_quant, quant_path);
+        printf("Saved int8 weights to %.*s\n", (int)quant_path.size, quant_path.str);
     } else if (strcmp(command, "snake") == 0) {
         return snake_main(argc, argv);
     } else {
@@ -79,7 +79,7 @@ int snake_agent_act(SnakeAgent* agent, SnakeState* state, tensor* state_tensor)
     
     // Predict
     mga_temp scratch = mga_scratch_get(NULL, 0);
-    tensor* out = tensor_create(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
+    tensor* out = tensor_create_uninit(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
     network_feedforward(agent->net, out, state_tensor);
     
     tensor_index argmax = tensor_argmax(out);
@@ -112,19 +112,17 @@ void snake_agent_train(SnakeAgent* agent) {
     mga_temp scratch = mga_scratch_get(NULL, 0);
     
     // Create temp tensors for single item processing
-    tensor* state_t = tensor_create(scratch.arena, (tensor_shape){ STATE_SIZE, 1, 1 });
-    tensor* next_state_t = tensor_create(scratch.arena, (tensor_shape){ STATE_SIZE, 1, 1 });
-    tensor* q_eval = tensor_create(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
-    tensor* q_next = tensor_create(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
-    
-    // Target tensor
-    tensor* q_target = tensor_create(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
+    // Each one is fully overwritten before it is read
+    tensor* state_t = tensor_create_uninit(scratch.arena, (tensor_shape){ STATE_SIZE, 1, 1 });
+    tensor* next_state_t = tensor_create_uninit(scratch.arena, (tensor_shape){ STATE_SIZE, 1, 1 });
+    tensor* q_eval = tensor_create_uninit(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
+    tensor* q_next = tensor_create_uninit(scratch.arena, (tensor_shape){ NUM_ACTIONS, 1, 1 });
 
     // Cache for backprop
     layers_cache cache = { .arena = scratch.arena };
     
     // Working tensor for feedforward/backprop
-    tensor* in_out = tensor_create_alloc(scratch.arena, (tensor_shape){1,1,1}, agent->net->max_layer_size);
+    tensor* in_out = tensor_create_alloc_uninit(scratch.arena, (tensor_shape){1,1,1}, agent->net->max_layer_size);
 
     for (int i = 0; i < BATCH_SIZE; i++) {
         int idx = rand() % agent->replay_buffer.count;
@@ -171,14 +169,27 @@ void snake_agent_train(SnakeAgent* agent) {
         // Other actions shouldn't be trained (no observation)
         f32 td_error = q_current - q_target_value;
         
-        // Create sparse delta: all zeros except for selected action
-        tensor_fill(in_out, 0.0f);
-        ((f32*)in_out->data)[action] = td_error;
+        // Create sparse delta: only the selected action has an error
+        u32 action_index = (u32)action;
+        tensor_sparse sparse_delta = {
+            .size = NUM_ACTIONS, .nnz = 1,
+            .indices = &action_index, .values = &td_error
+        };
         
         tensor* delta = in_out;
 
         // 5. Backpropagate TD error
-        for (i64 l = agent->net->num_layers - 1; l >= 0; l--) {
+        // An output dense layer only touches the weights of the selected action
+        i64 last = (i64)agent->net->num_layers - 1;
+        if (agent->net->layers[last]->type == LAYER_DENSE) {
+            layer_dense_backprop_sparse(agent->net->layers[last], &sparse_delta, delta, &cache);
+            last--;
+        } else {
+            tensor_fill(delta, 0.0f);
+            ((f32*)delta->data)[action] = td_error;
+        }
+
+        for (i64 l = last; l >= 0; l--) {
             layer_backprop(agent->net->layers[l], delta, &cache);
         }
     }
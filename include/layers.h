@@ -256,6 +256,18 @@ typedef struct {
      * Defaults to PARAM_INIT_XAVIER_UNIFORM
      */
     param_init_type weight_init;
+
+    /**
+     * @brief Storage type of the weight in inference mode
+     *
+     * f16 and bf16 halve the memory and bandwidth of the weight,
+     * the dot product still accumulates in f32.
+     * Half weights are not pre-packed, since the packed copy would be f32 again. <br>
+     * Training always keeps f32 weights, because optimizer updates are often smaller
+     * than the f16/bf16 precision of the weight and would be rounded away.
+     * Convert the weights after training to get half weights. Defaults to TENSOR_DTYPE_F32
+     */
+    tensor_dtype weight_dtype;
 } layer_dense_desc;
 
 /**
@@ -329,6 +341,37 @@ typedef struct {
     /// Stride for convolution. Defaults to 1
     u32 stride;
 
+    /**
+     * @brief Uses `tensor_im2col_ip` and `tensor_dot_ip` instead of the implicit GEMM convolution
+     *
+     * The implicit GEMM path gathers im2col tiles straight into the GEMM packing buffer,
+     * so it never stores the kernel_size^2 larger column matrix. <br>
+     * Defaults to false
+     */
+    b32 use_im2col;
+
+    /**
+     * @brief Winograd output tile size for 3x3 kernels with a stride of 1
+     *
+     * 2 is F(2x2, 3x3) and 4 is F(4x4, 3x3).
+     * F(4x4, 3x3) does fewer multiplications, but its transforms lose more f32 precision. <br>
+     * Only used in the forward pass. Defaults to 2
+     */
+    u32 winograd_tile;
+
+    /// Uses the implicit GEMM convolution even when Winograd applies. Defaults to false
+    b32 disable_winograd;
+
+    /**
+     * @brief Storage type of the kernels in inference mode
+     *
+     * Same as `layer_dense_desc.weight_dtype`.
+     * Half kernels use the implicit GEMM path, since the Winograd kernels are f32. <br>
+     * Training always keeps f32 kernels, see `layer_dense_desc.weight_dtype`.
+     * Defaults to TENSOR_DTYPE_F32
+     */
+    tensor_dtype kernels_dtype;
+
     /**
      * @brief Initialization type for kernels
      *
@@ -440,6 +483,15 @@ typedef struct {
     tensor* weight;
     tensor* bias;
 
+    // Inference mode only, packed once on create and load.
+    // NULL in training mode, or if the weight is f16 or bf16
+    tensor_packed* packed_weight;
+
+    // Inference mode only, set by layer_quantize or layer_quant_load.
+    // When set, layer_quant_feedforward uses tensor_dot_quantized_ip instead of the weight
+    tensor_quantized* quant_weight;
+    tensor_quant_params quant_input;
+
     // Training mode
     param_change weight_change;
     param_change bias_change;
@@ -480,6 +532,25 @@ typedef struct {
     u32 stride;
     u32 padding;
 
+    // Falls back to im2col + tensor_dot instead of the implicit GEMM in conv.h
+    b32 use_im2col;
+
+    // 0 when Winograd is not used
+    u32 winograd_tile;
+    // Shape is (in_filters, out_filters, (winograd_tile + 2)^2)
+    tensor* winograd_kernels;
+    // Set by apply_changes and load, the transform is redone in the next feedforward
+    b32 winograd_dirty;
+
+    // Inference mode only, packed once on create and load.
+    // NULL in training mode, or if the kernels are f16 or bf16
+    tensor_packed* packed_kernels;
+
+    // Inference mode only, set by layer_quantize or layer_quant_load.
+    // When set, layer_quant_feedforward uses conv_2d_forward_quantized_ip instead of the kernels
+    tensor_quantized* quant_kernels;
+    tensor_quant_params quant_input;
+
     tensor_shape input_shape;
 
     // Training mode
@@ -554,6 +625,23 @@ void layer_feedforward(layer* l, tensor* in_out, layers_cache* cache);
  * @param cache Layer cache
  */
 void layer_backprop(layer* l, tensor* delta, layers_cache* cache);
+/**
+ * @brief Backpropagation of a `LAYER_DENSE` layer with a sparse delta
+ *
+ * Same result as `layer_backprop` with the dense form of `delta`,
+ * but only the weight columns of the indices in `delta` are read and updated.
+ * For one-hot errors on small output layers (e.g. the chosen action in Q-learning),
+ * this skips most of the work of the last layer
+ *
+ * @param l Dense layer in training mode
+ * @param delta Sparse gradient with respect to the output of the layer
+ * @param delta_out Gets the gradient with respect to the input of the layer.
+ *  Needs to be big enough
+ * @param cache Layer cache
+ *
+ * @return true on success. On failure, the input cached by the layer is still popped
+ */
+b32 layer_dense_backprop_sparse(layer* l, const tensor_sparse* delta, tensor* delta_out, layers_cache* cache);
 /**
  * @brief Applies any changes accumulated in backprop to layer
  *
@@ -589,6 +677,56 @@ void layer_save(mg_arena* arena, layer* l, tensor_list* list, u32 index);
  */
 void layer_load(layer* l, const tensor_list* list, u32 index);
 
+/**
+ * @brief Quantizes the weights of a `LAYER_DENSE` or `LAYER_CONV_2D` layer to int8
+ *
+ * Weights get one scale per output channel, and the layer input is quantized
+ * with `input_params` in every feedforward. Other layer types are left as they are
+ *
+ * @param arena Arena to allocate the quantized weights on
+ * @param l Layer to quantize. Must be in inference mode
+ * @param input_params Quantization of the layer input, usually calibrated on a sample
+ *
+ * @return true if the layer was quantized
+ */
+b32 layer_quantize(mg_arena* arena, layer* l, tensor_quant_params input_params);
+/**
+ * @brief `layer_feedforward` with int8 arithmetic, for layers quantized by `layer_quantize`
+ *
+ * `layer_feedforward` always runs the f32 weights. `network_feedforward_quantized` calls this first
+ *
+ * @param l Layer to be used. Must be in inference mode
+ * @param in_out Input to layer and where the output gets stored
+ *
+ * @return true if the layer has int8 weights and ran with them, false if `in_out` is unchanged
+ */
+b32 layer_quant_feedforward(layer* l, tensor* in_out);
+/**
+ * @brief Saves the quantized weights of a layer, if it has any
+ *
+ * Called by `network_quant_save`.
+ * The int8 values are stored as bytes, see `tensor_quantized_to_tensor`
+ *
+ * @param arena Arena for nodes in the `list`
+ * @param l Layer to save
+ * @param list List to save tensors to
+ * @param index Index of the layer in neural network
+ */
+void layer_quant_save(mg_arena* arena, layer* l, tensor_list* list, u32 index);
+/**
+ * @brief Loads quantized weights saved by `layer_quant_save`
+ *
+ * Called by `network_quant_load` for layers in inference mode
+ *
+ * @param arena Arena to allocate the quantized weights on
+ * @param l Layer to load to
+ * @param list List with the loaded tensors
+ * @param index Index of the layer in the neural network
+ *
+ * @return true if quantized weights for the layer were in `list`
+ */
+b32 layer_quant_load(mg_arena* arena, layer* l, const tensor_list* list, u32 index);
+
 /**
  * @brief Retrives the default desc of the layer type
  *
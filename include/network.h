@@ -177,7 +177,7 @@ network* network_load_layout(mg_arena* arena, string8 file_name, b32 training_mo
  *
  * Network files are created by `network_save`,
  * and they include the parameters of the neural network.
- * Used to load a network that has already been trained.
+ * Used to load a network that has already been trained
  *
  * @param arena Arena to create network on
  * @param file_name File to load
@@ -189,6 +189,71 @@ network* network_load(mg_arena* arena, string8 file_name, b32 training_mode);
 
 void network_load_existing(network* nn, string8 file_name);
 
+/**
+ * @brief Loads a network file (.tsn) in inference mode, with int8 dense and convolutional layers
+ *
+ * The int8 weights are loaded from `quant_file_name` with `network_quant_load`.
+ * If that file has none, the network is quantized with `network_quantize` on `calibration_inputs`
+ *
+ * @param arena Arena to create network on
+ * @param file_name File to load
+ * @param quant_file_name File saved by `network_quant_save`. Can be empty
+ * @param calibration_inputs Sample inputs, same layout as `network_train_desc.train_inputs`.
+ *  Can be NULL if `quant_file_name` has the quantized weights
+ *
+ * @return Pointer to network on success, NULL on failure
+ */
+network* network_load_quantized(
+    mg_arena* arena, string8 file_name, string8 quant_file_name, const tensor* calibration_inputs
+);
+
+/**
+ * @brief Post-training quantization of the dense and convolutional layers to int8
+ *
+ * Every 2D slice of `calibration_inputs` is fed through the f32 network,
+ * recording the range of the input of each quantized layer.
+ * Then the weights are quantized per output channel with `layer_quantize`.
+ * `network_save` only writes the f32 weights, save the int8 ones with `network_quant_save`
+ *
+ * @param arena Arena to allocate the quantized weights on
+ * @param nn Network to quantize. Must be in inference mode
+ * @param calibration_inputs Sample inputs, same layout as `network_train_desc.train_inputs`
+ *
+ * @return true on success
+ */
+b32 network_quantize(mg_arena* arena, network* nn, const tensor* calibration_inputs);
+
+/**
+ * @brief `network_feedforward` that runs quantized layers with int8 arithmetic
+ *
+ * Layers quantized by `network_quantize` go through `layer_quant_feedforward`,
+ * every other layer through `layer_feedforward`
+ *
+ * @param nn Network to use. Must be in inference mode
+ * @param out Output of feedforward. Must be big enough
+ * @param input Input to network
+ */
+void network_feedforward_quantized(const network* nn, tensor* out, const tensor* input);
+/**
+ * @brief Saves the int8 weights of a quantized network to a tensor list file (.tst)
+ *
+ * The f32 network is still saved with `network_save`. See `layer_quant_save`
+ *
+ * @param nn Network to save
+ * @param file_name Name of file to save to
+ */
+void network_quant_save(const network* nn, string8 file_name);
+/**
+ * @brief Loads int8 weights saved by `network_quant_save` into a network with the same layout
+ *
+ * @param arena Arena to allocate the quantized weights on
+ * @param nn Network to load to. Must be in inference mode
+ * @param file_name File to load
+ *
+ * @return true if any layer got quantized weights
+ */
+b32 network_quant_load(mg_arena* arena, network* nn, string8 file_name);
+
 /**
  * @brief Deletes the neural network
  *
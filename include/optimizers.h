@@ -158,6 +158,18 @@ void param_change_create(mg_arena* arena, param_change* out, tensor_shape shape)
  * Layers must use this function for thread safety
  */
 void param_change_add(param_change* param_change, tensor* addend);
+/**
+ * @brief Adds `transpose(x) * d` to `param_change`, where `d` is sparse
+ *
+ * Same as `param_change_add` with the dense outer product,
+ * but only the columns in `d.indices` are touched (see `tensor_outer_sparse_add_ip`). <br>
+ * Layers must use this function for thread safety
+ *
+ * @param param_change Param change of a (d.size, size of x) param
+ * @param x Input vector. Can be NULL, then `d` itself is added
+ * @param d Sparse delta
+ */
+void param_change_add_sparse(param_change* param_change, const tensor* x, const tensor_sparse* d);
 /**
  * @brief Applies any changes in `param_change` to `param`
  *
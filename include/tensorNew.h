@@ -7,6 +7,7 @@
 
 #include "base_defs.h"
 #include "str.h"
+#include "os.h"
 #include "../src/mg/mg_arena.h"
 
 #define TENSOR_BACKEND_CPU 1
@@ -34,6 +35,27 @@ typedef struct {
     u32 x, y, z;
 } tensor_index;
 
+/**
+ * @brief Storage type of the elements of a `tensor`
+ *
+ * Tensors are f32 unless created with `tensor_create_dtype`.
+ * The half types halve the memory and bandwidth of weights and cached activations.
+ * They are storage only: `tensor_dot_ip` reads them and accumulates in f32,
+ * `tensor_convert_ip` converts between types,
+ * and every other tensor function expects `TENSOR_DTYPE_F32`
+ */
+typedef enum {
+    /// 32-bit float
+    TENSOR_DTYPE_F32 = 0,
+    /// IEEE half (5 exponent bits, 10 mantissa bits). Max of 65504
+    TENSOR_DTYPE_F16,
+    /// bfloat16 (8 exponent bits, 7 mantissa bits). Same range as f32
+    TENSOR_DTYPE_BF16,
+
+    /// Number of dtypes
+    TENSOR_DTYPE_COUNT
+} tensor_dtype;
+
 /**
  * @brief 3D tensor
  */
@@ -45,8 +67,10 @@ typedef struct {
      * This is ensured in `tensor_create`
      */
     tensor_shape shape;
-    /// Number of f32's allocated
+    /// Number of elements allocated. These are f32's unless `dtype` says otherwise
     u64 alloc;
+    /// Storage type of the elements. Zero initialized tensors are `TENSOR_DTYPE_F32`
+    tensor_dtype dtype;
 
     /**
      * @brief Data of tensor
@@ -56,6 +80,25 @@ typedef struct {
     void* data;
 } tensor;
 
+/**
+ * @brief Strided view into a tensor. DOES NOT OWN THE DATA
+ *
+ * Elements along x are contiguous, rows and slices can be any distance apart. <br>
+ * Indexing: `Element[x,y,z] == view->data[x + y * row_stride + z * slice_stride]` <br>
+ * Views are only valid as long as the tensor they view
+ */
+typedef struct {
+    /// Size of each dim, each at least 1
+    tensor_shape shape;
+    /// Distance between rows in f32's, at least `shape.width`
+    u64 row_stride;
+    /// Distance between z slices in f32's
+    u64 slice_stride;
+
+    /// Points to element (0, 0, 0) of the view
+    void* data;
+} tensor_view;
+
 /**
  * @brief Node in `tensor_list``
  */
@@ -89,6 +132,50 @@ typedef struct {
 #define TENSOR_IP_ALLOC_ERRORS 1
 #endif
 
+/**
+ * @brief Alignment of tensor data in bytes
+ *
+ * One cache line, and the width of an AVX-512 register.
+ * Tensor data starts on this alignment, and the allocation is padded
+ * with zeros to a multiple of it, so SIMD kernels can read whole vectors past the last element
+ */
+#ifndef TENSOR_ALIGN
+#define TENSOR_ALIGN 64
+#endif
+
+/**
+ * @brief Pushes `size` bytes onto `arena` aligned to `align` bytes
+ *
+ * `mga_push` only aligns to the `align` of the arena desc.
+ * This reserves up to `align - 1` extra bytes to align the result
+ *
+ * @param arena Arena to push onto
+ * @param size Size in bytes
+ * @param align Power of 2 alignment
+ *
+ * @return Aligned pointer, or NULL if the push failed
+ */
+void* mga_push_aligned(mg_arena* arena, u64 size, u64 align);
+/// `mga_push_aligned`, but the memory is zeroed
+void* mga_push_zero_aligned(mg_arena* arena, u64 size, u64 align);
+
+#define MGA_PUSH_ARRAY_ALIGNED(arena, T, num, align) (T*)mga_push_aligned((arena), sizeof(T) * (num), (align))
+#define MGA_PUSH_ZERO_ARRAY_ALIGNED(arena, T, num, align) (T*)mga_push_zero_aligned((arena), sizeof(T) * (num), (align))
+
+/// Size in bytes of the data of a tensor with `alloc` elements of `elem_size` bytes, padded to `TENSOR_ALIGN`
+u64 tensor_data_size(u64 alloc, u64 elem_size);
+
+/**
+ * @brief Fills the data of uninitialized tensors with NaN
+ *
+ * For debug builds (`-DTENSOR_POISON_UNINIT=1`),
+ * so reads of elements that were never written show up as NaN
+ * instead of whatever was on the arena before
+ */
+#ifndef TENSOR_POISON_UNINIT
+#define TENSOR_POISON_UNINIT 0
+#endif
+
 /// Returns true if the indices `a` and `b` are equal
 b32 tensor_index_eq(tensor_index a, tensor_index b);
 /// Returns true if the shapes `a` and `b` are equal
@@ -102,7 +189,8 @@ b32 tensor_shape_eq(tensor_shape a, tensor_shape b);
  *  shape.width MUST be at least 1.
  *  shape.height and shape.depth can be zero.
  *
- * @return The created tensor, filled with zeros
+ * @return The created tensor, filled with zeros.
+ *  The data is aligned and padded to `TENSOR_ALIGN` bytes
  */
 tensor* tensor_create(mg_arena* arena, tensor_shape shape);
 /**
@@ -115,9 +203,43 @@ tensor* tensor_create(mg_arena* arena, tensor_shape shape);
  * @param alloc Number of `f32`s to allocate.
  *  Must be at least `(u64)shape.width * shape.height * shape.depth`
  *
- * @return The created tensor, filled with zero, and the correct alloc
+ * @return The created tensor, filled with zero, and the correct alloc.
+ *  The data is aligned and padded to `TENSOR_ALIGN` bytes
  */
 tensor* tensor_create_alloc(mg_arena* arena, tensor_shape shape, u64 alloc);
+/**
+ * @brief `tensor_create` without filling the data with zero
+ *
+ * For outputs that get fully overwritten right away, like the `out` of an _ip function.
+ * The contents are undefined (NaN with `TENSOR_POISON_UNINIT`)
+ */
+tensor* tensor_create_uninit(mg_arena* arena, tensor_shape shape);
+/// `tensor_create_alloc` without filling the data with zero. See `tensor_create_uninit`
+tensor* tensor_create_alloc_uninit(mg_arena* arena, tensor_shape shape, u64 alloc);
+
+/// Returns the size of one element of `dtype` in bytes, or 0 if `dtype` is invalid
+u64 tensor_dtype_size(tensor_dtype dtype);
+/**
+ * @brief Creates a tensor of `dtype` and fills it with zero
+ *
+ * @param arena Arena to allocate `tensor` and data on
+ * @param shape Shape of tensor to create. Same rules as `tensor_create`
+ * @param dtype Storage type of the elements
+ *
+ * @return The created tensor, or NULL if `dtype` is invalid
+ */
+tensor* tensor_create_dtype(mg_arena* arena, tensor_shape shape, tensor_dtype dtype);
+/**
+ * @brief Converts `t` into the dtype of `out`, if `out` is big enough
+ *
+ * Conversions to f16 and bf16 round to nearest even (see src/tensor/half.h).
+ * `out` can be the same tensor as `t` if they have the same dtype
+ *
+ * @return true if `out` is big enough and does not overlap `t` with a different dtype
+ */
+b32 tensor_convert_ip(tensor* out, const tensor* t);
+/// Creates a copy of `t` with the elements converted to `dtype`
+tensor* tensor_convert(mg_arena* arena, const tensor* t, tensor_dtype dtype);
 
 // TODO: reword memory useage and age destroy statements
 
@@ -157,6 +279,24 @@ tensor_index tensor_argmax(const tensor* t);
 /// Returns true if `t` is all zero
 b32 tensor_is_zero(const tensor* t);
 
+/// Returns the sum of every element of `t`
+f32 tensor_sum(const tensor* t);
+/// Returns the mean of every element of `t`
+f32 tensor_mean(const tensor* t);
+/// Returns the maximum element of `t`
+f32 tensor_max(const tensor* t);
+/// Returns the minimum element of `t`
+f32 tensor_min(const tensor* t);
+/// Returns the L2 norm of `t` (square root of the sum of squares)
+f32 tensor_l2_norm(const tensor* t);
+/**
+ * @brief Returns the sum of the elementwise product of `a` and `b`
+ *
+ * `a` and `b` must have the same shape.
+ * Returns 0 and creates an error otherwise
+ */
+f32 tensor_inner_product(const tensor* a, const tensor* b);
+
 /**
  * @brief Gets a 2D view from a 3D tensor. DOES NOT COPY THE DATA
  *
@@ -166,11 +306,75 @@ b32 tensor_is_zero(const tensor* t);
  */
 void tensor_2d_view(tensor* out, const tensor* tensor, u32 z);
 
+/// Gets a view of all of `t`. DOES NOT COPY THE DATA. Half tensors give an empty view
+tensor_view tensor_view_from(const tensor* t);
+/**
+ * @brief Gets a view of a box of `view`. DOES NOT COPY THE DATA
+ *
+ * Selects a range along every axis at once,
+ * e.g. a crop (x and y), a channel range (z) or a range of examples in a batch (y or z)
+ *
+ * @param out Output of view
+ * @param view View you are slicing. Use `tensor_view_from` to slice a tensor
+ * @param start First element of the box
+ * @param shape Shape of the box
+ *
+ * @return true if the box is inside of `view`, false otherwise
+ */
+b32 tensor_view_slice(tensor_view* out, const tensor_view* view, tensor_index start, tensor_shape shape);
+/// Returns true if there are no gaps between the rows and slices of `view`
+b32 tensor_view_is_contiguous(const tensor_view* view);
+/**
+ * @brief Gets a `tensor` that aliases a contiguous view. DOES NOT COPY THE DATA
+ *
+ * Lets contiguous views (e.g. a range of examples) go through the regular tensor functions
+ *
+ * @return true if `view` is contiguous, false otherwise
+ */
+b32 tensor_view_as_tensor(tensor* out, const tensor_view* view);
+/**
+ * @brief Copies the elements of `view` into `out`, with the shape of `view`
+ *
+ * `out` cannot overlap `view`
+ *
+ * @return true if `out` is big enough, false otherwise
+ */
+b32 tensor_view_copy_ip(tensor* out, const tensor_view* view);
+
+/**
+ * @brief Adds `a` and `b` into `out`
+ *
+ * All three views must have the same shape.
+ * `out` can be the same view as `a` or `b`, but cannot partially overlap them
+ *
+ * @return true if the shapes match, false otherwise
+ */
+b32 tensor_view_add_ip(tensor_view* out, const tensor_view* a, const tensor_view* b);
+/// Subtracts `b` from `a` into `out`. See `tensor_view_add_ip`
+b32 tensor_view_sub_ip(tensor_view* out, const tensor_view* a, const tensor_view* b);
+/// Component multiplies `a` and `b` into `out`. See `tensor_view_add_ip`
+b32 tensor_view_component_mul_ip(tensor_view* out, const tensor_view* a, const tensor_view* b);
+/// Component divides `a` and `b` into `out`. See `tensor_view_add_ip`
+b32 tensor_view_component_div_ip(tensor_view* out, const tensor_view* a, const tensor_view* b);
+/// Scales `view` by `s` into `out`. See `tensor_view_add_ip`
+b32 tensor_view_scale_ip(tensor_view* out, const tensor_view* view, f32 s);
+
+/**
+ * @brief `tensor_dot_ip` with views as inputs
+ *
+ * `a` and `b` have to be 2D, and are read with their row strides, without copying
+ *
+ * @return true if the shapes are valid and `out` is big enough, false otherwise
+ */
+b32 tensor_view_dot_ip(tensor* out, b32 transpose_a, b32 transpose_b, const tensor_view* a, const tensor_view* b);
+
 /**
  * @brief Computes the dot product of `a` and `b`.
  *
  * `a` and `b` have to be 2D.
- * `a.width` must equal `b.height`
+ * `a.width` must equal `b.height` <br>
+ * Any of `out`, `a` and `b` can be f16 or bf16.
+ * Half operands are converted while they are packed, and the products accumulate in f32
  *
  * @param out Output of dot product. Needs to be big enough (i.e. (b.width, a.height, 1))
  * @param transpose_a Whether or not to transpose a
@@ -188,6 +392,228 @@ b32 tensor_dot_ip(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a
  */
 tensor* tensor_dot(mg_arena* arena, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b);
 
+/**
+ * @brief Computes the dot product of every z-slice of `a` with the matching z-slice of `b`
+ *
+ * `b` can also have a depth of 1, in which case it is used for every slice of `a`
+ * and is only packed once. Slices are split across the thread pool from `tensor_set_thread_pool`
+ *
+ * @param out Output of dot products. Needs to be big enough (i.e. (b.width, a.height, a.depth))
+ * @param transpose_a Whether or not to transpose the slices of a
+ * @param transpose_b Whether or not to transpose the slices of b
+ * @param a First tensor
+ * @param b Second tensor, with a depth of 1 or a.depth
+ *
+ * @return true if the shapes are valid and `out` was big enough, false otherwise
+ */
+b32 tensor_dot_batched_ip(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b);
+/**
+ * @brief Computes the dot product of every z-slice of `a` and `b`
+ *
+ * See `tensor_dot_batched_ip` for more
+ */
+tensor* tensor_dot_batched(mg_arena* arena, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b);
+
+/**
+ * @brief Matrix stored in the panel-packed layout of the CPU GEMM
+ *
+ * Meant for weights that do not change, like those of layers in inference mode.
+ * `tensor_dot_ip` repacks both operands on every call, the packed dot products do not
+ */
+typedef struct {
+    /// Rows of the packed matrix (after the optional transpose)
+    u32 rows;
+    /// Columns of the packed matrix (after the optional transpose)
+    u32 cols;
+    /// Whether the matrix was packed as the left operand of a dot product
+    b32 left;
+    /// Packed data, only readable by the packed dot products
+    f32* data;
+} tensor_packed;
+
+/**
+ * @brief Packs a 2D tensor for `tensor_dot_packed_a_ip` or `tensor_dot_packed_b_ip`
+ *
+ * `t` can be f16 or bf16, but the packed data is always f32.
+ * The other operand and the output of the packed dot products must be f32
+ *
+ * @param arena Arena to allocate the packed matrix on
+ * @param t 2D tensor to pack
+ * @param transpose Packs the transpose of `t`
+ * @param left Packs `t` as the left operand (a) instead of the right one (b)
+ *
+ * @return Packed matrix, or NULL if `t` is not 2D
+ */
+tensor_packed* tensor_pack(mg_arena* arena, const tensor* t, b32 transpose, b32 left);
+/**
+ * @brief `tensor_dot_ip`, but `a` is a packed matrix
+ *
+ * @return true if the shapes are valid and `out` was big enough, false otherwise
+ */
+b32 tensor_dot_packed_a_ip(tensor* out, const tensor_packed* a, b32 transpose_b, const tensor* b);
+/**
+ * @brief `tensor_dot_ip`, but `b` is a packed matrix
+ *
+ * @return true if the shapes are valid and `out` was big enough, false otherwise
+ */
+b32 tensor_dot_packed_b_ip(tensor* out, b32 transpose_a, const tensor* a, const tensor_packed* b);
+
+/**
+ * @brief Affine quantization of activations to 7 bit unsigned integers
+ *
+ * `x ~= scale * (q - zero_point)`, with q in [0, 127]
+ */
+typedef struct {
+    f32 scale;
+    i32 zero_point;
+} tensor_quant_params;
+
+/**
+ * @brief int8 weight matrix for `tensor_dot_quantized_ip`
+ *
+ * Created by `tensor_quantize`. Each column (output channel) has its own scale,
+ * so `W[:, j] ~= scales[j] * W_i8[:, j]` with W_i8 in [-127, 127]
+ */
+typedef struct {
+    /// Rows of the matrix (the dimension shared with the other operand)
+    u32 rows;
+    /// Columns of the matrix (the output channels)
+    u32 cols;
+    /// Scale of each column
+    f32* scales;
+    /// Sum of the int8 values of each column, to correct for the zero point of the other operand
+    i32* col_sums;
+    /// Packed int8 data, only readable by the quantized dot product
+    i8* data;
+} tensor_quantized;
+
+/**
+ * @brief Computes the quantization parameters of the range [`min`, `max`]
+ *
+ * The range is widened to include 0, so zero (e.g. padding) is represented exactly
+ */
+tensor_quant_params tensor_quant_params_from_range(f32 min, f32 max);
+/**
+ * @brief Computes the quantization parameters that cover every value of `t`
+ *
+ * Used to calibrate the input of a quantized layer on a sample
+ *
+ * @param t f32 tensor
+ */
+tensor_quant_params tensor_quant_calibrate(const tensor* t);
+/**
+ * @brief Quantizes a 2D tensor to int8 with one scale per column
+ *
+ * The scale of column j is `max(abs(t[:, j])) / 127`
+ *
+ * @param arena Arena to allocate the quantized matrix on
+ * @param t 2D tensor to quantize. Can be f16 or bf16
+ * @param transpose Quantizes the transpose of `t`
+ *
+ * @return Quantized matrix, or NULL if `t` is not 2D
+ */
+tensor_quantized* tensor_quantize(mg_arena* arena, const tensor* t, b32 transpose);
+/**
+ * @brief `tensor_dot_ip` with int8 arithmetic: `out = dequant(quant(op(a)) * b)`
+ *
+ * `a` is quantized with `a_params`, and the products are accumulated in int32.
+ * Uses VNNI (VPDPBUSD) or AVX2 (VPMADDUBSW) when the CPU has them.
+ * `out` and `a` must be f32
+ *
+ * @return true if the shapes are valid and `out` was big enough, false otherwise
+ */
+b32 tensor_dot_quantized_ip(
+    tensor* out, b32 transpose_a, const tensor* a,
+    tensor_quant_params a_params, const tensor_quantized* b
+);
+/**
+ * @brief Converts a quantized matrix to a tensor, so it can be saved in a `tensor_list`
+ *
+ * Shape is (cols, ceil(rows / 4) + 1, 1). The last row holds the scales.
+ * The other rows store the int8 values as raw bytes, four to an f32:
+ * element (r, j) holds rows 4r to 4r + 3 of column j.
+ * Rows past the end of the matrix are -128, which quantized values never use.
+ * The f32s are only containers, so they should not be used in arithmetic
+ */
+tensor* tensor_quantized_to_tensor(mg_arena* arena, const tensor_quantized* q);
+/**
+ * @brief Creates a quantized matrix from the output of `tensor_quantized_to_tensor`
+ *
+ * @return Quantized matrix, or NULL if `t` is not a valid quantized matrix
+ */
+tensor_quantized* tensor_quantized_from_tensor(mg_arena* arena, const tensor* t);
+
+/**
+ * @brief Sparse vector, as a list of indices and values
+ *
+ * For deltas that are zero almost everywhere,
+ * like the one-hot errors of classification or Q-learning
+ */
+typedef struct {
+    /// Number of elements of the dense vector
+    u32 size;
+    /// Number of stored elements
+    u32 nnz;
+    /// Indices of the stored elements. Each index can only appear once
+    u32* indices;
+    /// Values of the stored elements
+    f32* values;
+} tensor_sparse;
+
+/**
+ * @brief Collects the non zero elements of `t` into `out`
+ *
+ * @param out Output. `indices` and `values` need room for `max_nnz` elements
+ * @param t f32 tensor, treated as a vector
+ * @param max_nnz Most non zero elements to collect
+ *
+ * @return true if `t` has at most `max_nnz` non zero elements, false otherwise.
+ *  `out` is only valid if true
+ */
+b32 tensor_sparse_from_dense(tensor_sparse* out, const tensor* t, u32 max_nnz);
+/**
+ * @brief Outer product with a sparse vector: `out += transpose(x) * d`
+ *
+ * Only the columns in `d.indices` are touched,
+ * so this is the weight gradient of a dense layer with a sparse delta
+ *
+ * @param out f32 matrix (d.size, size of x, 1) to add to
+ * @param x f32 tensor, treated as a vector. Can be NULL for a vector of one 1 (`out += d`)
+ * @param d Sparse vector
+ *
+ * @return true if the shapes are valid, false otherwise
+ */
+b32 tensor_outer_sparse_add_ip(tensor* out, const tensor* x, const tensor_sparse* d);
+/**
+ * @brief Dot product with a sparse vector: `out = a * op(b)`
+ *
+ * Only the rows of op(b) in `a.indices` are read.
+ * With `transpose_b`, this is the input delta of a dense layer with a sparse delta
+ *
+ * @param out Output, gets the shape (op(b).width, 1, 1). Cannot overlap `b`
+ * @param a Sparse vector of `op(b).height` elements
+ * @param transpose_b Whether or not to transpose b
+ * @param b f32 2D tensor
+ *
+ * @return true if the shapes are valid and `out` was big enough, false otherwise
+ */
+b32 tensor_dot_sparse_ip(tensor* out, const tensor_sparse* a, b32 transpose_b, const tensor* b);
+
+/**
+ * @brief Sets the thread pool that CPU tensor kernels split large operations across
+ *
+ * The pool should not be shared with unrelated tasks,
+ * because kernels wait on it with `thread_pool_wait`.
+ * Kernels called from inside one of its tasks run single threaded.
+ * Should not be called while tensor operations are running
+ *
+ * @param pool Thread pool, or NULL to run everything on the calling thread
+ * @param num_threads Number of threads in `pool`
+ */
+void tensor_set_thread_pool(thread_pool* pool, u32 num_threads);
+/// Returns the thread pool set with `tensor_set_thread_pool`, or NULL
+thread_pool* tensor_get_thread_pool(void);
+
 /**
  * @brief Computes the output shape of `tensor_cov`
  *
@@ -297,6 +723,32 @@ b32 tensor_scale_ip(tensor* out, const tensor* t, f32 s);
  */
 b32 tensor_sqrt_ip(tensor* out, const tensor* t);
 
+/**
+ * @brief Gets the shape of `a` and `b` broadcast together
+ *
+ * Like NumPy, every dim of `a` and `b` has to be equal, or 1 in one of them.
+ * A dim of 1 is repeated to match the other tensor,
+ * e.g. a (width, 1, 1) bias broadcasts over a (width, batch_size, 1) batch,
+ * and a (1, 1, channels) bias over a (width, height, channels) image
+ *
+ * @return true if the shapes can be broadcast, false otherwise
+ */
+b32 tensor_broadcast_shape(tensor_shape* out, tensor_shape a, tensor_shape b);
+/**
+ * @brief Adds `a` and `b` into out, broadcasting them together (see `tensor_broadcast_shape`)
+ *
+ * `out` gets the broadcast shape, and can be the same tensor as `a` or `b`
+ *
+ * @return true if the shapes can be broadcast and `out` is big enough, false otherwise
+ */
+b32 tensor_add_broadcast_ip(tensor* out, const tensor* a, const tensor* b);
+/// Subtracts `b` from `a` into out, broadcasting them together. See `tensor_add_broadcast_ip`
+b32 tensor_sub_broadcast_ip(tensor* out, const tensor* a, const tensor* b);
+/// Component multiplies `a` and `b` into out, broadcasting them together. See `tensor_add_broadcast_ip`
+b32 tensor_component_mul_broadcast_ip(tensor* out, const tensor* a, const tensor* b);
+/// Component divides `a` by `b` into out, broadcasting them together. See `tensor_add_broadcast_ip`
+b32 tensor_component_div_broadcast_ip(tensor* out, const tensor* a, const tensor* b);
+
 /// Creates a `tensor` that is the sum of `a` and `b`
 tensor* tensor_add(mg_arena* arena, const tensor* a, const tensor* b);
 /// Creates a `tensor` that is the difference of `a` and `b`
@@ -305,6 +757,14 @@ tensor* tensor_sub(mg_arena* arena, const tensor* a, const tensor* b);
 tensor* tensor_component_mul(mg_arena* arena, const tensor* a, const tensor* b);
 /// Creates a `tensor` that is the component quotient of `a` and `b`
 tensor* tensor_component_div(mg_arena* arena, const tensor* a, const tensor* b);
+/// Creates a `tensor` that is the broadcast sum of `a` and `b`
+tensor* tensor_add_broadcast(mg_arena* arena, const tensor* a, const tensor* b);
+/// Creates a `tensor` that is the broadcast difference of `a` and `b`
+tensor* tensor_sub_broadcast(mg_arena* arena, const tensor* a, const tensor* b);
+/// Creates a `tensor` that is the broadcast component product of `a` and `b`
+tensor* tensor_component_mul_broadcast(mg_arena* arena, const tensor* a, const tensor* b);
+/// Creates a `tensor` that is the broadcast component quotient of `a` and `b`
+tensor* tensor_component_div_broadcast(mg_arena* arena, const tensor* a, const tensor* b);
 /// Creates a `tensor` that `x` added to each element of `t`
 tensor* tensor_add_all(mg_arena* arena, const tensor* t, f32 x);
 /// Creates a `tensor` that is `t` scaled by `s`
@@ -312,6 +772,105 @@ tensor* tensor_scale(mg_arena* arena, const tensor* t, f32 s);
 /// Creates a `tensor` that is the square root of `t`
 tensor* tensor_sqrt(mg_arena* arena, const tensor* t);
 
+/**
+ * @brief Operations of a `tensor_map_instr`
+ *
+ * Expressions run on a small value stack, like an RPN calculator
+ */
+typedef enum {
+    /// Does nothing
+    TENSOR_MAP_OP_NULL = 0,
+
+    /// Pushes `inputs[index]`
+    TENSOR_MAP_OP_INPUT,
+    /// Pushes `value`
+    TENSOR_MAP_OP_CONST,
+    /// Pops the top value into `outputs[index]`
+    TENSOR_MAP_OP_STORE,
+
+    /// Pops b, pops a, pushes a + b
+    TENSOR_MAP_OP_ADD,
+    /// Pops b, pops a, pushes a - b
+    TENSOR_MAP_OP_SUB,
+    /// Pops b, pops a, pushes a * b
+    TENSOR_MAP_OP_MUL,
+    /// Pops b, pops a, pushes a / b
+    TENSOR_MAP_OP_DIV,
+
+    /// Adds `value` to the top value
+    TENSOR_MAP_OP_ADD_SCALAR,
+    /// Multiplies the top value by `value`
+    TENSOR_MAP_OP_MUL_SCALAR,
+    /// Takes the square root of the top value
+    TENSOR_MAP_OP_SQRT,
+
+    /// Number of map ops
+    TENSOR_MAP_OP_COUNT
+} tensor_map_op;
+
+/// Maximum depth of the value stack in a `tensor_map_expr`
+#define TENSOR_MAP_MAX_STACK 8
+
+/// Single instruction of a `tensor_map_expr`
+typedef struct {
+    /// Operation
+    tensor_map_op op;
+    /// Input or output index, for `TENSOR_MAP_OP_INPUT` and `TENSOR_MAP_OP_STORE`
+    u32 index;
+    /// Scalar, for `TENSOR_MAP_OP_CONST` and the `_SCALAR` ops
+    f32 value;
+} tensor_map_instr;
+
+/// Pushes `inputs[i]`
+#define TENSOR_MAP_INPUT(i) ((tensor_map_instr){ .op = TENSOR_MAP_OP_INPUT, .index = (i) })
+/// Pushes the constant `x`
+#define TENSOR_MAP_CONST(x) ((tensor_map_instr){ .op = TENSOR_MAP_OP_CONST, .value = (x) })
+/// Pops the top value into `outputs[i]`
+#define TENSOR_MAP_STORE(i) ((tensor_map_instr){ .op = TENSOR_MAP_OP_STORE, .index = (i) })
+/// Instruction without arguments (e.g. `TENSOR_MAP(ADD)`)
+#define TENSOR_MAP(op_name) ((tensor_map_instr){ .op = TENSOR_MAP_OP_##op_name })
+/// Instruction with a scalar (e.g. `TENSOR_MAP_SCALAR(MUL_SCALAR, 0.9f)`)
+#define TENSOR_MAP_SCALAR(op_name, x) ((tensor_map_instr){ .op = TENSOR_MAP_OP_##op_name, .value = (x) })
+
+/**
+ * @brief Fused elementwise expression
+ *
+ * Example, SGD with momentum over `V` (input 0 and output 0) and `dW` (input 1):
+ * ```
+ * tensor_map_instr instrs[] = {
+ *     TENSOR_MAP_INPUT(0), TENSOR_MAP_SCALAR(MUL_SCALAR, beta),
+ *     TENSOR_MAP_INPUT(1), TENSOR_MAP_SCALAR(MUL_SCALAR, 1.0f - beta),
+ *     TENSOR_MAP(ADD), TENSOR_MAP_STORE(0)
+ * };
+ * ```
+ */
+typedef struct {
+    /// Number of instructions
+    u32 num_instrs;
+    /// Instructions, run in order
+    const tensor_map_instr* instrs;
+} tensor_map_expr;
+
+/**
+ * @brief Evaluates `expr` over every element in a single pass
+ *
+ * The tensors are processed in small blocks that stay in L1,
+ * instead of streaming every tensor through memory once per operation. <br>
+ * All inputs must have the same shape, and the outputs get that shape. <br>
+ * An output can be the same tensor as an input, but they cannot partially overlap.
+ * Within a block, instructions run in order, so an input read after
+ * a store to the same tensor sees the stored value
+ *
+ * @param outputs Output tensors. Each needs to be big enough
+ * @param num_outputs Number of outputs
+ * @param inputs Input tensors
+ * @param num_inputs Number of inputs. Must be at least 1
+ * @param expr Expression to evaluate. It must leave the stack empty
+ *
+ * @return true if the expression is valid and the outputs are big enough, false otherwise
+ */
+b32 tensor_map_ip(tensor** outputs, u32 num_outputs, const tensor** inputs, u32 num_inputs, const tensor_map_expr* expr);
+
 /// Returns a copy of the tensor's data
 f32* tensor_copy_data(mg_arena* arena, const tensor* t);
 /**
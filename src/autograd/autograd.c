@@ -4,10 +4,16 @@
 
 #include "autograd.h"
 
-#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "../tensor/elementwise.h"
+#include "../tensor/reduce.h"
+#include "../tensor/vmath.h"
+
+// log(q) is computed into a stack buffer one block at a time, so out can alias p or q
+#define _AUTOGRAD_LOG_BLOCK 256
+
 b32 mat_relu(matrix* out, const matrix* in) {
     if (out->rows != in->rows || out->cols != in->cols) {
         return false;
@@ -27,13 +33,17 @@ b32 mat_softmax(matrix* out, const matrix* in) {
     }
 
     u64 size = (u64)out->rows * out->cols;
-
-    f32 sum = 0.0f;
-    for (u64 i = 0; i < size; i++) {
-        out->data[i] = expf(in->data[i]);
-        sum += out->data[i];
+    if (size == 0) {
+        return true;
     }
 
+    // Subtracting the max does not change the result, but keeps exp from overflowing
+    f32 max = reduce_kernels_get()->max(in->data, size);
+    elementwise_kernels_get()->add_all(out->data, in->data, -max, size);
+
+    vmath_kernels_get(VMATH_ACCURATE)->exp(out->data, out->data, size);
+    f32 sum = reduce_kernels_get()->sum(out->data, size);
+
     mat_scale(out, 1.0f / sum);
 
     return true;
@@ -44,9 +54,17 @@ b32 mat_cross_entropy(matrix* out, const matrix* p, const matrix* q) {
     if (out->rows != p->rows || out->cols != p->cols) { return false; }
 
     u64 size = (u64)out->rows * out->cols;
-    for (u64 i = 0; i < size; i++) {
-        out->data[i] = p->data[i] == 0.0f ?
-            0.0f : p->data[i] * -logf(q->data[i]);
+    const vmath_kernels* vm = vmath_kernels_get(VMATH_ACCURATE);
+
+    f32 log_q[_AUTOGRAD_LOG_BLOCK];
+    for (u64 i = 0; i < size; i += _AUTOGRAD_LOG_BLOCK) {
+        u64 block = MIN(_AUTOGRAD_LOG_BLOCK, size - i);
+        vm->log(log_q, q->data + i, block);
+
+        for (u64 j = 0; j < block; j++) {
+            out->data[i + j] = p->data[i + j] == 0.0f ?
+                0.0f : p->data[i + j] * -log_q[j];
+        }
     }
 
     return true;
@@ -107,8 +125,16 @@ b32 mat_cross_entropy_add_grad(
             return false;
         }
 
-        for (u64 i = 0; i < size; i++) {
-            p_grad->data[i] += -logf(q->data[i]) * grad->data[i];
+        const vmath_kernels* vm = vmath_kernels_get(VMATH_ACCURATE);
+
+        f32 log_q[_AUTOGRAD_LOG_BLOCK];
+        for (u64 i = 0; i < size; i += _AUTOGRAD_LOG_BLOCK) {
+            u64 block = MIN(_AUTOGRAD_LOG_BLOCK, size - i);
+            vm->log(log_q, q->data + i, block);
+
+            for (u64 j = 0; j < block; j++) {
+                p_grad->data[i + j] += -log_q[j] * grad->data[i + j];
+            }
         }
     }
 
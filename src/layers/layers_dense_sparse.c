@@ -0,0 +1,23 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/layers.h"
+#include "../../include/err.h"
+
+b32 layer_dense_backprop_sparse(layer* l, const tensor_sparse* delta, tensor* delta_out, layers_cache* cache) {
+    // Cached by the feedforward in training mode, popped even on error so the cache stays balanced
+    tensor* prev_input = l->training_mode ? layers_cache_pop(cache) : NULL;
+
+    if (l->type != LAYER_DENSE || !l->training_mode) {
+        ERR(ERR_INVALID_INPUT, "Cannot backprop sparse delta: layer must be a dense layer in training mode");
+        return false;
+    }
+
+    layer_dense_backend* dense = &l->dense_backend;
+
+    param_change_add_sparse(&dense->bias_change, NULL, delta);
+    param_change_add_sparse(&dense->weight_change, prev_input, delta);
+
+    return tensor_dot_sparse_ip(delta_out, delta, true, dense->weight);
+}
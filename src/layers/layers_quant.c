@@ -0,0 +1,207 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/layers.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+
+#include "../tensor/conv.h"
+
+b32 layer_quantize(mg_arena* arena, layer* l, tensor_quant_params input_params) {
+    if (l->training_mode) {
+        ERR(ERR_INVALID_INPUT, "Cannot quantize layer: layer is in training mode");
+        return false;
+    }
+
+    switch (l->type) {
+        case LAYER_DENSE: {
+            layer_dense_backend* dense = &l->dense_backend;
+
+            tensor_quantized* weight = tensor_quantize(arena, dense->weight, false);
+            if (weight == NULL) {
+                return false;
+            }
+
+            dense->quant_weight = weight;
+            dense->quant_input = input_params;
+        } return true;
+
+        case LAYER_CONV_2D: {
+            layer_conv_2d_backend* conv = &l->conv_2d_backend;
+
+            conv->quant_kernels = conv_2d_quantize_kernels(arena, conv->kernels);
+            conv->quant_input = input_params;
+        } return true;
+
+        default: return false;
+    }
+}
+
+b32 layer_quant_feedforward(layer* l, tensor* in_out) {
+    switch (l->type) {
+        case LAYER_DENSE: {
+            layer_dense_backend* dense = &l->dense_backend;
+            if (dense->quant_weight == NULL) {
+                return false;
+            }
+
+            u64 in_size = (u64)in_out->shape.width * in_out->shape.height * in_out->shape.depth;
+            in_out->shape = (tensor_shape){ (u32)in_size, 1, 1 };
+
+            // The input is quantized before out is written, so in_out can be both
+            if (!tensor_dot_quantized_ip(in_out, false, in_out, dense->quant_input, dense->quant_weight)) {
+                return false;
+            }
+
+            tensor_add_ip(in_out, in_out, dense->bias);
+        } break;
+
+        case LAYER_CONV_2D: {
+            layer_conv_2d_backend* conv = &l->conv_2d_backend;
+            if (conv->quant_kernels == NULL) {
+                return false;
+            }
+
+            if (!conv_2d_forward_quantized_ip(
+                in_out, in_out, conv->quant_input, conv->quant_kernels,
+                conv->kernel_size, conv->stride, conv->padding
+            )) {
+                return false;
+            }
+
+            tensor_add_ip(in_out, in_out, conv->biases);
+        } break;
+
+        default: return false;
+    }
+
+    in_out->shape = l->shape;
+
+    return true;
+}
+
+static tensor* _quant_params_to_tensor(mg_arena* arena, tensor_quant_params params) {
+    tensor* out = tensor_create_uninit(arena, (tensor_shape){ 2, 1, 1 });
+    ((f32*)out->data)[0] = params.scale;
+    ((f32*)out->data)[1] = (f32)params.zero_point;
+
+    return out;
+}
+
+static b32 _quant_params_from_tensor(tensor_quant_params* out, const tensor* t) {
+    if (t == NULL || t->dtype != TENSOR_DTYPE_F32 || t->shape.width * t->shape.height * t->shape.depth != 2) {
+        return false;
+    }
+
+    f32 scale = ((f32*)t->data)[0];
+    f32 zero_point = ((f32*)t->data)[1];
+
+    if (!(scale > 0.0f) || zero_point < 0.0f || zero_point > 127.0f) {
+        ERR(ERR_INVALID_INPUT, "Cannot load quantized layer: invalid input quantization");
+        return false;
+    }
+
+    *out = (tensor_quant_params){ .scale = scale, .zero_point = (i32)zero_point };
+
+    return true;
+}
+
+void layer_quant_save(mg_arena* arena, layer* l, tensor_list* list, u32 index) {
+    switch (l->type) {
+        case LAYER_DENSE: {
+            layer_dense_backend* dense = &l->dense_backend;
+            if (dense->quant_weight == NULL) {
+                break;
+            }
+
+            string8 weight_name = str8_pushf(arena, "dense_quant_weight_%u", index);
+            string8 input_name = str8_pushf(arena, "dense_quant_input_%u", index);
+
+            tensor_list_push(arena, list, tensor_quantized_to_tensor(arena, dense->quant_weight), weight_name);
+            tensor_list_push(arena, list, _quant_params_to_tensor(arena, dense->quant_input), input_name);
+        } break;
+
+        case LAYER_CONV_2D: {
+            layer_conv_2d_backend* conv = &l->conv_2d_backend;
+            if (conv->quant_kernels == NULL) {
+                break;
+            }
+
+            string8 kernels_name = str8_pushf(arena, "conv_2d_quant_kernels_%u", index);
+            string8 input_name = str8_pushf(arena, "conv_2d_quant_input_%u", index);
+
+            tensor_list_push(arena, list, tensor_quantized_to_tensor(arena, conv->quant_kernels), kernels_name);
+            tensor_list_push(arena, list, _quant_params_to_tensor(arena, conv->quant_input), input_name);
+        } break;
+
+        default: break;
+    }
+}
+
+b32 layer_quant_load(mg_arena* arena, layer* l, const tensor_list* list, u32 index) {
+    if (l->training_mode) {
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    b32 loaded = false;
+    tensor_quant_params input_params = { 0 };
+
+    switch (l->type) {
+        case LAYER_DENSE: {
+            layer_dense_backend* dense = &l->dense_backend;
+
+            string8 weight_name = str8_pushf(scratch.arena, "dense_quant_weight_%u", index);
+            string8 input_name = str8_pushf(scratch.arena, "dense_quant_input_%u", index);
+
+            tensor* weight = tensor_list_get(list, weight_name);
+            if (weight == NULL || !_quant_params_from_tensor(&input_params, tensor_list_get(list, input_name))) {
+                break;
+            }
+
+            tensor_quantized* quant_weight = tensor_quantized_from_tensor(arena, weight);
+            if (quant_weight == NULL || quant_weight->rows != dense->weight->shape.height ||
+                quant_weight->cols != dense->weight->shape.width) {
+                ERR(ERR_BAD_SHAPE, "Cannot load quantized layer: weight does not match layer");
+                break;
+            }
+
+            dense->quant_weight = quant_weight;
+            dense->quant_input = input_params;
+            loaded = true;
+        } break;
+
+        case LAYER_CONV_2D: {
+            layer_conv_2d_backend* conv = &l->conv_2d_backend;
+
+            string8 kernels_name = str8_pushf(scratch.arena, "conv_2d_quant_kernels_%u", index);
+            string8 input_name = str8_pushf(scratch.arena, "conv_2d_quant_input_%u", index);
+
+            tensor* kernels = tensor_list_get(list, kernels_name);
+            if (kernels == NULL || !_quant_params_from_tensor(&input_params, tensor_list_get(list, input_name))) {
+                break;
+            }
+
+            tensor_quantized* quant_kernels = tensor_quantized_from_tensor(arena, kernels);
+            if (quant_kernels == NULL ||
+                quant_kernels->rows != conv->kernels->shape.width * conv->kernels->shape.height ||
+                quant_kernels->cols != conv->kernels->shape.depth) {
+                ERR(ERR_BAD_SHAPE, "Cannot load quantized layer: kernels do not match layer");
+                break;
+            }
+
+            conv->quant_kernels = quant_kernels;
+            conv->quant_input = input_params;
+            loaded = true;
+        } break;
+
+        default: break;
+    }
+
+    mga_scratch_release(scratch);
+
+    return loaded;
+}
@@ -6,57 +6,210 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-mem_arena* arena_create(u64 reserve_size, u64 commit_size) {
-    u32 pagesize = plat_get_pagesize();
+// Reserve and commit granularity
+static u64 _arena_granularity(u32 flags) {
+    if (flags & (ARENA_FLAG_HUGE_PAGES | ARENA_FLAG_HUGETLB)) {
+        return ARENA_HUGE_PAGE_SIZE;
+    }
 
-    reserve_size = ALIGN_UP_POW2(reserve_size, pagesize);
-    commit_size = ALIGN_UP_POW2(commit_size, pagesize);
+    return plat_get_pagesize();
+}
 
-    mem_arena* arena = plat_mem_reserve(reserve_size);
+static mem_arena* _arena_block_create(u64 reserve_size, u64 commit_size, u32 flags) {
+    arena_huge_pages huge_pages = ARENA_HUGE_PAGES_NONE;
+    mem_arena* block = NULL;
 
-    if (!plat_mem_commit(arena, commit_size)) {
+    if (flags & (ARENA_FLAG_HUGE_PAGES | ARENA_FLAG_HUGETLB)) {
+        block = plat_mem_reserve_huge(reserve_size, (flags & ARENA_FLAG_HUGETLB) != 0, &huge_pages);
+    } else {
+        block = plat_mem_reserve(reserve_size);
+    }
+
+    if (block == NULL) {
         return NULL;
     }
 
-    arena->reserve_size = reserve_size;
-    arena->commit_size = commit_size;
-    arena->pos = ARENA_BASE_POS;
-    arena->commit_pos = commit_size;
+    if (!plat_mem_commit(block, commit_size)) {
+        plat_mem_release(block, reserve_size);
+        return NULL;
+    }
+
+    // Has to happen before the header is written
+    if (flags & ARENA_FLAG_PREFAULT) {
+        plat_mem_prefault(block, commit_size);
+    }
+
+    block->current = block;
+    block->prev = NULL;
+    block->spare = NULL;
+    block->decommit_policy = (arena_decommit_policy){ 0 };
+    block->decommit_interval_pops = 0;
+    block->decommit_interval_peak = 0;
+    block->decommitted_bytes = 0;
+    block->decommit_calls = 0;
+    block->peak_pos = ARENA_BASE_POS;
+    block->peak_used = 0;
+    memset(&block->stats, 0, sizeof(arena_stats));
+    block->stats.num_tags = 1;
+    block->stats.tags[0].name = "untagged";
+#if ARENA_STATS
+    block->stats.commit_calls = 1;
+    block->stats.committed_bytes = commit_size;
+#endif
+    block->reserve_size = reserve_size;
+    block->commit_size = commit_size;
+    block->flags = flags;
+    block->huge_pages = huge_pages;
+    block->base_pos = 0;
+    block->base_used = 0;
+    block->pos = ARENA_BASE_POS;
+    block->commit_pos = commit_size;
+
+    return block;
+}
+
+mem_arena* arena_create(u64 reserve_size, u64 commit_size) {
+    return arena_create_ex(reserve_size, commit_size, ARENA_FLAG_NONE);
+}
+
+mem_arena* arena_create_ex(u64 reserve_size, u64 commit_size, u32 flags) {
+    u64 granularity = _arena_granularity(flags);
 
-    return arena;
+    reserve_size = ALIGN_UP_POW2(reserve_size, granularity);
+    commit_size = ALIGN_UP_POW2(commit_size, granularity);
+    commit_size = MIN(commit_size, reserve_size);
+
+    return _arena_block_create(reserve_size, commit_size, flags);
+}
+
+static void _arena_release_spare(mem_arena* arena) {
+    if (arena->spare != NULL) {
+        plat_mem_release(arena->spare, arena->spare->reserve_size);
+        arena->spare = NULL;
+    }
 }
 
 void arena_destroy(mem_arena* arena) {
-    plat_mem_release(arena, arena->reserve_size);
+    _arena_release_spare(arena);
+
+    mem_arena* block = arena->current;
+
+    while (block != NULL) {
+        mem_arena* prev = block->prev;
+        plat_mem_release(block, block->reserve_size);
+        block = prev;
+    }
 }
 
-void* arena_push(mem_arena* arena, u64 size, b32 non_zero) {
-    u64 pos_aligned = ALIGN_UP_POW2(arena->pos, ARENA_ALIGN);
-    u64 new_pos = pos_aligned + size;
+void arena_set_decommit_policy(mem_arena* arena, arena_decommit_policy policy) {
+    arena->decommit_policy = policy;
+    arena->decommit_interval_pops = 0;
+    arena->decommit_interval_peak = arena_get_pos(arena);
+}
+
+// Chains a block big enough for `size` bytes at `align` after the current one
+static mem_arena* _arena_chain_block(mem_arena* arena, u64 size, u64 align) {
+    mem_arena* current = arena->current;
+    u64 granularity = _arena_granularity(arena->flags);
 
-    if (new_pos > arena->reserve_size) { return NULL; }
+    u64 reserve_size = arena->reserve_size;
+    if (ARENA_BASE_POS + align + size > reserve_size) {
+        reserve_size = ALIGN_UP_POW2(ARENA_BASE_POS + align + size, granularity);
+    }
 
-    if (new_pos > arena->commit_pos) {
-        u64 new_commit_pos = new_pos;
-        new_commit_pos += arena->commit_size - 1;
-        new_commit_pos -= new_commit_pos % arena->commit_size;
-        new_commit_pos = MIN(new_commit_pos, arena->reserve_size);
+    mem_arena* block = arena->spare;
 
-        u8* mem = (u8*)arena + arena->commit_pos;
-        u64 commit_size = new_commit_pos - arena->commit_pos;
+    if (block != NULL && block->reserve_size >= reserve_size) {
+        // Keeps its committed memory, pushes zero it unless asked not to
+        arena->spare = NULL;
+        block->pos = ARENA_BASE_POS;
+    } else {
+        _arena_release_spare(arena);
 
-        if (!plat_mem_commit(mem, commit_size)) {
+        block = _arena_block_create(reserve_size, arena->commit_size, arena->flags);
+        if (block == NULL) {
             return NULL;
         }
 
-        arena->commit_pos = new_commit_pos;
+#if ARENA_STATS
+        arena->stats.commit_calls++;
+        arena->stats.committed_bytes += block->commit_size;
+#endif
     }
 
-    arena->pos = new_pos;
+    block->prev = current;
+    block->base_pos = current->base_pos + current->reserve_size;
+    block->base_used = current->base_used + (current->pos - ARENA_BASE_POS);
+
+#if ARENA_STATS
+    arena->stats.blocks_chained++;
+#endif
+
+    arena->current = block;
+
+    return block;
+}
+
+void* arena_push(mem_arena* arena, u64 size, b32 non_zero) {
+    return arena_push_aligned(arena, size, ARENA_ALIGN, non_zero);
+}
+
+void* arena_push_aligned(mem_arena* arena, u64 size, u64 align, b32 non_zero) {
+    mem_arena* current = arena->current;
 
-    u8* out = (u8*)arena + pos_aligned;
+    // Every block starts on a page boundary, so aligning pos aligns the pointer
+    u64 pos_aligned = ALIGN_UP_POW2(current->pos, align);
+    u64 new_pos = pos_aligned + size;
+
+    if (new_pos > current->commit_pos) {
+        if (new_pos > current->reserve_size) {
+            current = _arena_chain_block(arena, size, align);
+            if (current == NULL) {
+                return NULL;
+            }
+
+            pos_aligned = ALIGN_UP_POW2(current->pos, align);
+            new_pos = pos_aligned + size;
+        }
+
+        if (new_pos > current->commit_pos) {
+            u64 new_commit_pos = new_pos;
+            new_commit_pos += current->commit_size - 1;
+            new_commit_pos -= new_commit_pos % current->commit_size;
+            new_commit_pos = MIN(new_commit_pos, current->reserve_size);
+
+            u8* mem = (u8*)current + current->commit_pos;
+            u64 commit_size = new_commit_pos - current->commit_pos;
+
+            if (!plat_mem_commit(mem, commit_size)) {
+                return NULL;
+            }
+
+            if (current->flags & ARENA_FLAG_PREFAULT) {
+                plat_mem_prefault(mem, commit_size);
+            }
+
+            current->commit_pos = new_commit_pos;
+
+#if ARENA_STATS
+            arena->stats.commit_calls++;
+            arena->stats.committed_bytes += commit_size;
+#endif
+        }
+    }
+
+    current->pos = new_pos;
+
+#if ARENA_STATS
+    arena->stats.tags[arena->stats.tag].bytes += size;
+    arena->stats.tags[arena->stats.tag].pushes++;
+#endif
+
+    u8* out = (u8*)current + pos_aligned;
 
     if (!non_zero) {
         memset(out, 0, size);
@@ -65,24 +218,105 @@ void* arena_push(mem_arena* arena, u64 size, b32 non_zero) {
     return out;
 }
 
+u64 arena_get_pos(mem_arena* arena) {
+    mem_arena* current = arena->current;
+    return current->base_pos + current->pos;
+}
+
+u64 arena_get_peak_pos(mem_arena* arena) {
+    // pos only decreases on pops, so the peak was either seen by a pop or is the current pos
+    return MAX(arena->peak_pos, arena_get_pos(arena));
+}
+
+u64 arena_get_used(mem_arena* arena) {
+    mem_arena* current = arena->current;
+    return current->base_used + (current->pos - ARENA_BASE_POS);
+}
+
+u64 arena_get_peak_used(mem_arena* arena) {
+    return MAX(arena->peak_used, arena_get_used(arena));
+}
+
 void arena_pop(mem_arena* arena, u64 size) {
-    size = MIN(size, arena->pos - ARENA_BASE_POS);
-    arena->pos -= size;
+    u64 pos = arena_get_pos(arena);
+    size = MIN(size, pos - ARENA_BASE_POS);
+    arena_pop_to(arena, pos - size);
+}
+
+// Called on every pop with the position before popping
+static void _arena_decommit_step(mem_arena* arena, u64 old_pos) {
+    arena->decommit_interval_peak = MAX(arena->decommit_interval_peak, old_pos);
+
+    if (++arena->decommit_interval_pops < arena->decommit_policy.interval_pops) {
+        return;
+    }
+
+    mem_arena* current = arena->current;
+
+    // Peaks in released blocks are past the end of current, which keeps everything committed
+    u64 peak = arena->decommit_interval_peak - MIN(arena->decommit_interval_peak, current->base_pos);
+    u64 keep_pos = MAX(peak, current->pos) + arena->decommit_policy.retain_size;
+    keep_pos += current->commit_size - 1;
+    keep_pos -= keep_pos % current->commit_size;
+
+    if (keep_pos < current->commit_pos) {
+        u64 decommit_size = current->commit_pos - keep_pos;
+
+        if (plat_mem_decommit((u8*)current + keep_pos, decommit_size)) {
+            current->commit_pos = keep_pos;
+            arena->decommitted_bytes += decommit_size;
+            arena->decommit_calls++;
+        }
+    }
+
+    // The spare block was not needed during the whole interval
+    if (arena->spare != NULL && arena->decommit_interval_peak <= current->base_pos + current->reserve_size) {
+        arena->decommitted_bytes += arena->spare->commit_pos;
+        arena->decommit_calls++;
+        _arena_release_spare(arena);
+    }
+
+    arena->decommit_interval_pops = 0;
+    arena->decommit_interval_peak = arena_get_pos(arena);
 }
 
 void arena_pop_to(mem_arena* arena, u64 pos) {
-    u64 size = pos < arena->pos ? arena->pos - pos : 0;
-    arena_pop(arena, size);
+    pos = MAX(pos, ARENA_BASE_POS);
+
+    u64 old_pos = arena_get_pos(arena);
+    mem_arena* current = arena->current;
+
+    arena->peak_pos = MAX(arena->peak_pos, old_pos);
+    arena->peak_used = MAX(arena->peak_used, arena_get_used(arena));
+
+    // Blocks that start at or after pos are empty once popped.
+    // The lowest of them becomes the spare, an older spare is released
+    while (current->base_pos >= pos && current->prev != NULL) {
+        mem_arena* prev = current->prev;
+
+        _arena_release_spare(arena);
+        arena->spare = current;
+
+        current = prev;
+    }
+
+    arena->current = current;
+    current->pos = MIN(current->pos, MAX(pos - current->base_pos, ARENA_BASE_POS));
+
+    if (arena->decommit_policy.interval_pops > 0) {
+        _arena_decommit_step(arena, old_pos);
+    }
 }
 
 void arena_clear(mem_arena* arena) {
     arena_pop_to(arena, ARENA_BASE_POS);
+    _arena_release_spare(arena);
 }
 
 mem_arena_temp arena_temp_begin(mem_arena* arena) {
     return (mem_arena_temp) {
         .arena = arena,
-        .start_pos = arena->pos
+        .start_pos = arena_get_pos(arena)
     };
 }
 
@@ -90,44 +324,251 @@ void arena_temp_end(mem_arena_temp temp) {
     arena_pop_to(temp.arena, temp.start_pos);
 }
 
-static __thread mem_arena* _scratch_arenas[2] = { NULL, NULL };
+const char* arena_stats_set_tag(mem_arena* arena, const char* tag) {
+    arena_stats* stats = &arena->stats;
+    const char* prev = stats->tags[stats->tag].name;
 
-mem_arena_temp arena_scratch_get(mem_arena** conflicts, u32 num_conflicts) {
-    i32 scratch_index = -1;
+    if (tag == NULL) {
+        tag = stats->tags[0].name;
+    }
 
-    for (i32 i = 0; i < 2; i++) {
-        b32 conflict_found = false;
+    for (u32 i = 0; i < stats->num_tags; i++) {
+        if (stats->tags[i].name == tag || strcmp(stats->tags[i].name, tag) == 0) {
+            stats->tag = i;
+            return prev;
+        }
+    }
 
-        for (u32 j = 0; j < num_conflicts; j++) {
-            if (_scratch_arenas[i] == conflicts[j]) {
-                conflict_found = true;
-                break;
-            }
+    if (stats->num_tags < ARENA_STATS_MAX_TAGS - 1) {
+        stats->tag = stats->num_tags++;
+        stats->tags[stats->tag].name = tag;
+    } else {
+        stats->num_tags = ARENA_STATS_MAX_TAGS;
+        stats->tag = ARENA_STATS_MAX_TAGS - 1;
+        stats->tags[stats->tag].name = "other";
+    }
+
+    return prev;
+}
+
+void arena_stats_print(mem_arena* arena, FILE* file) {
+    const arena_stats* stats = &arena->stats;
+
+    fprintf(file, "%-24s %14s %12s\n", "tag", "bytes (KiB)", "pushes");
+
+    for (u32 i = 0; i < stats->num_tags; i++) {
+        fprintf(
+            file, "%-24s %14llu %12llu\n", stats->tags[i].name,
+            (unsigned long long)(stats->tags[i].bytes >> 10),
+            (unsigned long long)stats->tags[i].pushes
+        );
+    }
+
+    fprintf(
+        file, "used %llu KiB, peak used %llu KiB, peak pos %llu KiB, %llu blocks chained\n",
+        (unsigned long long)(arena_get_used(arena) >> 10),
+        (unsigned long long)(arena_get_peak_used(arena) >> 10),
+        (unsigned long long)(arena_get_peak_pos(arena) >> 10),
+        (unsigned long long)stats->blocks_chained
+    );
+    fprintf(
+        file, "%llu commits (%llu KiB), %llu decommits (%llu KiB)\n",
+        (unsigned long long)stats->commit_calls,
+        (unsigned long long)(stats->committed_bytes >> 10),
+        (unsigned long long)arena->decommit_calls,
+        (unsigned long long)(arena->decommitted_bytes >> 10)
+    );
+}
+
+static void _stats_print_json_str(FILE* file, const char* str) {
+    fputc('"', file);
+
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+        }
+
+        fputc(*str, file);
+    }
+
+    fputc('"', file);
+}
+
+void arena_stats_print_json(mem_arena* arena, FILE* file) {
+    const arena_stats* stats = &arena->stats;
+
+    fprintf(file, "{\"tags\":[");
+
+    for (u32 i = 0; i < stats->num_tags; i++) {
+        fprintf(file, "%s{\"name\":", i == 0 ? "" : ",");
+        _stats_print_json_str(file, stats->tags[i].name);
+        fprintf(
+            file, ",\"bytes\":%llu,\"pushes\":%llu}",
+            (unsigned long long)stats->tags[i].bytes,
+            (unsigned long long)stats->tags[i].pushes
+        );
+    }
+
+    fprintf(
+        file,
+        "],\"pos\":%llu,\"peak_pos\":%llu,\"used\":%llu,\"peak_used\":%llu,\"blocks_chained\":%llu,"
+        "\"commit_calls\":%llu,\"committed_bytes\":%llu,"
+        "\"decommit_calls\":%llu,\"decommitted_bytes\":%llu}\n",
+        (unsigned long long)arena_get_pos(arena),
+        (unsigned long long)arena_get_peak_pos(arena),
+        (unsigned long long)arena_get_used(arena),
+        (unsigned long long)arena_get_peak_used(arena),
+        (unsigned long long)stats->blocks_chained,
+        (unsigned long long)stats->commit_calls,
+        (unsigned long long)stats->committed_bytes,
+        (unsigned long long)arena->decommit_calls,
+        (unsigned long long)arena->decommitted_bytes
+    );
+}
+
+static arena_scratch_desc _scratch_desc = {
+    .count = 2,
+    .reserve_size = MiB(64),
+    .commit_size = MiB(1),
+    .flags = ARENA_FLAG_NONE
+};
+
+// Scratch arenas of one thread. These outlive the thread,
+// so they are allocated directly from the platform and never freed
+typedef struct _scratch_thread {
+    struct _scratch_thread* next;
+    u32 index;
+    mem_arena* arenas[ARENA_SCRATCH_MAX_COUNT];
+} _scratch_thread;
+
+static _scratch_thread* _scratch_threads = NULL;
+static u32 _scratch_num_threads = 0;
+
+static __thread _scratch_thread* _scratch_this_thread = NULL;
+
+b32 arena_scratch_configure(const arena_scratch_desc* desc) {
+    if (__atomic_load_n(&_scratch_num_threads, __ATOMIC_ACQUIRE) > 0) {
+        fprintf(stderr, "Cannot configure scratch arenas: scratch memory is already in use\n");
+        return false;
+    }
+
+    _scratch_desc = *desc;
+    _scratch_desc.count = MIN(MAX(_scratch_desc.count, 1), ARENA_SCRATCH_MAX_COUNT);
+
+    return true;
+}
+
+static _scratch_thread* _scratch_thread_get(void) {
+    if (_scratch_this_thread != NULL) {
+        return _scratch_this_thread;
+    }
+
+    u64 size = ALIGN_UP_POW2(sizeof(_scratch_thread), plat_get_pagesize());
+
+    _scratch_thread* thread = plat_mem_reserve(size);
+    if (thread == NULL) {
+        return NULL;
+    }
+
+    if (!plat_mem_commit(thread, size)) {
+        plat_mem_release(thread, size);
+        return NULL;
+    }
+
+    memset(thread, 0, sizeof(_scratch_thread));
+    thread->index = __atomic_fetch_add(&_scratch_num_threads, 1, __ATOMIC_RELAXED);
+    thread->next = __atomic_load_n(&_scratch_threads, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(
+        &_scratch_threads, &thread->next, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED
+    )) { }
+
+    _scratch_this_thread = thread;
+
+    return thread;
+}
+
+static b32 _scratch_conflicts(mem_arena* arena, mem_arena** conflicts, u32 num_conflicts) {
+    for (u32 i = 0; i < num_conflicts; i++) {
+        if (arena == conflicts[i]) {
+            return true;
         }
+    }
+
+    return false;
+}
+
+mem_arena_temp arena_scratch_get(mem_arena** conflicts, u32 num_conflicts) {
+    _scratch_thread* thread = _scratch_thread_get();
+    if (thread == NULL) {
+        fprintf(stderr, "Cannot get scratch arena: failed to allocate thread state\n");
+        abort();
+    }
+
+    u32 count = _scratch_desc.count;
+    u32 scratch_index = count;
 
-        if (!conflict_found) {
+    // Created arenas are always a prefix of the array, and a new arena never conflicts
+    for (u32 i = 0; i < count; i++) {
+        mem_arena* arena = thread->arenas[i];
+
+        if (arena == NULL || !_scratch_conflicts(arena, conflicts, num_conflicts)) {
             scratch_index = i;
             break;
         }
     }
 
-    if (scratch_index == -1) {
-        return (mem_arena_temp){ 0 };
+    // Callers dereference the scratch arena, so this cannot be reported by returning an empty temp
+    if (scratch_index == count) {
+        fprintf(stderr, "Cannot get scratch arena: all %u scratch arenas conflict, increase the scratch count\n", count);
+        abort();
     }
 
-    mem_arena** selected = &_scratch_arenas[scratch_index];
+    mem_arena* selected = thread->arenas[scratch_index];
 
-    if (*selected == NULL) {
-        *selected = arena_create(MiB(64), MiB(1));
+    if (selected == NULL) {
+        selected = arena_create_ex(_scratch_desc.reserve_size, _scratch_desc.commit_size, _scratch_desc.flags);
+        if (selected == NULL) {
+            fprintf(stderr, "Cannot get scratch arena: failed to create arena\n");
+            abort();
+        }
+
+        __atomic_store_n(&thread->arenas[scratch_index], selected, __ATOMIC_RELEASE);
     }
 
-    return arena_temp_begin(*selected);
+    return arena_temp_begin(selected);
 }
 
 void arena_scratch_release(mem_arena_temp scratch) {
     arena_temp_end(scratch);
 }
 
+void arena_scratch_dump(FILE* file) {
+    fprintf(file, "%-8s %-8s %16s %14s\n", "thread", "scratch", "peak used (KiB)", "reserve (KiB)");
+
+    _scratch_thread* thread = __atomic_load_n(&_scratch_threads, __ATOMIC_ACQUIRE);
+
+    for (; thread != NULL; thread = thread->next) {
+        for (u32 i = 0; i < ARENA_SCRATCH_MAX_COUNT; i++) {
+            mem_arena* arena = __atomic_load_n(&thread->arenas[i], __ATOMIC_ACQUIRE);
+            if (arena == NULL) {
+                break;
+            }
+
+            // Only first block fields are read, other blocks can be released by their thread at any time
+            // Temps always end with a pop, so peak_used covers every scratch use that finished
+            u64 peak = __atomic_load_n(&arena->peak_used, __ATOMIC_RELAXED);
+
+            fprintf(
+                file, "%-8u %-8u %16llu %14llu\n",
+                thread->index, i,
+                (unsigned long long)(peak >> 10),
+                (unsigned long long)(arena->reserve_size >> 10)
+            );
+        }
+    }
+}
+
 #if defined(_WIN32)
 
 #include <windows.h>
@@ -156,6 +597,25 @@ b32 plat_mem_release(void* ptr, u64 size) {
     return VirtualFree(ptr, size, MEM_RELEASE);
 }
 
+// Large pages on Windows need SeLockMemoryPrivilege and cannot be committed lazily
+void* plat_mem_reserve_huge(u64 size, b32 hugetlb, arena_huge_pages* obtained) {
+    (void)hugetlb;
+    *obtained = ARENA_HUGE_PAGES_NONE;
+
+    return plat_mem_reserve(size);
+}
+
+b32 plat_mem_prefault(void* ptr, u64 size) {
+    u32 pagesize = plat_get_pagesize();
+    volatile u8* mem = (volatile u8*)ptr;
+
+    for (u64 i = 0; i < size; i += pagesize) {
+        mem[i] = 0;
+    }
+
+    return true;
+}
+
 
 #elif defined(__linux__)
 
@@ -163,6 +623,7 @@ b32 plat_mem_release(void* ptr, u64 size) {
 #define _DEFAULT_SOURCE
 #endif
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
@@ -195,6 +656,83 @@ b32 plat_mem_release(void* ptr, u64 size) {
     return ret == 0;
 }
 
+// THP can be disabled system wide, in which case MADV_HUGEPAGE still succeeds
+static b32 _plat_thp_enabled(void) {
+    i32 fd = open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    char buf[64] = { 0 };
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+
+    return len > 0 && strstr(buf, "[never]") == NULL;
+}
+
+void* plat_mem_reserve_huge(u64 size, b32 hugetlb, arena_huge_pages* obtained) {
+    *obtained = ARENA_HUGE_PAGES_NONE;
+
+#ifdef MAP_HUGETLB
+    // Without MAP_NORESERVE this fails up front if the hugetlb pool is too small,
+    // instead of raising SIGBUS on a later fault
+    if (hugetlb) {
+        void* out = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (out != MAP_FAILED) {
+            *obtained = ARENA_HUGE_PAGES_HUGETLB;
+            return out;
+        }
+    }
+#else
+    (void)hugetlb;
+#endif
+
+    // Over reserve and trim, so the block starts on a huge page boundary
+    u64 padded_size = size + ARENA_HUGE_PAGE_SIZE;
+    u8* padded = mmap(NULL, padded_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (padded == MAP_FAILED) {
+        return NULL;
+    }
+
+    u8* out = (u8*)ALIGN_UP_POW2((u64)padded, ARENA_HUGE_PAGE_SIZE);
+    u64 head = (u64)(out - padded);
+    u64 tail = padded_size - head - size;
+
+    if (head > 0) {
+        munmap(padded, head);
+    }
+    if (tail > 0) {
+        munmap(out + size, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(out, size, MADV_HUGEPAGE) == 0 && _plat_thp_enabled()) {
+        *obtained = ARENA_HUGE_PAGES_THP;
+    }
+#endif
+
+    return out;
+}
+
+// MAP_POPULATE does nothing for the PROT_NONE reservation and MADV_WILLNEED
+// does not allocate anonymous memory, so committed ranges are populated here
+b32 plat_mem_prefault(void* ptr, u64 size) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0) {
+        return true;
+    }
+#endif
+
+    u32 pagesize = plat_get_pagesize();
+    volatile u8* mem = (volatile u8*)ptr;
+
+    for (u64 i = 0; i < size; i += pagesize) {
+        mem[i] = 0;
+    }
+
+    return true;
+}
+
 
 #elif defined(__APPLE__)
 
@@ -225,4 +763,24 @@ b32 plat_mem_decommit(void* ptr, u64 size) {
 b32 plat_mem_release(void* ptr, u64 size) {
     return munmap(ptr, size) == 0;
 }
+
+// macOS has no madvise huge page hint, superpages need VM_FLAGS_SUPERPAGE_SIZE_2MB
+// through mach_vm_allocate and are only available on x86
+void* plat_mem_reserve_huge(u64 size, b32 hugetlb, arena_huge_pages* obtained) {
+    (void)hugetlb;
+    *obtained = ARENA_HUGE_PAGES_NONE;
+
+    return plat_mem_reserve(size);
+}
+
+b32 plat_mem_prefault(void* ptr, u64 size) {
+    u32 pagesize = plat_get_pagesize();
+    volatile u8* mem = (volatile u8*)ptr;
+
+    for (u64 i = 0; i < size; i += pagesize) {
+        mem[i] = 0;
+    }
+
+    return true;
+}
 #endif
\ No newline at end of file
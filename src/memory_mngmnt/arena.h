@@ -3,16 +3,108 @@
 //
 #pragma once
 
+#include <stdio.h>
+
 #include "../../include/base.h"
 #define ARENA_BASE_POS (sizeof(mem_arena))
 #define ARENA_ALIGN (sizeof(void*))
+#define ARENA_HUGE_PAGE_SIZE MiB(2)
+
+// Per-arena allocation tags and commit counters, build with -DARENA_STATS=1.
+// Only the bookkeeping depends on it, mem_arena has the same layout either way
+#ifndef ARENA_STATS
+#define ARENA_STATS 0
+#endif
+
+#define ARENA_STATS_MAX_TAGS 16
+
+typedef enum {
+    ARENA_FLAG_NONE = 0,
+    // Align blocks and commits to ARENA_HUGE_PAGE_SIZE and request transparent huge pages
+    ARENA_FLAG_HUGE_PAGES = 1 << 0,
+    // Try explicit huge pages (MAP_HUGETLB) first, falls back to ARENA_FLAG_HUGE_PAGES
+    ARENA_FLAG_HUGETLB = 1 << 1,
+    // Fault in committed memory up front instead of on first touch
+    ARENA_FLAG_PREFAULT = 1 << 2,
+} arena_flags;
+
+// Huge pages that were actually obtained for an arena
+typedef enum {
+    ARENA_HUGE_PAGES_NONE = 0,
+    // madvise(MADV_HUGEPAGE) was accepted and THP is not disabled system wide
+    ARENA_HUGE_PAGES_THP,
+    ARENA_HUGE_PAGES_HUGETLB,
+} arena_huge_pages;
+
+// Decommits memory above the peak position of the last interval, so a single spike
+// does not pin committed memory for the lifetime of the arena
+typedef struct {
+    // Committed bytes kept above the peak, rounded up to commit_size
+    u64 retain_size;
+    // Pops per interval, 0 disables decommitting
+    u32 interval_pops;
+} arena_decommit_policy;
 
 typedef struct {
+    // Has to outlive the arena, usually a string literal
+    const char* name;
+    // Totals pushed while this tag was set, pops are not subtracted
+    u64 bytes;
+    u64 pushes;
+} arena_stats_tag;
+
+typedef struct {
+    u32 tag;
+    u32 num_tags;
+    // The last tag collects everything once the others are in use
+    arena_stats_tag tags[ARENA_STATS_MAX_TAGS];
+
+    u64 commit_calls;
+    u64 committed_bytes;
+    u64 blocks_chained;
+} arena_stats;
+
+// An arena is a chain of reserved blocks, each starting with this header.
+// Callers always use the first block; pushes go to `current`,
+// and a new block is chained when `current` runs out of reserved space.
+// Positions (arena_get_pos, temps) are global: `base_pos + pos` of a block
+typedef struct mem_arena {
+    // Only valid in the first block
+    struct mem_arena* current;
+    struct mem_arena* prev;
+    // Only valid in the first block. The last block released by a pop is kept here
+    // and chained again by the next push that needs a block, so a temp that
+    // crosses a block boundary in a loop does not map and unmap a block every time
+    struct mem_arena* spare;
+
+    arena_decommit_policy decommit_policy;
+    u32 decommit_interval_pops;
+    u64 decommit_interval_peak;
+    // Totals over the lifetime of the arena
+    u64 decommitted_bytes;
+    u64 decommit_calls;
+    // Highest position seen by a pop, see arena_get_peak_pos
+    u64 peak_pos;
+    // Highest arena_get_used seen by a pop, see arena_get_peak_used
+    u64 peak_used;
+
     u64 reserve_size;
     u64 commit_size;
 
+    u32 flags;
+    arena_huge_pages huge_pages;
+
+    // Global position of the start of this block
+    u64 base_pos;
+    // Bytes pushed in the blocks before this one. Positions also count
+    // the unused end of every earlier block, so they overstate memory use
+    u64 base_used;
+    // Positions within this block
     u64 pos;
     u64 commit_pos;
+
+    // Only valid in the first block. Counters stay zero without ARENA_STATS
+    arena_stats stats;
 } mem_arena;
 
 typedef struct {
@@ -21,26 +113,92 @@ typedef struct {
 } mem_arena_temp;
 
 mem_arena* arena_create(u64 reserve_size, u64 commit_size);
+// flags is a combination of arena_flags, check huge_pages on the result for what was obtained
+mem_arena* arena_create_ex(u64 reserve_size, u64 commit_size, u32 flags);
 void arena_destroy(mem_arena* arena);
+void arena_set_decommit_policy(mem_arena* arena, arena_decommit_policy policy);
 void* arena_push(mem_arena* arena, u64 size, b32 non_zero);
+// align must be a power of 2, at most the page size
+void* arena_push_aligned(mem_arena* arena, u64 size, u64 align, b32 non_zero);
+u64 arena_get_pos(mem_arena* arena);
+// Highest position the arena has reached
+u64 arena_get_peak_pos(mem_arena* arena);
+// Bytes pushed and not popped, including alignment padding but not block headers
+u64 arena_get_used(mem_arena* arena);
+// Highest arena_get_used the arena has reached
+u64 arena_get_peak_used(mem_arena* arena);
 void arena_pop(mem_arena* arena, u64 size);
 void arena_pop_to(mem_arena* arena, u64 pos);
+// Also releases the spare block
 void arena_clear(mem_arena* arena);
 
 mem_arena_temp arena_temp_begin(mem_arena* arena);
 void arena_temp_end(mem_arena_temp temp);
 
+#define ARENA_SCRATCH_MAX_COUNT 8
+
+typedef struct {
+    // Scratch arenas per thread, at most ARENA_SCRATCH_MAX_COUNT
+    u32 count;
+    u64 reserve_size;
+    u64 commit_size;
+    // arena_flags
+    u32 flags;
+} arena_scratch_desc;
+
+// Has to be called before any thread uses scratch memory, the scratch getters
+// read the description without synchronization. Returns false and keeps the
+// current description if a thread already has scratch arenas
+b32 arena_scratch_configure(const arena_scratch_desc* desc);
+
+// Aborts if all `count` arenas are in conflicts
 mem_arena_temp arena_scratch_get(mem_arena** conflicts, u32 num_conflicts);
 void arena_scratch_release(mem_arena_temp scratch);
 
+// Writes the peak bytes in use (arena_get_peak_used) of every scratch arena of every thread.
+// Peaks are updated on release, so running threads may be slightly behind
+void arena_scratch_dump(FILE* file);
+
+// Attributes the following pushes to `tag` and returns the previous tag
+const char* arena_stats_set_tag(mem_arena* arena, const char* tag);
+void arena_stats_print(mem_arena* arena, FILE* file);
+void arena_stats_print_json(mem_arena* arena, FILE* file);
+
+#if ARENA_STATS
+
+#define ARENA_STATS_TAG(arena, tag) arena_stats_set_tag((arena), (tag))
+#define ARENA_STATS_PRINT(arena, file) arena_stats_print((arena), (file))
+#define ARENA_STATS_PRINT_JSON(arena, file) arena_stats_print_json((arena), (file))
+
+#else
+
+static inline const char* _arena_stats_tag_nop(mem_arena* arena, const char* tag) {
+    (void)arena;
+    (void)tag;
+    return NULL;
+}
+
+#define ARENA_STATS_TAG(arena, tag) _arena_stats_tag_nop((arena), (tag))
+#define ARENA_STATS_PRINT(arena, file) ((void)(arena), (void)(file))
+#define ARENA_STATS_PRINT_JSON(arena, file) ((void)(arena), (void)(file))
+
+#endif // ARENA_STATS
+
 #define PUSH_STRUCT(arena, T) (T*)arena_push((arena), sizeof(T), false)
 #define PUSH_STRUCT_NZ(arena, T) (T*)arena_push((arena), sizeof(T), true)
 #define PUSH_ARRAY(arena, T, n) (T*)arena_push((arena), sizeof(T) * (n), false)
 #define PUSH_ARRAY_NZ(arena, T, n) (T*)arena_push((arena), sizeof(T) * (n), true)
+#define PUSH_ARRAY_ALIGNED(arena, T, n, align) (T*)arena_push_aligned((arena), sizeof(T) * (n), (align), false)
+#define PUSH_ARRAY_ALIGNED_NZ(arena, T, n, align) (T*)arena_push_aligned((arena), sizeof(T) * (n), (align), true)
 
 u32 plat_get_pagesize(void);
 
 void* plat_mem_reserve(u64 size);
 b32 plat_mem_commit(void* ptr, u64 size);
 b32 plat_mem_decommit(void* ptr, u64 size);
-b32 plat_mem_release(void* ptr, u64 size);
\ No newline at end of file
+b32 plat_mem_release(void* ptr, u64 size);
+
+// size must be a multiple of ARENA_HUGE_PAGE_SIZE, the result is aligned to it
+void* plat_mem_reserve_huge(u64 size, b32 hugetlb, arena_huge_pages* obtained);
+// Faults in committed memory, only call on memory that is still zero
+b32 plat_mem_prefault(void* ptr, u64 size);
@@ -0,0 +1,249 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "modelPlan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "../../memory_mngmnt/arena.h"
+
+typedef struct {
+    matrix* mat;
+
+    // In floats, aligned to MODEL_PLAN_ALIGN
+    u64 size;
+    u64 offset;
+
+    // Inclusive
+    u32 start;
+    u32 end;
+} _plan_interval;
+
+b32 model_plan_var_planned(const model_var* var) {
+    return var->op != MV_OP_CREATE && var->op != MV_OP_NULL &&
+        (var->flags & MV_FLAG_PARAMETER) == 0;
+}
+
+static void _plan_interval_push(
+    _plan_interval* intervals, u32* num_intervals,
+    matrix* mat, u32 start, u32 end
+) {
+    intervals[(*num_intervals)++] = (_plan_interval){
+        .mat = mat,
+        .size = ALIGN_UP_POW2((u64)mat->rows * mat->cols, MODEL_PLAN_ALIGN),
+        .start = start,
+        .end = end
+    };
+}
+
+static int _plan_cmp_size(const void* a, const void* b) {
+    const _plan_interval* ia = *(const _plan_interval**)a;
+    const _plan_interval* ib = *(const _plan_interval**)b;
+
+    if (ia->size != ib->size) {
+        return ia->size > ib->size ? -1 : 1;
+    }
+
+    return ia->start < ib->start ? -1 : (ia->start > ib->start);
+}
+
+static int _plan_cmp_offset(const void* a, const void* b) {
+    const _plan_interval* ia = *(const _plan_interval**)a;
+    const _plan_interval* ib = *(const _plan_interval**)b;
+
+    return ia->offset < ib->offset ? -1 : (ia->offset > ib->offset);
+}
+
+// Greedy by size: largest intervals are placed first, each at the
+// lowest offset that does not overlap an already placed interval that
+// is live at the same time. Returns the buffer size
+static u64 _plan_pack(mem_arena* scratch, _plan_interval* intervals, u32 num_intervals) {
+    _plan_interval** order = PUSH_ARRAY_NZ(scratch, _plan_interval*, num_intervals);
+    _plan_interval** live = PUSH_ARRAY_NZ(scratch, _plan_interval*, num_intervals);
+
+    for (u32 i = 0; i < num_intervals; i++) {
+        order[i] = &intervals[i];
+    }
+
+    qsort(order, num_intervals, sizeof(_plan_interval*), _plan_cmp_size);
+
+    u64 size = 0;
+
+    for (u32 i = 0; i < num_intervals; i++) {
+        _plan_interval* cur = order[i];
+
+        u32 num_live = 0;
+        for (u32 j = 0; j < i; j++) {
+            if (order[j]->start <= cur->end && cur->start <= order[j]->end) {
+                live[num_live++] = order[j];
+            }
+        }
+
+        qsort(live, num_live, sizeof(_plan_interval*), _plan_cmp_offset);
+
+        u64 offset = 0;
+        for (u32 j = 0; j < num_live; j++) {
+            if (offset + cur->size <= live[j]->offset) {
+                break;
+            }
+
+            offset = MAX(offset, live[j]->offset + live[j]->size);
+        }
+
+        cur->offset = offset;
+        size = MAX(size, offset + cur->size);
+    }
+
+    return size;
+}
+
+model_plan model_plan_create(mem_arena* arena, const model_program* prog, b32 with_grads) {
+    model_plan plan = { 0 };
+
+    u32 n = prog->size;
+    if (n == 0) {
+        return plan;
+    }
+
+    u32 num_steps = with_grads ? 2 * n : n;
+
+    mem_arena_temp scratch = arena_scratch_get(&arena, 1);
+
+    u32 max_index = 0;
+    for (u32 i = 0; i < n; i++) {
+        max_index = MAX(max_index, prog->vars[i]->index);
+    }
+
+    // Program position of each var index
+    u32* positions = PUSH_ARRAY_NZ(scratch.arena, u32, max_index + 1);
+    for (u32 i = 0; i <= max_index; i++) {
+        positions[i] = n;
+    }
+    for (u32 i = 0; i < n; i++) {
+        positions[prog->vars[i]->index] = i;
+    }
+
+    u32* val_ends = PUSH_ARRAY_NZ(scratch.arena, u32, n);
+    // Position of the last consumer, which is the first to accumulate into the grad
+    u32* first_writers = PUSH_ARRAY(scratch.arena, u32, n);
+
+    for (u32 i = 0; i < n; i++) {
+        model_var* cur = prog->vars[i];
+
+        val_ends[i] = i;
+
+        if (cur->flags & (MV_FLAG_OUTPUT | MV_FLAG_COST) || i == n - 1) {
+            // Read by the caller after the program runs
+            val_ends[i] = num_steps - 1;
+        }
+    }
+
+    for (u32 i = 0; i < n; i++) {
+        model_var* cur = prog->vars[i];
+        u32 num_inputs = MV_NUM_INPUTS(cur->op);
+
+        b32 backward = with_grads && (cur->flags & MV_FLAG_REQUIRES_GRAD);
+        u32 backward_step = 2 * n - 1 - i;
+
+        // Vals that the backward step of cur reads
+        b32 backward_reads[MODEL_VAR_MAX_INPUTS] = { false, false };
+
+        if (backward) {
+            switch (cur->op) {
+                case MV_OP_RELU: { backward_reads[0] = true; } break;
+                case MV_OP_SOFTMAX: { val_ends[i] = MAX(val_ends[i], backward_step); } break;
+                case MV_OP_MATMUL:
+                case MV_OP_CROSS_ENTROPY: {
+                    backward_reads[0] = true;
+                    backward_reads[1] = true;
+                } break;
+                default: break;
+            }
+        }
+
+        for (u32 k = 0; k < num_inputs; k++) {
+            model_var* input = cur->inputs[k];
+
+            u32 pos = positions[input->index];
+            if (pos >= n) {
+                continue;
+            }
+
+            val_ends[pos] = MAX(val_ends[pos], backward_reads[k] ? backward_step : i);
+
+            if (backward && (input->flags & MV_FLAG_REQUIRES_GRAD)) {
+                first_writers[pos] = MAX(first_writers[pos], i);
+            }
+        }
+    }
+
+    _plan_interval* intervals = PUSH_ARRAY_NZ(scratch.arena, _plan_interval, 2 * n);
+    u32 num_intervals = 0;
+
+    if (with_grads) {
+        plan.grad_clears = PUSH_ARRAY(arena, u8, n);
+    }
+
+    for (u32 i = 0; i < n; i++) {
+        model_var* cur = prog->vars[i];
+
+        if (!model_plan_var_planned(cur)) {
+            continue;
+        }
+
+        _plan_interval_push(intervals, &num_intervals, cur->val, i, val_ends[i]);
+        plan.naive_size += (u64)cur->val->rows * cur->val->cols;
+
+        if (!with_grads || cur->grad == NULL) {
+            continue;
+        }
+
+        u32 grad_end = 2 * n - 1 - i;
+        u32 grad_start = grad_end;
+
+        if (first_writers[i] != 0) {
+            u32 writer = first_writers[i];
+            grad_start = 2 * n - 1 - writer;
+
+            plan.grad_clears[writer] |= prog->vars[writer]->inputs[0] == cur ?
+                MODEL_PLAN_CLEAR_INPUT_0 : MODEL_PLAN_CLEAR_INPUT_1;
+        } else if (i != n - 1) {
+            // Nothing accumulates into it, but its backward step still reads it.
+            // The grad of the last var is filled with ones instead
+            plan.grad_clears[i] |= MODEL_PLAN_CLEAR_SELF;
+        }
+
+        _plan_interval_push(intervals, &num_intervals, cur->grad, grad_start, grad_end);
+        plan.naive_size += (u64)cur->grad->rows * cur->grad->cols;
+    }
+
+    plan.size = _plan_pack(scratch.arena, intervals, num_intervals);
+
+    plan.num_bindings = num_intervals;
+    plan.bindings = PUSH_ARRAY_NZ(arena, model_plan_binding, num_intervals);
+
+    for (u32 i = 0; i < num_intervals; i++) {
+        plan.bindings[i] = (model_plan_binding){
+            .mat = intervals[i].mat,
+            .offset = intervals[i].offset
+        };
+    }
+
+    arena_scratch_release(scratch);
+
+    return plan;
+}
+
+void model_plan_bind(const model_plan* plan) {
+    for (u32 i = 0; i < plan->num_bindings; i++) {
+        plan->bindings[i].mat->data = plan->buffer + plan->bindings[i].offset;
+    }
+}
+
+b32 model_plan_owns(const model_plan* plan, const matrix* mat) {
+    return plan->buffer != NULL &&
+        mat->data >= plan->buffer && mat->data < plan->buffer + plan->size;
+}
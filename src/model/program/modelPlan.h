@@ -0,0 +1,35 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#ifndef MODELPLAN_H
+#define MODELPLAN_H
+#include "../variables/modelVariables.h"
+
+// Vals and grads of computed vars do not get their own storage.
+// model_compile runs a liveness analysis over each program and packs
+// the matrices into one buffer, so matrices that are never live at the
+// same step share memory.
+//
+// A program's step i computes vars[i]. With grads, step 2 * size - 1 - i
+// is the backward step of vars[i], so vals needed by the backward pass
+// stay live until then, and grads only live between their first
+// accumulation and the backward step of their var.
+
+// Offsets are aligned to this many floats
+#define MODEL_PLAN_ALIGN 16
+
+// Grads to zero before a backward step, replacing the up front clear
+#define MODEL_PLAN_CLEAR_INPUT_0 (1 << 0)
+#define MODEL_PLAN_CLEAR_INPUT_1 (1 << 1)
+#define MODEL_PLAN_CLEAR_SELF    (1 << 2)
+
+// Computed vars that are planned, everything else keeps its own storage
+b32 model_plan_var_planned(const model_var* var);
+
+// buffer is left NULL, plans of one model can share a buffer since programs do not overlap
+model_plan model_plan_create(mem_arena* arena, const model_program* prog, b32 with_grads);
+// Points the planned matrices at the plan buffer
+void model_plan_bind(const model_plan* plan);
+b32 model_plan_owns(const model_plan* plan, const matrix* mat);
+#endif //MODELPLAN_H
@@ -10,6 +10,7 @@
 #include <string.h>
 #include "../../random_generators/prng.h"
 #include "../../autograd/autograd.h"
+#include "modelPlan.h"
 
 model_program model_prog_create(
     mem_arena* arena, model_context* model, model_var* out_var
@@ -79,6 +80,8 @@ model_program model_prog_create(
 }
 
 void model_prog_compute(model_program* prog) {
+    model_plan_bind(&prog->plan);
+
     for (u32 i = 0; i < prog->size; i++) {
         model_var* cur = prog->vars[i];
 
@@ -120,6 +123,11 @@ void model_prog_compute_grads(model_program* prog) {
             continue;
         }
 
+        // Planned grads can share memory with live vals, they are cleared at their first use
+        if (model_plan_owns(&prog->plan, cur->grad)) {
+            continue;
+        }
+
         mat_clear(cur->grad);
     }
 
@@ -135,6 +143,14 @@ void model_prog_compute_grads(model_program* prog) {
         model_var* a = cur->inputs[0];
         model_var* b = cur->inputs[1];
 
+        if (prog->plan.grad_clears != NULL) {
+            u8 clears = prog->plan.grad_clears[i];
+
+            if (clears & MODEL_PLAN_CLEAR_SELF) { mat_clear(cur->grad); }
+            if (clears & MODEL_PLAN_CLEAR_INPUT_0) { mat_clear(a->grad); }
+            if (clears & MODEL_PLAN_CLEAR_INPUT_1) { mat_clear(b->grad); }
+        }
+
         u32 num_inputs = MV_NUM_INPUTS(cur->op);
 
         if (
@@ -215,12 +231,61 @@ model_context* model_create(mem_arena* arena) {
     return model;
 }
 
+// Vars that are in no program are never bound to a plan buffer, so they get their own storage
+static void _model_alloc_unscheduled(mem_arena* arena, model_context* model) {
+    mem_arena_temp scratch = arena_scratch_get(&arena, 1);
+
+    b8* scheduled = PUSH_ARRAY(scratch.arena, b8, model->num_vars);
+
+    const model_program* progs[] = { &model->forward_prog, &model->cost_prog };
+    for (u32 p = 0; p < 2; p++) {
+        for (u32 i = 0; i < progs[p]->size; i++) {
+            scheduled[progs[p]->vars[i]->index] = true;
+        }
+    }
+
+    for (model_var* var = model->planned_vars; var != NULL; var = var->next_planned) {
+        if (scheduled[var->index]) {
+            continue;
+        }
+
+        ARENA_STATS_TAG(arena, "activations");
+        var->val->data = PUSH_ARRAY(arena, f32, (u64)var->val->rows * var->val->cols);
+
+        if (var->grad != NULL) {
+            ARENA_STATS_TAG(arena, "gradients");
+            var->grad->data = PUSH_ARRAY(arena, f32, (u64)var->grad->rows * var->grad->cols);
+        }
+    }
+
+    arena_scratch_release(scratch);
+}
+
 void model_compile(mem_arena* arena, model_context* model) {
+    const char* prev_tag = ARENA_STATS_TAG(arena, "programs");
+
     if (model->output != NULL) {
         model->forward_prog = model_prog_create(arena, model, model->output);
+        model->forward_prog.plan = model_plan_create(arena, &model->forward_prog, false);
     }
 
     if (model->cost != NULL) {
         model->cost_prog = model_prog_create(arena, model, model->cost);
+        model->cost_prog.plan = model_plan_create(arena, &model->cost_prog, true);
     }
+
+    model_plan* forward_plan = &model->forward_prog.plan;
+    model_plan* cost_plan = &model->cost_prog.plan;
+
+    // Only one program runs at a time, so both plans share the buffer
+    u64 buffer_size = MAX(forward_plan->size, cost_plan->size);
+
+    ARENA_STATS_TAG(arena, "activations");
+    f32* buffer = PUSH_ARRAY_ALIGNED(arena, f32, buffer_size, MODEL_PLAN_ALIGN * sizeof(f32));
+
+    _model_alloc_unscheduled(arena, model);
+    ARENA_STATS_TAG(arena, prev_tag);
+
+    forward_plan->buffer = buffer;
+    cost_plan->buffer = buffer;
 }
@@ -11,6 +11,7 @@ model_program model_prog_create(
     mem_arena* arena, model_context* model, model_var* out_var
 );
 void model_prog_compute(model_program* prog);
+// prog has to be the last program computed, and its plan has to include grads (cost_prog)
 void model_prog_compute_grads(model_program* prog);
 
 model_context* model_create(mem_arena* arena);
@@ -30,6 +30,18 @@ void model_train(
 
     u32 num_batches = num_examples / training_desc->batch_size;
 
+    const model_plan* forward_plan = &model->forward_prog.plan;
+    const model_plan* cost_plan = &model->cost_prog.plan;
+
+    printf(
+        "Activation memory: forward %.1f KiB (naive %.1f KiB), "
+        "training %.1f KiB (naive %.1f KiB)\n",
+        (f32)(forward_plan->size * sizeof(f32)) / 1024.0f,
+        (f32)(forward_plan->naive_size * sizeof(f32)) / 1024.0f,
+        (f32)(cost_plan->size * sizeof(f32)) / 1024.0f,
+        (f32)(cost_plan->naive_size * sizeof(f32)) / 1024.0f
+    );
+
     mem_arena_temp scratch = arena_scratch_get(NULL, 0);
 
     u32* training_order = PUSH_ARRAY_NZ(scratch.arena, u32, num_examples);
@@ -135,5 +147,25 @@ void model_train(
         );
     }
 
+#if ARENA_STATS
+    if (training_desc->stats_arena != NULL) {
+        printf("Arena stats:\n");
+        ARENA_STATS_PRINT(training_desc->stats_arena, stdout);
+        printf("Scratch arena stats:\n");
+        ARENA_STATS_PRINT(scratch.arena, stdout);
+
+        if (training_desc->stats_json_path != NULL) {
+            FILE* file = fopen(training_desc->stats_json_path, "w");
+
+            if (file != NULL) {
+                ARENA_STATS_PRINT_JSON(training_desc->stats_arena, file);
+                fclose(file);
+            } else {
+                fprintf(stderr, "Cannot write arena stats to %s\n", training_desc->stats_json_path);
+            }
+        }
+    }
+#endif
+
     arena_scratch_release(scratch);
 }
\ No newline at end of file
@@ -11,19 +11,45 @@
 
 #include "../../memory_mngmnt/arena.h"
 
-model_var* mv_create(
+// Data of computed vars is assigned by model_compile, see modelPlan.h
+static matrix* _mv_planned_mat_create(mem_arena* arena, u32 rows, u32 cols) {
+    matrix* out = PUSH_STRUCT(arena, matrix);
+
+    out->rows = rows;
+    out->cols = cols;
+
+    return out;
+}
+
+static model_var* _mv_create_impl(
     mem_arena* arena, model_context* model,
-    u32 rows, u32 cols, u32 flags
+    u32 rows, u32 cols, u32 flags, b32 planned
 ) {
+    const char* prev_tag = ARENA_STATS_TAG(arena, "model_vars");
+
     model_var* out = PUSH_STRUCT(arena, model_var);
 
     out->index = model->num_vars++;
     out->flags = flags;
     out->op = MV_OP_CREATE;
-    out->val = mat_create(arena, rows, cols);
+
+    ARENA_STATS_TAG(arena, (flags & MV_FLAG_PARAMETER) ? "parameters" : "activations");
+    out->val = planned ?
+        _mv_planned_mat_create(arena, rows, cols) :
+        mat_create(arena, rows, cols);
 
     if (flags & MV_FLAG_REQUIRES_GRAD) {
-        out->grad = mat_create(arena, rows, cols);
+        ARENA_STATS_TAG(arena, "gradients");
+        out->grad = planned ?
+            _mv_planned_mat_create(arena, rows, cols) :
+            mat_create(arena, rows, cols);
+    }
+
+    ARENA_STATS_TAG(arena, prev_tag);
+
+    if (planned) {
+        out->next_planned = model->planned_vars;
+        model->planned_vars = out;
     }
 
     if (flags & MV_FLAG_INPUT) { model->input = out; }
@@ -34,6 +60,13 @@ model_var* mv_create(
     return out;
 }
 
+model_var* mv_create(
+    mem_arena* arena, model_context* model,
+    u32 rows, u32 cols, u32 flags
+) {
+    return _mv_create_impl(arena, model, rows, cols, flags, false);
+}
+
 model_var* _mv_unary_impl(
     mem_arena* arena, model_context* model,
     model_var* input, u32 rows, u32 cols,
@@ -43,7 +76,10 @@ model_var* _mv_unary_impl(
         flags |= MV_FLAG_REQUIRES_GRAD;
     }
 
-    model_var* out = mv_create(arena, model, rows, cols, flags);
+    model_var* out = _mv_create_impl(
+        arena, model, rows, cols, flags,
+        (flags & MV_FLAG_PARAMETER) == 0
+    );
 
     out->op = op;
     out->inputs[0] = input;
@@ -64,7 +100,10 @@ model_var* _mv_binary_impl(
         flags |= MV_FLAG_REQUIRES_GRAD;
     }
 
-    model_var* out = mv_create(arena, model, rows, cols, flags);
+    model_var* out = _mv_create_impl(
+        arena, model, rows, cols, flags,
+        (flags & MV_FLAG_PARAMETER) == 0
+    );
 
     out->op = op;
     out->inputs[0] = a;
@@ -47,11 +47,37 @@ typedef struct model_var {
 
     model_var_op op;
     struct model_var* inputs[MODEL_VAR_MAX_INPUTS];
+
+    // Next var in model_context.planned_vars
+    struct model_var* next_planned;
 } model_var;
 
+typedef struct {
+    matrix* mat;
+    // In floats from the start of the plan buffer
+    u64 offset;
+} model_plan_binding;
+
+// Storage of computed vars for one program, see modelPlan.h
+typedef struct {
+    f32* buffer;
+
+    u32 num_bindings;
+    model_plan_binding* bindings;
+
+    // MODEL_PLAN_CLEAR_* flags per program position, NULL if grads are not planned
+    u8* grad_clears;
+
+    // In floats. naive_size is the total without sharing, model_train prints both
+    u64 size;
+    u64 naive_size;
+} model_plan;
+
 typedef struct {
     model_var** vars;
     u32 size;
+
+    model_plan plan;
 } model_program;
 
 typedef struct {
@@ -62,6 +88,10 @@ typedef struct {
     model_var* desired_output;
     model_var* cost;
 
+    // Every var created without storage, newest first.
+    // model_compile gives storage to the ones that no program computes
+    model_var* planned_vars;
+
     model_program forward_prog;
     model_program cost_prog;
 } model_context;
@@ -75,6 +105,11 @@ typedef struct {
     u32 epochs;
     u32 batch_size;
     f32 learning_rate;
+
+    // Arena stats are printed after training when built with ARENA_STATS (optional)
+    mem_arena* stats_arena;
+    // Also writes the stats as JSON to this file (optional)
+    const char* stats_json_path;
 } model_training_desc;
 
 model_var* mv_create(
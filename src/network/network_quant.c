@@ -0,0 +1,145 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/network.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+
+static b32 _network_layer_quantizable(const layer* l) {
+    return l->type == LAYER_DENSE || l->type == LAYER_CONV_2D;
+}
+
+b32 network_quantize(mg_arena* arena, network* nn, const tensor* calibration_inputs) {
+    if (nn->training_mode) {
+        ERR(ERR_INVALID_INPUT, "Cannot quantize network: network is in training mode");
+        return false;
+    }
+
+    if (calibration_inputs == NULL || calibration_inputs->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot quantize network: calibration inputs must be an f32 tensor");
+        return false;
+    }
+
+    // Calibration runs the f32 layers
+    for (u32 i = 0; i < nn->num_layers; i++) {
+        layer* l = nn->layers[i];
+
+        if (l->type == LAYER_DENSE) {
+            l->dense_backend.quant_weight = NULL;
+        } else if (l->type == LAYER_CONV_2D) {
+            l->conv_2d_backend.quant_kernels = NULL;
+        }
+    }
+
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    f32* mins = MGA_PUSH_ZERO_ARRAY(scratch.arena, f32, nn->num_layers);
+    f32* maxs = MGA_PUSH_ZERO_ARRAY(scratch.arena, f32, nn->num_layers);
+
+    tensor* in_out = tensor_create_alloc_uninit(scratch.arena, (tensor_shape){ 1, 1, 1 }, nn->max_layer_size);
+    tensor input_view = { 0 };
+
+    for (u32 z = 0; z < calibration_inputs->shape.depth; z++) {
+        tensor_2d_view(&input_view, calibration_inputs, z);
+        tensor_copy_ip(in_out, &input_view);
+
+        for (u32 i = 0; i < nn->num_layers; i++) {
+            if (_network_layer_quantizable(nn->layers[i])) {
+                u64 size = (u64)in_out->shape.width * in_out->shape.height * in_out->shape.depth;
+                const f32* data = (const f32*)in_out->data;
+
+                for (u64 j = 0; j < size; j++) {
+                    mins[i] = MIN(mins[i], data[j]);
+                    maxs[i] = MAX(maxs[i], data[j]);
+                }
+            }
+
+            layer_feedforward(nn->layers[i], in_out, NULL);
+        }
+    }
+
+    b32 out = true;
+
+    for (u32 i = 0; i < nn->num_layers && out; i++) {
+        if (_network_layer_quantizable(nn->layers[i])) {
+            out = layer_quantize(arena, nn->layers[i], tensor_quant_params_from_range(mins[i], maxs[i]));
+        }
+    }
+
+    mga_scratch_release(scratch);
+
+    return out;
+}
+
+void network_feedforward_quantized(const network* nn, tensor* out, const tensor* input) {
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    tensor* in_out = tensor_create_alloc_uninit(scratch.arena, input->shape, nn->max_layer_size);
+    tensor_copy_ip(in_out, input);
+
+    for (u32 i = 0; i < nn->num_layers; i++) {
+        if (!layer_quant_feedforward(nn->layers[i], in_out)) {
+            layer_feedforward(nn->layers[i], in_out, NULL);
+        }
+    }
+
+    tensor_copy_ip(out, in_out);
+
+    mga_scratch_release(scratch);
+}
+
+void network_quant_save(const network* nn, string8 file_name) {
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    tensor_list list = { 0 };
+
+    for (u32 i = 0; i < nn->num_layers; i++) {
+        layer_quant_save(scratch.arena, nn->layers[i], &list, i);
+    }
+
+    tensor_list_save(&list, file_name);
+
+    mga_scratch_release(scratch);
+}
+
+b32 network_quant_load(mg_arena* arena, network* nn, string8 file_name) {
+    if (nn->training_mode) {
+        ERR(ERR_INVALID_INPUT, "Cannot load quantized weights: network is in training mode");
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    tensor_list list = tensor_list_load(scratch.arena, file_name);
+
+    b32 loaded = false;
+
+    for (u32 i = 0; i < nn->num_layers; i++) {
+        loaded |= layer_quant_load(arena, nn->layers[i], &list, i);
+    }
+
+    mga_scratch_release(scratch);
+
+    return loaded;
+}
+
+network* network_load_quantized(
+    mg_arena* arena, string8 file_name, string8 quant_file_name, const tensor* calibration_inputs
+) {
+    network* nn = network_load(arena, file_name, false);
+    if (nn == NULL) {
+        return NULL;
+    }
+
+    if (quant_file_name.size != 0 && network_quant_load(arena, nn, quant_file_name)) {
+        return nn;
+    }
+
+    if (!network_quantize(arena, nn, calibration_inputs)) {
+        return NULL;
+    }
+
+    return nn;
+}
@@ -0,0 +1,13 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/optimizers.h"
+
+void param_change_add_sparse(param_change* param_change, const tensor* x, const tensor_sparse* d) {
+    mutex_lock(param_change->_mutex);
+
+    tensor_outer_sparse_add_ip(param_change->_change, x, d);
+
+    mutex_unlock(param_change->_mutex);
+}
@@ -0,0 +1,706 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "conv.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../../include/err.h"
+#include "../mg/mg_arena.h"
+#include "elementwise.h"
+#include "gemm.h"
+#include "overlap.h"
+#include "parallel.h"
+#include "qgemm.h"
+
+// Upper bound on the column block built by the data gradient, in f32s (1 MiB)
+#define _CONV_COL_BLOCK_SIZE (1 << 18)
+// Smallest col2im block (in column matrix elements) that gets split across threads
+#define _CONV_PARALLEL_MIN_WORK (1 << 16)
+
+typedef struct {
+    const f32* data;
+    // Distance between input rows and channels in f32s, so the input can be a `tensor_view`
+    u64 row_stride;
+    u64 slice_stride;
+
+    u32 in_width;
+    u32 in_height;
+    u32 in_channels;
+
+    u32 kernel_size;
+    u32 stride;
+    u32 padding;
+
+    u32 out_width;
+    u32 out_height;
+} _conv_geom;
+
+static b32 _conv_geom_init(
+    _conv_geom* geom, tensor_shape in_shape, const f32* data,
+    u32 kernel_size, u32 stride, u32 padding
+) {
+    if (kernel_size == 0 || stride == 0) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: kernel_size and stride must be at least 1");
+        return false;
+    }
+
+    if (in_shape.width + 2 * padding < kernel_size || in_shape.height + 2 * padding < kernel_size) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: kernel is larger than padded input");
+        return false;
+    }
+
+    *geom = (_conv_geom){
+        .data = data,
+        .row_stride = in_shape.width,
+        .slice_stride = (u64)in_shape.width * in_shape.height,
+        .in_width = in_shape.width,
+        .in_height = in_shape.height,
+        .in_channels = in_shape.depth,
+        .kernel_size = kernel_size,
+        .stride = stride,
+        .padding = padding,
+        .out_width = (in_shape.width + 2 * padding - kernel_size) / stride + 1,
+        .out_height = (in_shape.height + 2 * padding - kernel_size) / stride + 1,
+    };
+
+    return true;
+}
+
+static b32 _conv_view_overlaps(const tensor* a, const tensor_view* b) {
+    const f32* b_start = (const f32*)b->data;
+    const f32* b_end = b_start + (u64)(b->shape.depth - 1) * b->slice_stride +
+        (u64)(b->shape.height - 1) * b->row_stride + b->shape.width;
+
+    return tensor_overlaps_range(a, b_start, b_end);
+}
+
+// Packs op(B) = im2col(input): rows are (channel, ky, kx), columns are output pixels
+static void _conv_pack_cols(void* ctx, f32* bp, u32 p0, u32 kc, u32 j0, u32 nc) {
+    const _conv_geom* g = (const _conv_geom*)ctx;
+
+    u32 kk = g->kernel_size * g->kernel_size;
+
+    i32 base_x[GEMM_NR];
+    i32 base_y[GEMM_NR];
+
+    for (u32 jr = 0; jr < nc; jr += GEMM_NR) {
+        u32 nr = MIN(GEMM_NR, nc - jr);
+
+        for (u32 j = 0; j < nr; j++) {
+            u32 q = j0 + jr + j;
+            base_x[j] = (i32)((q % g->out_width) * g->stride) - (i32)g->padding;
+            base_y[j] = (i32)((q / g->out_width) * g->stride) - (i32)g->padding;
+        }
+
+        for (u32 p = 0; p < kc; p++) {
+            u32 r = p0 + p;
+            u32 c = r / kk;
+            i32 ky = (i32)((r % kk) / g->kernel_size);
+            i32 kx = (i32)(r % g->kernel_size);
+
+            const f32* plane = g->data + c * g->slice_stride;
+            f32* dst = bp + (u64)p * GEMM_NR;
+
+            u32 j = 0;
+            for (; j < nr; j++) {
+                i32 x = base_x[j] + kx;
+                i32 y = base_y[j] + ky;
+
+                b32 in_bounds = x >= 0 && y >= 0 && x < (i32)g->in_width && y < (i32)g->in_height;
+                dst[j] = in_bounds ? plane[(u32)x + (u64)(u32)y * g->row_stride] : 0.0f;
+            }
+            for (; j < GEMM_NR; j++) { dst[j] = 0.0f; }
+        }
+
+        bp += (u64)kc * GEMM_NR;
+    }
+}
+
+// Packs op(B) = im2col(input)^T: rows are output pixels, columns are (channel, ky, kx)
+static void _conv_pack_cols_t(void* ctx, f32* bp, u32 p0, u32 kc, u32 j0, u32 nc) {
+    const _conv_geom* g = (const _conv_geom*)ctx;
+
+    u32 kk = g->kernel_size * g->kernel_size;
+
+    const f32* planes[GEMM_NR];
+    i32 off_x[GEMM_NR];
+    i32 off_y[GEMM_NR];
+
+    for (u32 jr = 0; jr < nc; jr += GEMM_NR) {
+        u32 nr = MIN(GEMM_NR, nc - jr);
+
+        for (u32 j = 0; j < nr; j++) {
+            u32 r = j0 + jr + j;
+            planes[j] = g->data + (r / kk) * g->slice_stride;
+            off_x[j] = (i32)(r % g->kernel_size);
+            off_y[j] = (i32)((r % kk) / g->kernel_size);
+        }
+
+        for (u32 p = 0; p < kc; p++) {
+            u32 q = p0 + p;
+            i32 bx = (i32)((q % g->out_width) * g->stride) - (i32)g->padding;
+            i32 by = (i32)((q / g->out_width) * g->stride) - (i32)g->padding;
+
+            f32* dst = bp + (u64)p * GEMM_NR;
+
+            u32 j = 0;
+            for (; j < nr; j++) {
+                i32 x = bx + off_x[j];
+                i32 y = by + off_y[j];
+
+                b32 in_bounds = x >= 0 && y >= 0 && x < (i32)g->in_width && y < (i32)g->in_height;
+                dst[j] = in_bounds ? planes[j][(u32)x + (u64)(u32)y * g->row_stride] : 0.0f;
+            }
+            for (; j < GEMM_NR; j++) { dst[j] = 0.0f; }
+        }
+
+        bp += (u64)kc * GEMM_NR;
+    }
+}
+
+// Scatter adds a block of columns [q0, q0 + num_cols) back into the image (col2im)
+typedef struct {
+    const _conv_geom* geom;
+    f32* image;
+
+    // Rows of the column matrix, starting at output pixel q0
+    const f32* cols;
+    u32 ld_cols;
+    u32 q0;
+    u32 num_cols;
+
+    // Clears each channel right before the first scatter into it
+    b32 zero;
+} _conv_col2im_args;
+
+// Scatter-adds rows of channels [c0, c1), so ranges of channels never write the same pixel
+static void _conv_col2im_channels(void* ctx, u32 c0, u32 c1) {
+    const _conv_col2im_args* args = (const _conv_col2im_args*)ctx;
+    const _conv_geom* g = args->geom;
+
+    const elementwise_kernels* ew = elementwise_kernels_get();
+
+    u32 kk = g->kernel_size * g->kernel_size;
+    u64 plane_size = (u64)g->in_width * g->in_height;
+    u32 q_end = args->q0 + args->num_cols;
+
+    for (u32 c = c0; c < c1; c++) {
+        f32* plane = args->image + c * plane_size;
+
+        if (args->zero) {
+            memset(plane, 0, sizeof(f32) * plane_size);
+        }
+
+        for (u32 r = c * kk; r < (c + 1) * kk; r++) {
+            i32 ky = (i32)((r % kk) / g->kernel_size);
+            i32 kx = (i32)(r % g->kernel_size);
+
+            // Output pixels ox with 0 <= ox * stride - padding + kx < in_width
+            i32 x_off = kx - (i32)g->padding;
+            i32 x_last = (i32)g->in_width - 1 - x_off;
+            u32 ox_min = x_off >= 0 ? 0 : ((u32)(-x_off) + g->stride - 1) / g->stride;
+            u32 ox_max = x_last < 0 ? 0 : MIN(g->out_width, (u32)x_last / g->stride + 1);
+
+            const f32* row = args->cols + (u64)r * args->ld_cols;
+
+            // One output row at a time, the first and last ones can be partial
+            for (u32 q = args->q0; q < q_end;) {
+                u32 oy = q / g->out_width;
+                u32 ox_start = q % g->out_width;
+                u32 ox_end = MIN(g->out_width, ox_start + (q_end - q));
+                u32 row_start = q - ox_start;
+                q = row_start + ox_end;
+
+                i32 y = (i32)(oy * g->stride) - (i32)g->padding + ky;
+                if (y < 0 || y >= (i32)g->in_height) {
+                    continue;
+                }
+
+                u32 lo = MAX(ox_start, ox_min);
+                u32 hi = MIN(ox_end, ox_max);
+                if (lo >= hi) {
+                    continue;
+                }
+
+                f32* dst = plane + (u64)(u32)y * g->in_width;
+                // Column of output pixel (lo, oy)
+                const f32* src = row + (row_start + lo - args->q0);
+
+                if (g->stride == 1) {
+                    // Consecutive output pixels hit consecutive input pixels
+                    f32* d = dst + (u32)((i32)lo + x_off);
+                    ew->add(d, d, src, hi - lo);
+                } else {
+                    for (u32 ox = lo; ox < hi; ox++) {
+                        dst[(u32)((i32)(ox * g->stride) + x_off)] += src[ox - lo];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Adds (or writes, if zero is set) the column matrix block into `image`, split by channel across threads
+static void _conv_col2im(
+    const _conv_geom* g, f32* image,
+    const f32* cols, u32 ld_cols, u32 q0, u32 num_cols, b32 zero
+) {
+    _conv_col2im_args args = {
+        .geom = g,
+        .image = image,
+        .cols = cols,
+        .ld_cols = ld_cols,
+        .q0 = q0,
+        .num_cols = num_cols,
+        .zero = zero
+    };
+
+    u64 work = (u64)g->kernel_size * g->kernel_size * g->in_channels * num_cols;
+
+    if (work < _CONV_PARALLEL_MIN_WORK) {
+        _conv_col2im_channels(&args, 0, g->in_channels);
+    } else {
+        parallel_for(g->in_channels, _conv_col2im_channels, &args);
+    }
+}
+
+// Either `kernels` or `packed_kernels` is NULL. `aliased` is true if `out` overlaps the input
+static void _conv_forward(
+    tensor* out, b32 aliased, const _conv_geom* geom,
+    const void* kernels, tensor_dtype kernels_dtype, const f32* packed_kernels, u32 out_channels
+) {
+    u32 k = geom->kernel_size * geom->kernel_size * geom->in_channels;
+    u32 num_pixels = geom->out_width * geom->out_height;
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // Layers convolve in place on `in_out`
+    f32* c = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, (u64)num_pixels * out_channels) : (f32*)out->data;
+
+    if (packed_kernels == NULL) {
+        gemm_mixed_custom_b(
+            false, out_channels, num_pixels, k,
+            kernels, kernels_dtype, k,
+            _conv_pack_cols, (void*)geom,
+            c, num_pixels, false
+        );
+    } else {
+        gemm_f32_packed_a_custom_b(
+            out_channels, num_pixels, k,
+            packed_kernels,
+            _conv_pack_cols, (void*)geom,
+            c, num_pixels, false
+        );
+    }
+
+    if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * (u64)num_pixels * out_channels);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ geom->out_width, geom->out_height, out_channels };
+}
+
+b32 conv_2d_forward_ip(
+    tensor* out, const tensor* input, const tensor* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+) {
+    if (input->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: input must be f32");
+        return false;
+    }
+
+    tensor_view view = tensor_view_from(input);
+
+    return conv_2d_forward_view_ip(out, &view, kernels, kernel_size, stride, padding);
+}
+
+b32 conv_2d_forward_view_ip(
+    tensor* out, const tensor_view* input, const tensor* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+) {
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, input->shape, (const f32*)input->data, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    geom.row_stride = input->row_stride;
+    geom.slice_stride = input->slice_stride;
+
+    u32 out_channels = kernels->shape.depth;
+    u32 num_pixels = geom.out_width * geom.out_height;
+
+    if (out->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: out must be f32");
+        return false;
+    }
+
+    if (kernels->shape.width != kernel_size * kernel_size || kernels->shape.height != geom.in_channels) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: kernels do not match input channels and kernel_size");
+        return false;
+    }
+
+    if (out->alloc < (u64)num_pixels * out_channels) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot convolve: not enough space in out");
+#endif
+        return false;
+    }
+
+    _conv_forward(out, _conv_view_overlaps(out, input), &geom, kernels->data, kernels->dtype, NULL, out_channels);
+
+    return true;
+}
+
+tensor_packed* conv_2d_pack_kernels(mg_arena* arena, const tensor* kernels) {
+    u32 k = kernels->shape.width * kernels->shape.height;
+    u32 out_channels = kernels->shape.depth;
+
+    tensor_packed* out = MGA_PUSH_ZERO_STRUCT(arena, tensor_packed);
+    out->rows = out_channels;
+    out->cols = k;
+    out->left = true;
+    out->data = MGA_PUSH_ARRAY_ALIGNED(arena, f32, gemm_packed_a_size(out_channels, k), TENSOR_ALIGN);
+
+    // Each output channel is one contiguous row of the kernel matrix
+    gemm_pack_a_full_mixed(out->data, false, out_channels, k, kernels->data, kernels->dtype, k);
+
+    return out;
+}
+
+b32 conv_2d_forward_packed_ip(
+    tensor* out, const tensor* input, const tensor_packed* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+) {
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, input->shape, (const f32*)input->data, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    u32 out_channels = kernels->rows;
+    u32 num_pixels = geom.out_width * geom.out_height;
+
+    if (out->dtype != TENSOR_DTYPE_F32 || input->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: out and input must be f32");
+        return false;
+    }
+
+    if (!kernels->left || kernels->cols != kernel_size * kernel_size * geom.in_channels) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: packed kernels do not match input channels and kernel_size");
+        return false;
+    }
+
+    if (out->alloc < (u64)num_pixels * out_channels) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot convolve: not enough space in out");
+#endif
+        return false;
+    }
+
+    _conv_forward(out, tensor_overlaps(out, input), &geom, NULL, TENSOR_DTYPE_F32, kernels->data, out_channels);
+
+    return true;
+}
+
+tensor_quantized* conv_2d_quantize_kernels(mg_arena* arena, const tensor* kernels) {
+    // Output channels are the rows of the kernel matrix, but the columns of the quantized one
+    tensor matrix = *kernels;
+    matrix.shape = (tensor_shape){ kernels->shape.width * kernels->shape.height, kernels->shape.depth, 1 };
+
+    return tensor_quantize(arena, &matrix, true);
+}
+
+typedef struct {
+    const _conv_geom* geom;
+    // Quantized input, with the same layout as the f32 input
+    const u8* image;
+    u8 zero_point;
+} _conv_quant_ctx;
+
+// Fills rows of A = im2col(input)^T: rows are output pixels, columns are (channel, ky, kx)
+static void _conv_quant_pack_a(void* ctx, u8* a, u32 lda, u32 i0, u32 rows) {
+    const _conv_quant_ctx* q = (const _conv_quant_ctx*)ctx;
+    const _conv_geom* g = q->geom;
+
+    for (u32 r = 0; r < rows; r++) {
+        u32 pixel = i0 + r;
+        i32 base_x = (i32)((pixel % g->out_width) * g->stride) - (i32)g->padding;
+        i32 base_y = (i32)((pixel / g->out_width) * g->stride) - (i32)g->padding;
+
+        u8* dst = a + (u64)r * lda;
+
+        for (u32 c = 0; c < g->in_channels; c++) {
+            const u8* plane = q->image + c * g->slice_stride;
+
+            for (u32 ky = 0; ky < g->kernel_size; ky++) {
+                i32 y = base_y + (i32)ky;
+                b32 row_in_bounds = y >= 0 && y < (i32)g->in_height;
+
+                for (u32 kx = 0; kx < g->kernel_size; kx++) {
+                    i32 x = base_x + (i32)kx;
+
+                    b32 in_bounds = row_in_bounds && x >= 0 && x < (i32)g->in_width;
+                    *(dst++) = in_bounds ? plane[(u32)x + (u64)(u32)y * g->row_stride] : q->zero_point;
+                }
+            }
+        }
+    }
+}
+
+b32 conv_2d_forward_quantized_ip(
+    tensor* out, const tensor* input, tensor_quant_params input_params,
+    const tensor_quantized* kernels, u32 kernel_size, u32 stride, u32 padding
+) {
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, input->shape, (const f32*)input->data, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    u32 k = kernel_size * kernel_size * geom.in_channels;
+    u32 out_channels = kernels->cols;
+    u32 num_pixels = geom.out_width * geom.out_height;
+
+    if (out->dtype != TENSOR_DTYPE_F32 || input->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: out and input must be f32");
+        return false;
+    }
+
+    if (kernels->rows != k) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: quantized kernels do not match input channels and kernel_size");
+        return false;
+    }
+
+    if (out->alloc < (u64)num_pixels * out_channels) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot convolve: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // The input is fully quantized before anything is written, so out can alias it
+    u64 in_size = geom.slice_stride * geom.in_channels;
+    u8* image = MGA_PUSH_ARRAY(scratch.arena, u8, in_size);
+    qgemm_quantize_a(image, (const f32*)input->data, in_size, input_params.scale, input_params.zero_point);
+
+    _conv_quant_ctx ctx = {
+        .geom = &geom,
+        .image = image,
+        .zero_point = (u8)input_params.zero_point
+    };
+
+    // Rows of C are output pixels, so C is stored transposed to get channel major output
+    qgemm_desc desc = {
+        .m = num_pixels, .n = out_channels, .k = k,
+        .pack_a = _conv_quant_pack_a,
+        .pack_a_ctx = &ctx,
+        .a_scale = input_params.scale,
+        .a_zero_point = input_params.zero_point,
+        .packed_b = kernels->data,
+        .b_col_sums = kernels->col_sums,
+        .b_scales = kernels->scales,
+        .c = (f32*)out->data,
+        .ldc = num_pixels,
+        .transpose_c = true
+    };
+
+    qgemm_u8s8(&desc);
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ geom.out_width, geom.out_height, out_channels };
+
+    return true;
+}
+
+b32 conv_col2im_ip(
+    tensor* out, const tensor* cols, tensor_shape out_shape,
+    u32 kernel_size, u32 stride, u32 padding, b32 accumulate
+) {
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, out_shape, NULL, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    u32 k = kernel_size * kernel_size * geom.in_channels;
+    u32 num_pixels = geom.out_width * geom.out_height;
+    u64 out_size = (u64)out_shape.width * out_shape.height * out_shape.depth;
+
+    if (cols->shape.width != num_pixels || cols->shape.height != k || cols->shape.depth != 1) {
+        ERR(ERR_BAD_SHAPE, "Cannot col2im: input does not match out_shape, kernel_size, stride and padding");
+        return false;
+    }
+
+    if (out->dtype != TENSOR_DTYPE_F32 || cols->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot col2im: out and cols must be f32");
+        return false;
+    }
+
+    if (out->alloc < out_size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot col2im: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    b32 aliased = tensor_overlaps(out, cols);
+    f32* image = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, out_size) : (f32*)out->data;
+
+    if (aliased && accumulate) {
+        memcpy(image, out->data, sizeof(f32) * out_size);
+    }
+
+    _conv_col2im(&geom, image, (const f32*)cols->data, num_pixels, 0, num_pixels, !accumulate);
+
+    if (aliased) {
+        memcpy(out->data, image, sizeof(f32) * out_size);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = out_shape;
+
+    return true;
+}
+
+b32 conv_2d_backward_data_ip(
+    tensor* delta_in, const tensor* delta_out, const tensor* kernels,
+    tensor_shape in_shape, u32 kernel_size, u32 stride, u32 padding,
+    b32 accumulate
+) {
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, in_shape, NULL, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    u32 k = kernel_size * kernel_size * geom.in_channels;
+    u32 out_channels = kernels->shape.depth;
+    u32 num_pixels = geom.out_width * geom.out_height;
+    u64 in_size = (u64)in_shape.width * in_shape.height * in_shape.depth;
+
+    if (kernels->shape.width != kernel_size * kernel_size || kernels->shape.height != geom.in_channels) {
+        ERR(ERR_BAD_SHAPE, "Cannot compute conv data gradient: kernels do not match input channels and kernel_size");
+        return false;
+    }
+
+    if (
+        delta_out->shape.width != geom.out_width ||
+        delta_out->shape.height != geom.out_height ||
+        delta_out->shape.depth != out_channels
+    ) {
+        ERR(ERR_BAD_SHAPE, "Cannot compute conv data gradient: delta_out does not match the output shape");
+        return false;
+    }
+
+    // Kernels can be half like in the forward pass, the deltas cannot
+    if (delta_in->dtype != TENSOR_DTYPE_F32 || delta_out->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot compute conv data gradient: delta_in and delta_out must be f32");
+        return false;
+    }
+
+    if (delta_in->alloc < in_size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot compute conv data gradient: not enough space in delta_in");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // Backprop updates the delta in place, so delta_in can be delta_out
+    b32 aliased = tensor_overlaps(delta_in, delta_out);
+    f32* image = aliased ?
+        MGA_PUSH_ARRAY(scratch.arena, f32, in_size) :
+        (f32*)delta_in->data;
+
+    if (aliased && accumulate) {
+        memcpy(image, delta_in->data, sizeof(f32) * in_size);
+    }
+
+    u32 block_cols = MAX(GEMM_NR, _CONV_COL_BLOCK_SIZE / k);
+    block_cols = MIN(block_cols, num_pixels);
+
+    f32* cols = MGA_PUSH_ARRAY(scratch.arena, f32, (u64)k * block_cols);
+
+    // kernels^T is the same for every block, so it is packed once
+    f32* packed_kernels = MGA_PUSH_ARRAY_ALIGNED(
+        scratch.arena, f32, gemm_packed_a_size(k, out_channels), TENSOR_ALIGN
+    );
+    gemm_pack_a_full_mixed(packed_kernels, true, k, out_channels, kernels->data, kernels->dtype, k);
+
+    for (u32 q0 = 0; q0 < num_pixels; q0 += block_cols) {
+        u32 num_cols = MIN(block_cols, num_pixels - q0);
+
+        // cols = kernels^T * delta_out[:, q0 : q0 + num_cols]
+        gemm_f32_packed_a(
+            k, num_cols, out_channels, packed_kernels,
+            false, (const f32*)delta_out->data + q0, num_pixels,
+            cols, num_cols, false
+        );
+
+        _conv_col2im(&geom, image, cols, num_cols, q0, num_cols, !accumulate && q0 == 0);
+    }
+
+    if (aliased) {
+        memcpy(delta_in->data, image, sizeof(f32) * in_size);
+    }
+
+    mga_scratch_release(scratch);
+
+    delta_in->shape = in_shape;
+
+    return true;
+}
+
+b32 conv_2d_backward_kernels_ip(
+    tensor* kernels_grad, const tensor* delta_out, const tensor* input,
+    u32 kernel_size, u32 stride, u32 padding
+) {
+    if (
+        kernels_grad->dtype != TENSOR_DTYPE_F32 || delta_out->dtype != TENSOR_DTYPE_F32 ||
+        input->dtype != TENSOR_DTYPE_F32
+    ) {
+        ERR(ERR_INVALID_INPUT, "Cannot compute conv kernel gradient: kernels_grad, delta_out and input must be f32");
+        return false;
+    }
+
+    _conv_geom geom = { 0 };
+    if (!_conv_geom_init(&geom, input->shape, (const f32*)input->data, kernel_size, stride, padding)) {
+        return false;
+    }
+
+    u32 k = kernel_size * kernel_size * geom.in_channels;
+    u32 out_channels = delta_out->shape.depth;
+    u32 num_pixels = geom.out_width * geom.out_height;
+
+    if (delta_out->shape.width != geom.out_width || delta_out->shape.height != geom.out_height) {
+        ERR(ERR_BAD_SHAPE, "Cannot compute conv kernel gradient: delta_out does not match the output shape");
+        return false;
+    }
+
+    if (kernels_grad->alloc < (u64)k * out_channels) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot compute conv kernel gradient: not enough space in kernels_grad");
+#endif
+        return false;
+    }
+
+    // kernels_grad = delta_out * im2col(input)^T
+    gemm_f32_custom_b(
+        false, out_channels, k, num_pixels,
+        (const f32*)delta_out->data, num_pixels,
+        _conv_pack_cols_t, &geom,
+        (f32*)kernels_grad->data, k, false
+    );
+
+    kernels_grad->shape = (tensor_shape){ kernel_size * kernel_size, geom.in_channels, out_channels };
+
+    return true;
+}
@@ -0,0 +1,206 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file conv.h
+ * @brief Implicit GEMM 2D convolution for `LAYER_CONV_2D`
+ *
+ * Same math as `tensor_im2col_ip` followed by `tensor_dot_ip`,
+ * but the im2col rows are gathered straight into the GEMM packing buffer,
+ * so the kernel_size^2 times larger column matrix is never stored. <br>
+ * Im2col row `r` is `(channel, ky, kx)` with `r = kx + ky * kernel_size + channel * kernel_size^2`,
+ * and column `q` is the output pixel `q = ox + oy * out_width`. <br>
+ * Kernels have the shape `(kernel_size^2, in_channels, out_channels)`,
+ * like `layer_conv_2d_backend.kernels`. <br>
+ * The Winograd fast path for 3x3, stride 1 convolutions is implemented in winograd.c
+ */
+
+#ifndef CONV_H
+#define CONV_H
+
+#include "../../include/base_defs.h"
+#include "../../include/tensorNew.h"
+
+/**
+ * @brief Convolution forward pass: `out = kernels * im2col(input)`
+ *
+ * @param out Output, gets the shape (out_width, out_height, out_channels). Needs to be big enough
+ * @param input Input image (width, height, in_channels)
+ * @param kernels Kernels (kernel_size^2, in_channels, out_channels).
+ *  Can be f16 or bf16, they are converted while packing. `out` and `input` must be f32
+ * @param kernel_size Side length of kernel
+ * @param stride Stride of convolution
+ * @param padding Padding of image on each side of x and y
+ *
+ * @return true if the shapes are valid and `out` is big enough
+ */
+b32 conv_2d_forward_ip(
+    tensor* out, const tensor* input, const tensor* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+);
+
+/**
+ * @brief `conv_2d_forward_ip` on a strided view, e.g. one example or a channel range of a batch
+ *
+ * Rows and channels of `input` are gathered with its strides, so the view is never copied
+ */
+b32 conv_2d_forward_view_ip(
+    tensor* out, const tensor_view* input, const tensor* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+);
+
+/**
+ * @brief Packs kernels once for `conv_2d_forward_packed_ip`
+ *
+ * For layers in inference mode, whose kernels never change
+ *
+ * @param arena Arena to allocate the packed kernels on
+ * @param kernels Kernels (kernel_size^2, in_channels, out_channels)
+ */
+tensor_packed* conv_2d_pack_kernels(mg_arena* arena, const tensor* kernels);
+
+/**
+ * @brief `conv_2d_forward_ip` with kernels from `conv_2d_pack_kernels`
+ *
+ * Skips repacking the kernels on every call
+ */
+b32 conv_2d_forward_packed_ip(
+    tensor* out, const tensor* input, const tensor_packed* kernels,
+    u32 kernel_size, u32 stride, u32 padding
+);
+
+/**
+ * @brief Quantizes kernels to int8 once for `conv_2d_forward_quantized_ip`
+ *
+ * Each output channel gets its own scale (see `tensor_quantize`)
+ *
+ * @param arena Arena to allocate the quantized kernels on
+ * @param kernels Kernels (kernel_size^2, in_channels, out_channels). Can be f16 or bf16
+ */
+tensor_quantized* conv_2d_quantize_kernels(mg_arena* arena, const tensor* kernels);
+
+/**
+ * @brief `conv_2d_forward_ip` with int8 arithmetic
+ *
+ * The input is quantized once with `input_params`, then the im2col rows
+ * are gathered from the quantized image. Padding uses the zero point, so it stays exactly 0
+ *
+ * @param out Output, gets the shape (out_width, out_height, out_channels). Needs to be big enough
+ * @param input Input image (width, height, in_channels). Must be f32
+ * @param input_params Quantization parameters of the input, usually from `tensor_quant_calibrate`
+ * @param kernels Kernels from `conv_2d_quantize_kernels`
+ * @param kernel_size Side length of kernel
+ * @param stride Stride of convolution
+ * @param padding Padding of image on each side of x and y
+ *
+ * @return true if the shapes are valid and `out` is big enough
+ */
+b32 conv_2d_forward_quantized_ip(
+    tensor* out, const tensor* input, tensor_quant_params input_params,
+    const tensor_quantized* kernels, u32 kernel_size, u32 stride, u32 padding
+);
+
+/**
+ * @brief CPU backend of `tensor_col2im_ip`, which can also add into `out`
+ *
+ * Channels are split across the tensor thread pool, so no two threads write the same pixel.
+ * With a stride of 1, each kernel row is added to the image with SIMD along the width
+ *
+ * @param out Output image, gets the shape `out_shape`
+ * @param cols Column matrix (out_width * out_height, kernel_size^2 * channels)
+ * @param out_shape Shape of the image
+ * @param kernel_size Side length of kernel
+ * @param stride Stride of convolution
+ * @param padding Padding of image on each side of x and y
+ * @param accumulate Adds to `out` instead of overwriting it
+ *
+ * @return true if the shapes are valid and `out` is big enough
+ */
+b32 conv_col2im_ip(
+    tensor* out, const tensor* cols, tensor_shape out_shape,
+    u32 kernel_size, u32 stride, u32 padding, b32 accumulate
+);
+
+/**
+ * @brief Data gradient: `delta_in (+)= col2im(kernels^T * delta_out)`
+ *
+ * The column matrix is only built one block of output pixels at a time
+ *
+ * @param delta_in Gradient with respect to the input, gets the shape `in_shape`
+ * @param delta_out Gradient with respect to the output (out_width, out_height, out_channels)
+ * @param kernels Kernels (kernel_size^2, in_channels, out_channels).
+ *  Can be f16 or bf16 like in the forward pass. `delta_in` and `delta_out` must be f32
+ * @param in_shape Shape of the input of the forward pass
+ * @param kernel_size Side length of kernel
+ * @param stride Stride of convolution
+ * @param padding Padding of image on each side of x and y
+ * @param accumulate Adds to `delta_in` instead of overwriting it
+ *
+ * @return true if the shapes are valid and `delta_in` is big enough
+ */
+b32 conv_2d_backward_data_ip(
+    tensor* delta_in, const tensor* delta_out, const tensor* kernels,
+    tensor_shape in_shape, u32 kernel_size, u32 stride, u32 padding,
+    b32 accumulate
+);
+
+/**
+ * @brief Kernel gradient: `kernels_grad = delta_out * im2col(input)^T`
+ *
+ * @param kernels_grad Output, gets the shape (kernel_size^2, in_channels, out_channels)
+ * @param delta_out Gradient with respect to the output (out_width, out_height, out_channels)
+ * @param input Input of the forward pass
+ * @param kernel_size Side length of kernel
+ * @param stride Stride of convolution
+ * @param padding Padding of image on each side of x and y
+ *
+ * @return true if the shapes are valid and `kernels_grad` is big enough
+ */
+b32 conv_2d_backward_kernels_ip(
+    tensor* kernels_grad, const tensor* delta_out, const tensor* input,
+    u32 kernel_size, u32 stride, u32 padding
+);
+
+/**
+ * @brief Whether or not the Winograd functions below apply to a convolution
+ *
+ * They only support 3x3 kernels with a stride of 1
+ */
+b32 conv_2d_winograd_supported(u32 kernel_size, u32 stride);
+
+/**
+ * @brief Computes the Winograd kernel transform `U = G g G^T` for every kernel
+ *
+ * Layers should cache the result and only redo it after the kernels change
+ *
+ * @param out Output, gets the shape (in_channels, out_channels, (tile_size + 2)^2).
+ *  Needs to be big enough
+ * @param kernels Kernels (9, in_channels, out_channels)
+ * @param tile_size Output tile size, 2 for F(2x2, 3x3) or 4 for F(4x4, 3x3)
+ *
+ * @return true if the shapes are valid and `out` is big enough
+ */
+b32 conv_2d_winograd_kernels_ip(tensor* out, const tensor* kernels, u32 tile_size);
+
+/**
+ * @brief Convolution forward pass with Winograd minimal filtering
+ *
+ * Same output as `conv_2d_forward_ip` with a kernel_size of 3 and a stride of 1,
+ * up to f32 rounding of the transforms. F(2x2, 3x3) does 2.25x fewer multiplications
+ * than direct convolution and F(4x4, 3x3) does 4x fewer
+ *
+ * @param out Output, gets the shape (out_width, out_height, out_channels). Needs to be big enough
+ * @param input Input image (width, height, in_channels)
+ * @param transformed_kernels Output of `conv_2d_winograd_kernels_ip` with the same `tile_size`
+ * @param tile_size Output tile size, 2 or 4
+ * @param padding Padding of image on each side of x and y
+ *
+ * @return true if the shapes are valid and `out` is big enough
+ */
+b32 conv_2d_winograd_forward_ip(
+    tensor* out, const tensor* input, const tensor* transformed_kernels,
+    u32 tile_size, u32 padding
+);
+
+#endif // CONV_H
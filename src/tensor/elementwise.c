@@ -0,0 +1,136 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "elementwise.h"
+
+#include <math.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Every instruction set gets the same set of kernels, generated from the macros below.
+ * Each kernel runs full vectors over the array, then finishes the tail in scalar code.
+ *
+ * `attr` is the target attribute of the instruction set, `vec` is the vector type,
+ * `w` is the vector width in f32s, and the rest are the intrinsics to use
+ */
+
+#define _EW_BINARY(name, attr, vec, w, load, store, vop, sop) \
+    attr static void name(f32* out, const f32* a, const f32* b, u64 size) { \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { \
+            vec va = load(a + i); \
+            vec vb = load(b + i); \
+            store(out + i, vop(va, vb)); \
+        } \
+        for (; i < size; i++) { out[i] = a[i] sop b[i]; } \
+    }
+
+#define _EW_SCALAR(name, attr, vec, w, load, store, set1, vop, sop) \
+    attr static void name(f32* out, const f32* a, f32 x, u64 size) { \
+        vec vx = set1(x); \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { \
+            store(out + i, vop(load(a + i), vx)); \
+        } \
+        for (; i < size; i++) { out[i] = a[i] sop x; } \
+    }
+
+#define _EW_SQRT(name, attr, vec, w, load, store, vsqrt) \
+    attr static void name(f32* out, const f32* a, u64 size) { \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { \
+            store(out + i, vsqrt(load(a + i))); \
+        } \
+        for (; i < size; i++) { out[i] = sqrtf(a[i]); } \
+    }
+
+#define _EW_FILL(name, attr, vec, w, store, set1) \
+    attr static void name(f32* out, f32 x, u64 size) { \
+        vec vx = set1(x); \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { store(out + i, vx); } \
+        for (; i < size; i++) { out[i] = x; } \
+    }
+
+#define _EW_ALL(isa, attr, vec, w, load, store, set1, vadd, vsub, vmul, vdiv, vsqrt) \
+    _EW_BINARY(_ew_add_##isa, attr, vec, w, load, store, vadd, +) \
+    _EW_BINARY(_ew_sub_##isa, attr, vec, w, load, store, vsub, -) \
+    _EW_BINARY(_ew_mul_##isa, attr, vec, w, load, store, vmul, *) \
+    _EW_BINARY(_ew_div_##isa, attr, vec, w, load, store, vdiv, /) \
+    _EW_SCALAR(_ew_add_all_##isa, attr, vec, w, load, store, set1, vadd, +) \
+    _EW_SCALAR(_ew_sub_all_##isa, attr, vec, w, load, store, set1, vsub, -) \
+    _EW_SCALAR(_ew_div_all_##isa, attr, vec, w, load, store, set1, vdiv, /) \
+    _EW_SCALAR(_ew_scale_##isa, attr, vec, w, load, store, set1, vmul, *) \
+    _EW_SQRT(_ew_sqrt_##isa, attr, vec, w, load, store, vsqrt) \
+    _EW_FILL(_ew_fill_##isa, attr, vec, w, store, set1) \
+    static const elementwise_kernels _ew_kernels_##isa = { \
+        .add = _ew_add_##isa, \
+        .sub = _ew_sub_##isa, \
+        .mul = _ew_mul_##isa, \
+        .div = _ew_div_##isa, \
+        .add_all = _ew_add_all_##isa, \
+        .sub_all = _ew_sub_all_##isa, \
+        .div_all = _ew_div_all_##isa, \
+        .scale = _ew_scale_##isa, \
+        .sqrt = _ew_sqrt_##isa, \
+        .fill = _ew_fill_##isa, \
+    };
+
+// Scalar "vectors" of width 1, so the same macros generate the plain C kernels
+#define _EW_NO_ATTR
+#define _EW_S_LOAD(p) (*(p))
+#define _EW_S_STORE(p, v) (*(p) = (v))
+#define _EW_S_SET1(x) (x)
+#define _EW_S_ADD(a, b) ((a) + (b))
+#define _EW_S_SUB(a, b) ((a) - (b))
+#define _EW_S_MUL(a, b) ((a) * (b))
+#define _EW_S_DIV(a, b) ((a) / (b))
+
+_EW_ALL(
+    scalar, _EW_NO_ATTR, f32, 1,
+    _EW_S_LOAD, _EW_S_STORE, _EW_S_SET1,
+    _EW_S_ADD, _EW_S_SUB, _EW_S_MUL, _EW_S_DIV, sqrtf
+)
+
+#if SIMD_X86
+
+_EW_ALL(
+    sse, SIMD_TARGET_SSE, __m128, 4,
+    _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+    _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps, _mm_sqrt_ps
+)
+
+_EW_ALL(
+    avx2, SIMD_TARGET_AVX2, __m256, 8,
+    _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+    _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_sqrt_ps
+)
+
+_EW_ALL(
+    avx512, SIMD_TARGET_AVX512, __m512, 16,
+    _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps,
+    _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_div_ps, _mm512_sqrt_ps
+)
+
+#endif // SIMD_X86
+
+const elementwise_kernels* elementwise_kernels_get_level(simd_level level) {
+    level = MIN(level, simd_get_supported_level());
+
+    switch (level) {
+#if SIMD_X86
+        case SIMD_LEVEL_AVX512: return &_ew_kernels_avx512;
+        case SIMD_LEVEL_AVX2: return &_ew_kernels_avx2;
+        case SIMD_LEVEL_SSE: return &_ew_kernels_sse;
+#endif
+        default: return &_ew_kernels_scalar;
+    }
+}
+
+const elementwise_kernels* elementwise_kernels_get(void) {
+    return elementwise_kernels_get_level(simd_get_level());
+}
@@ -0,0 +1,53 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file elementwise.h
+ * @brief Per instruction set kernels for the elementwise tensor functions
+ *
+ * The CPU backends of `tensor_add_ip`, `tensor_sub_ip`, `tensor_component_mul_ip`,
+ * `tensor_component_div_ip`, `tensor_add_all_ip`, `tensor_scale_ip`,
+ * `tensor_sqrt_ip` and `tensor_fill` call these through `elementwise_kernels_get`,
+ * and so do the broadcasting versions of the binary functions. <br>
+ * `out` may be the same pointer as an input, but they cannot partially overlap
+ */
+
+#ifndef ELEMENTWISE_H
+#define ELEMENTWISE_H
+
+#include "../../include/base_defs.h"
+#include "simd.h"
+
+/// `out[i] = a[i] (op) b[i]`
+typedef void (elementwise_binary_func)(f32* out, const f32* a, const f32* b, u64 size);
+/// `out[i] = a[i] (op) x`
+typedef void (elementwise_scalar_func)(f32* out, const f32* a, f32 x, u64 size);
+/// `out[i] = op(a[i])`
+typedef void (elementwise_unary_func)(f32* out, const f32* a, u64 size);
+/// `out[i] = x`
+typedef void (elementwise_fill_func)(f32* out, f32 x, u64 size);
+
+/// Table of elementwise kernels for one `simd_level`
+typedef struct {
+    elementwise_binary_func* add;
+    elementwise_binary_func* sub;
+    elementwise_binary_func* mul;
+    elementwise_binary_func* div;
+
+    elementwise_scalar_func* add_all;
+    elementwise_scalar_func* sub_all;
+    elementwise_scalar_func* div_all;
+    elementwise_scalar_func* scale;
+
+    elementwise_unary_func* sqrt;
+
+    elementwise_fill_func* fill;
+} elementwise_kernels;
+
+/// Returns the kernels for the active `simd_level` (see `simd_get_level`)
+const elementwise_kernels* elementwise_kernels_get(void);
+/// Returns the kernels for a specific `simd_level`, clamped to what the CPU supports
+const elementwise_kernels* elementwise_kernels_get_level(simd_level level);
+
+#endif // ELEMENTWISE_H
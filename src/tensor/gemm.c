@@ -0,0 +1,929 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "gemm.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../mg/mg_arena.h"
+#include "half.h"
+#include "overlap.h"
+#include "parallel.h"
+#include "simd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Goto/BLIS style GEMM
+ *
+ * for jc in n by NC:              B block (KC x NC) lives in L3
+ *   for pc in k by KC:            pack B block into NR wide panels
+ *     for ic in m by MC:          A block (MC x KC) lives in L2
+ *       pack A block into MR tall panels
+ *       for jr in NC by NR:       one KC x NR sliver of B in L1
+ *         for ir in MC by MR:     MR x NR tile of C in registers
+ *           micro-kernel
+ *
+ * Packed A panel: ap[p * MR + i] == op(A)[ic + ir + i, pc + p]
+ * Packed B panel: bp[p * NR + j] == op(B)[pc + p, jc + jr + j]
+ * Panels are zero padded, so the kernel never has to check bounds
+ */
+
+static u32 _gemm_round_up(u32 x, u32 multiple) {
+    return (x + multiple - 1) / multiple * multiple;
+}
+
+// Packs rows [i0, i0 + mc) and cols [p0, p0 + kc) of op(A)
+static void _gemm_pack_a(
+    f32* ap, b32 transpose_a, const f32* a, u32 lda,
+    u32 i0, u32 mc, u32 p0, u32 kc
+) {
+    for (u32 ir = 0; ir < mc; ir += GEMM_MR) {
+        u32 mr = MIN(GEMM_MR, mc - ir);
+
+        if (transpose_a) {
+            // op(A)[i, p] == a[i + p * lda], so each MR column is contiguous
+            for (u32 p = 0; p < kc; p++) {
+                const f32* src = a + (u64)(p0 + p) * lda + i0 + ir;
+                f32* dst = ap + (u64)p * GEMM_MR;
+
+                u32 i = 0;
+                for (; i < mr; i++) { dst[i] = src[i]; }
+                for (; i < GEMM_MR; i++) { dst[i] = 0.0f; }
+            }
+        } else {
+            // op(A)[i, p] == a[p + i * lda], so walk each row once
+            for (u32 i = 0; i < GEMM_MR; i++) {
+                if (i >= mr) {
+                    for (u32 p = 0; p < kc; p++) { ap[(u64)p * GEMM_MR + i] = 0.0f; }
+                    continue;
+                }
+
+                const f32* src = a + (u64)(i0 + ir + i) * lda + p0;
+                for (u32 p = 0; p < kc; p++) {
+                    ap[(u64)p * GEMM_MR + i] = src[p];
+                }
+            }
+        }
+
+        ap += (u64)kc * GEMM_MR;
+    }
+}
+
+// Packs rows [p0, p0 + kc) and cols [j0, j0 + nc) of op(B)
+static void _gemm_pack_b(
+    f32* bp, b32 transpose_b, const f32* b, u32 ldb,
+    u32 p0, u32 kc, u32 j0, u32 nc
+) {
+    for (u32 jr = 0; jr < nc; jr += GEMM_NR) {
+        u32 nr = MIN(GEMM_NR, nc - jr);
+
+        if (transpose_b) {
+            // op(B)[p, j] == b[p + j * ldb], so walk each row of b once
+            for (u32 j = 0; j < GEMM_NR; j++) {
+                if (j >= nr) {
+                    for (u32 p = 0; p < kc; p++) { bp[(u64)p * GEMM_NR + j] = 0.0f; }
+                    continue;
+                }
+
+                const f32* src = b + (u64)(j0 + jr + j) * ldb + p0;
+                for (u32 p = 0; p < kc; p++) {
+                    bp[(u64)p * GEMM_NR + j] = src[p];
+                }
+            }
+        } else {
+            // op(B)[p, j] == b[j + p * ldb], so each NR row is contiguous
+            for (u32 p = 0; p < kc; p++) {
+                const f32* src = b + (u64)(p0 + p) * ldb + j0 + jr;
+                f32* dst = bp + (u64)p * GEMM_NR;
+
+                if (nr == GEMM_NR) {
+                    memcpy(dst, src, sizeof(f32) * GEMM_NR);
+                } else {
+                    u32 j = 0;
+                    for (; j < nr; j++) { dst[j] = src[j]; }
+                    for (; j < GEMM_NR; j++) { dst[j] = 0.0f; }
+                }
+            }
+        }
+
+        bp += (u64)kc * GEMM_NR;
+    }
+}
+
+/*
+ * f16 and bf16 versions of the packing functions.
+ * Every contiguous run of the source is converted to f32 first,
+ * so the packed panels and the micro-kernels never see half values
+ */
+
+static void _gemm_pack_a_half(
+    f32* ap, b32 transpose_a, const u16* a, half_to_f32_func* to_f32, u32 lda,
+    u32 i0, u32 mc, u32 p0, u32 kc
+) {
+    f32 run[GEMM_KC];
+
+    for (u32 ir = 0; ir < mc; ir += GEMM_MR) {
+        u32 mr = MIN(GEMM_MR, mc - ir);
+
+        if (transpose_a) {
+            for (u32 p = 0; p < kc; p++) {
+                f32* dst = ap + (u64)p * GEMM_MR;
+
+                to_f32(dst, a + (u64)(p0 + p) * lda + i0 + ir, mr);
+                for (u32 i = mr; i < GEMM_MR; i++) { dst[i] = 0.0f; }
+            }
+        } else {
+            for (u32 i = 0; i < GEMM_MR; i++) {
+                if (i >= mr) {
+                    for (u32 p = 0; p < kc; p++) { ap[(u64)p * GEMM_MR + i] = 0.0f; }
+                    continue;
+                }
+
+                to_f32(run, a + (u64)(i0 + ir + i) * lda + p0, kc);
+                for (u32 p = 0; p < kc; p++) {
+                    ap[(u64)p * GEMM_MR + i] = run[p];
+                }
+            }
+        }
+
+        ap += (u64)kc * GEMM_MR;
+    }
+}
+
+static void _gemm_pack_b_half(
+    f32* bp, b32 transpose_b, const u16* b, half_to_f32_func* to_f32, u32 ldb,
+    u32 p0, u32 kc, u32 j0, u32 nc
+) {
+    f32 run[GEMM_KC];
+
+    for (u32 jr = 0; jr < nc; jr += GEMM_NR) {
+        u32 nr = MIN(GEMM_NR, nc - jr);
+
+        if (transpose_b) {
+            for (u32 j = 0; j < GEMM_NR; j++) {
+                if (j >= nr) {
+                    for (u32 p = 0; p < kc; p++) { bp[(u64)p * GEMM_NR + j] = 0.0f; }
+                    continue;
+                }
+
+                to_f32(run, b + (u64)(j0 + jr + j) * ldb + p0, kc);
+                for (u32 p = 0; p < kc; p++) {
+                    bp[(u64)p * GEMM_NR + j] = run[p];
+                }
+            }
+        } else {
+            for (u32 p = 0; p < kc; p++) {
+                f32* dst = bp + (u64)p * GEMM_NR;
+
+                to_f32(dst, b + (u64)(p0 + p) * ldb + j0 + jr, nr);
+                for (u32 j = nr; j < GEMM_NR; j++) { dst[j] = 0.0f; }
+            }
+        }
+
+        bp += (u64)kc * GEMM_NR;
+    }
+}
+
+// `to_f32` is NULL if `a` is f32
+static void _gemm_pack_a_any(
+    f32* ap, b32 transpose_a, const void* a, half_to_f32_func* to_f32, u32 lda,
+    u32 i0, u32 mc, u32 p0, u32 kc
+) {
+    if (to_f32 == NULL) {
+        _gemm_pack_a(ap, transpose_a, (const f32*)a, lda, i0, mc, p0, kc);
+    } else {
+        _gemm_pack_a_half(ap, transpose_a, (const u16*)a, to_f32, lda, i0, mc, p0, kc);
+    }
+}
+
+// `to_f32` is NULL if `b` is f32
+static void _gemm_pack_b_any(
+    f32* bp, b32 transpose_b, const void* b, half_to_f32_func* to_f32, u32 ldb,
+    u32 p0, u32 kc, u32 j0, u32 nc
+) {
+    if (to_f32 == NULL) {
+        _gemm_pack_b(bp, transpose_b, (const f32*)b, ldb, p0, kc, j0, nc);
+    } else {
+        _gemm_pack_b_half(bp, transpose_b, (const u16*)b, to_f32, ldb, p0, kc, j0, nc);
+    }
+}
+
+typedef void (_gemm_kernel_func)(u32 kc, const f32* ap, const f32* bp, f32* c, u32 ldc, b32 accumulate);
+
+// Portable kernel. The fixed trip counts let the compiler keep acc in vector registers
+static void _gemm_kernel_scalar(u32 kc, const f32* ap, const f32* bp, f32* c, u32 ldc, b32 accumulate) {
+    f32 acc[GEMM_MR][GEMM_NR] = { 0 };
+
+    for (u32 p = 0; p < kc; p++) {
+        for (u32 i = 0; i < GEMM_MR; i++) {
+            f32 a_val = ap[i];
+
+            for (u32 j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += a_val * bp[j];
+            }
+        }
+
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+
+    for (u32 i = 0; i < GEMM_MR; i++) {
+        f32* row = c + (u64)i * ldc;
+
+        if (accumulate) {
+            for (u32 j = 0; j < GEMM_NR; j++) { row[j] += acc[i][j]; }
+        } else {
+            for (u32 j = 0; j < GEMM_NR; j++) { row[j] = acc[i][j]; }
+        }
+    }
+}
+
+#if SIMD_X86
+
+#define _GEMM_ROW_FMA(r) do { \
+        __m256 a##r = _mm256_broadcast_ss(ap + r); \
+        c##r##0 = _mm256_fmadd_ps(a##r, b0, c##r##0); \
+        c##r##1 = _mm256_fmadd_ps(a##r, b1, c##r##1); \
+    } while (0)
+
+#define _GEMM_ROW_STORE(r) do { \
+        f32* row = c + (u64)r * ldc; \
+        if (accumulate) { \
+            c##r##0 = _mm256_add_ps(c##r##0, _mm256_loadu_ps(row)); \
+            c##r##1 = _mm256_add_ps(c##r##1, _mm256_loadu_ps(row + 8)); \
+        } \
+        _mm256_storeu_ps(row, c##r##0); \
+        _mm256_storeu_ps(row + 8, c##r##1); \
+    } while (0)
+
+// 6x16 tile: 12 accumulators + 2 B vectors + 1 broadcast fit the 16 ymm registers
+SIMD_TARGET_AVX2 static void _gemm_kernel_avx2(u32 kc, const f32* ap, const f32* bp, f32* c, u32 ldc, b32 accumulate) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (u32 p = 0; p < kc; p++) {
+        __m256 b0 = _mm256_loadu_ps(bp);
+        __m256 b1 = _mm256_loadu_ps(bp + 8);
+
+        _GEMM_ROW_FMA(0);
+        _GEMM_ROW_FMA(1);
+        _GEMM_ROW_FMA(2);
+        _GEMM_ROW_FMA(3);
+        _GEMM_ROW_FMA(4);
+        _GEMM_ROW_FMA(5);
+
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+
+    _GEMM_ROW_STORE(0);
+    _GEMM_ROW_STORE(1);
+    _GEMM_ROW_STORE(2);
+    _GEMM_ROW_STORE(3);
+    _GEMM_ROW_STORE(4);
+    _GEMM_ROW_STORE(5);
+}
+
+#undef _GEMM_ROW_FMA
+#undef _GEMM_ROW_STORE
+
+#endif // SIMD_X86
+
+// Runs the micro-kernel over one packed MC x KC block of A and KC x NC block of B
+static void _gemm_macro_kernel(
+    _gemm_kernel_func* kernel, u32 mc, u32 nc, u32 kc,
+    const f32* ap, const f32* bp,
+    f32* c, u32 ldc, b32 accumulate
+) {
+    f32 edge[GEMM_MR * GEMM_NR];
+
+    for (u32 jr = 0; jr < nc; jr += GEMM_NR) {
+        u32 nr = MIN(GEMM_NR, nc - jr);
+        const f32* b_panel = bp + (u64)jr * kc;
+
+        for (u32 ir = 0; ir < mc; ir += GEMM_MR) {
+            u32 mr = MIN(GEMM_MR, mc - ir);
+            const f32* a_panel = ap + (u64)ir * kc;
+            f32* c_tile = c + (u64)ir * ldc + jr;
+
+            if (mr == GEMM_MR && nr == GEMM_NR) {
+                kernel(kc, a_panel, b_panel, c_tile, ldc, accumulate);
+                continue;
+            }
+
+            // Partial tile: compute into a full size buffer, then copy the valid part
+            kernel(kc, a_panel, b_panel, edge, GEMM_NR, false);
+
+            for (u32 i = 0; i < mr; i++) {
+                f32* row = c_tile + (u64)i * ldc;
+                const f32* src = edge + i * GEMM_NR;
+
+                if (accumulate) {
+                    for (u32 j = 0; j < nr; j++) { row[j] += src[j]; }
+                } else {
+                    for (u32 j = 0; j < nr; j++) { row[j] = src[j]; }
+                }
+            }
+        }
+    }
+}
+
+typedef struct {
+    b32 transpose_b;
+    const void* b;
+    // NULL if `b` is f32
+    half_to_f32_func* to_f32;
+    u32 ldb;
+} _gemm_b_matrix;
+
+static void _gemm_pack_b_matrix(void* ctx, f32* bp, u32 p0, u32 kc, u32 j0, u32 nc) {
+    const _gemm_b_matrix* mat = (const _gemm_b_matrix*)ctx;
+
+    _gemm_pack_b_any(bp, mat->transpose_b, mat->b, mat->to_f32, mat->ldb, p0, kc, j0, nc);
+}
+
+void gemm_f32(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    const f32* b, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    gemm_mixed(
+        transpose_a, transpose_b, m, n, k,
+        a, TENSOR_DTYPE_F32, lda,
+        b, TENSOR_DTYPE_F32, ldb,
+        c, ldc, accumulate
+    );
+}
+
+static _gemm_kernel_func* _gemm_get_kernel(void) {
+#if SIMD_X86
+    if (simd_get_level() >= SIMD_LEVEL_AVX2) {
+        return _gemm_kernel_avx2;
+    }
+#endif
+
+    return _gemm_kernel_scalar;
+}
+
+// Offset of block (j0, p0) in a fully packed op(B). Every column block before j0 is NC wide
+static u64 _gemm_packed_b_offset(u32 k, u32 p0, u32 j0, u32 nc) {
+    return (u64)j0 * k + (u64)p0 * _gemm_round_up(nc, GEMM_NR);
+}
+
+// Offset of block (i0, p0) in a fully packed op(A). Every row block before i0 is MC tall
+static u64 _gemm_packed_a_offset(u32 k, u32 p0, u32 i0, u32 mc) {
+    return (u64)i0 * k + (u64)p0 * _gemm_round_up(mc, GEMM_MR);
+}
+
+typedef struct {
+    _gemm_kernel_func* kernel;
+
+    b32 transpose_a;
+    u32 m, n, k;
+    const void* a;
+    // NULL if `a` is f32
+    half_to_f32_func* a_to_f32;
+    u32 lda;
+    // If not NULL, A blocks are read out of it instead (see gemm_pack_a_full)
+    const f32* packed_a;
+
+    // Either `pack_b` is called for every B block,
+    // or the blocks are read out of `packed_b` (see gemm_pack_b_full)
+    gemm_pack_b_func* pack_b;
+    void* pack_b_ctx;
+    const f32* packed_b;
+
+    f32* c;
+    u32 ldc;
+    b32 accumulate;
+
+    // Tile grid for threading, in units of MR rows and NR columns
+    u32 grid_m;
+    u32 grid_n;
+} _gemm_args;
+
+// Computes rows [i0, i1) and columns [j0, j1) of C. i0 and j0 must be multiples of MR and NR
+static void _gemm_block(const _gemm_args* args, u32 i0, u32 i1, u32 j0, u32 j1) {
+    if (i0 >= i1 || j0 >= j1) {
+        return;
+    }
+
+    u32 k = args->k;
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    u32 kc_max = MIN(k, GEMM_KC);
+    u32 mc_max = _gemm_round_up(MIN(i1 - i0, GEMM_MC), GEMM_MR);
+    u32 nc_max = _gemm_round_up(MIN(j1 - j0, GEMM_NC), GEMM_NR);
+
+    f32* ap_buf = args->packed_a == NULL ? MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, (u64)mc_max * kc_max, TENSOR_ALIGN) : NULL;
+    f32* bp_buf = args->packed_b == NULL ? MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, (u64)kc_max * nc_max, TENSOR_ALIGN) : NULL;
+
+    // Blocks follow the MC and NC grids of the whole matrix, so that pre-packed blocks line up
+    for (u32 jc = j0 / GEMM_NC * GEMM_NC; jc < j1; jc += GEMM_NC) {
+        u32 nc_full = MIN(GEMM_NC, args->n - jc);
+        u32 js = MAX(jc, j0);
+        u32 nc = MIN(jc + nc_full, j1) - js;
+
+        for (u32 pc = 0; pc < k; pc += GEMM_KC) {
+            u32 kc = MIN(GEMM_KC, k - pc);
+            // Only the first k block can overwrite C
+            b32 acc_block = args->accumulate || pc != 0;
+
+            const f32* bp = bp_buf;
+            if (args->packed_b == NULL) {
+                args->pack_b(args->pack_b_ctx, bp_buf, pc, kc, js, nc);
+            } else {
+                bp = args->packed_b + _gemm_packed_b_offset(k, pc, jc, nc_full) + (u64)(js - jc) * kc;
+            }
+
+            for (u32 ic = i0 / GEMM_MC * GEMM_MC; ic < i1; ic += GEMM_MC) {
+                u32 mc_full = MIN(GEMM_MC, args->m - ic);
+                u32 is = MAX(ic, i0);
+                u32 mc = MIN(ic + mc_full, i1) - is;
+
+                const f32* ap = ap_buf;
+                if (args->packed_a == NULL) {
+                    _gemm_pack_a_any(ap_buf, args->transpose_a, args->a, args->a_to_f32, args->lda, is, mc, pc, kc);
+                } else {
+                    ap = args->packed_a + _gemm_packed_a_offset(k, pc, ic, mc_full) + (u64)(is - ic) * kc;
+                }
+
+                _gemm_macro_kernel(
+                    args->kernel, mc, nc, kc, ap, bp,
+                    args->c + (u64)is * args->ldc + js, args->ldc, acc_block
+                );
+            }
+        }
+    }
+
+    mga_scratch_release(scratch);
+}
+
+static void _gemm_tile_range(void* ctx, u32 start, u32 end) {
+    const _gemm_args* args = (const _gemm_args*)ctx;
+
+    u32 tiles_m = (args->m + GEMM_MR - 1) / GEMM_MR;
+    u32 tiles_n = (args->n + GEMM_NR - 1) / GEMM_NR;
+
+    for (u32 t = start; t < end; t++) {
+        u32 gi = t % args->grid_m;
+        u32 gj = t / args->grid_m;
+
+        u32 i0 = (u32)((u64)tiles_m * gi / args->grid_m) * GEMM_MR;
+        u32 i1 = (u32)((u64)tiles_m * (gi + 1) / args->grid_m) * GEMM_MR;
+        u32 j0 = (u32)((u64)tiles_n * gj / args->grid_n) * GEMM_NR;
+        u32 j1 = (u32)((u64)tiles_n * (gj + 1) / args->grid_n) * GEMM_NR;
+
+        _gemm_block(args, i0, MIN(i1, args->m), j0, MIN(j1, args->n));
+    }
+}
+
+/*
+ * Picks a grid_m x grid_n split of C for `num_threads` threads.
+ * Every thread packs its own rows of A and columns of B,
+ * so the split with the least packing per thread wins
+ */
+static void _gemm_choose_grid(u32 m, u32 n, u32 num_threads, u32* grid_m, u32* grid_n) {
+    u32 tiles_m = (m + GEMM_MR - 1) / GEMM_MR;
+    u32 tiles_n = (n + GEMM_NR - 1) / GEMM_NR;
+
+    u64 best_cost = UINT64_MAX;
+    *grid_m = 1;
+    *grid_n = 1;
+
+    for (u32 gm = 1; gm <= num_threads && gm <= tiles_m; gm++) {
+        u32 gn = MIN(num_threads / gm, tiles_n);
+
+        // Idle threads are as bad as extra packing
+        u64 used = (u64)gm * gn;
+        u64 cost = ((u64)m / gm + (u64)n / gn + 1) * num_threads / used;
+
+        if (cost < best_cost) {
+            best_cost = cost;
+            *grid_m = gm;
+            *grid_n = gn;
+        }
+    }
+}
+
+static void _gemm_driver(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const void* a, half_to_f32_func* a_to_f32, u32 lda, const f32* packed_a,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx, const f32* packed_b,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    if (k == 0) {
+        if (!accumulate) {
+            for (u32 i = 0; i < m; i++) {
+                memset(c + (u64)i * ldc, 0, sizeof(f32) * n);
+            }
+        }
+
+        return;
+    }
+
+    _gemm_args args = {
+        .kernel = _gemm_get_kernel(),
+        .transpose_a = transpose_a,
+        .m = m, .n = n, .k = k,
+        .a = a, .a_to_f32 = a_to_f32, .lda = lda, .packed_a = packed_a,
+        .pack_b = pack_b, .pack_b_ctx = pack_b_ctx, .packed_b = packed_b,
+        .c = c, .ldc = ldc,
+        .accumulate = accumulate,
+        .grid_m = 1, .grid_n = 1
+    };
+
+    u32 num_threads = parallel_get_num_threads();
+
+    if (num_threads > 1 && (u64)m * n * k >= GEMM_PARALLEL_MIN_WORK) {
+        _gemm_choose_grid(m, n, num_threads, &args.grid_m, &args.grid_n);
+    }
+
+    u32 num_tiles = args.grid_m * args.grid_n;
+
+    if (num_tiles == 1) {
+        _gemm_block(&args, 0, m, 0, n);
+    } else {
+        parallel_for(num_tiles, _gemm_tile_range, &args);
+    }
+}
+
+void gemm_f32_custom_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_driver(
+        transpose_a, m, n, k, a, NULL, lda, NULL,
+        pack_b, pack_b_ctx, NULL,
+        c, ldc, accumulate
+    );
+}
+
+void gemm_mixed(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda,
+    const void* b, tensor_dtype b_dtype, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_b_matrix mat = {
+        .transpose_b = transpose_b,
+        .b = b,
+        .to_f32 = half_get_to_f32(b_dtype),
+        .ldb = ldb
+    };
+
+    _gemm_driver(
+        transpose_a, m, n, k, a, half_get_to_f32(a_dtype), lda, NULL,
+        _gemm_pack_b_matrix, &mat, NULL,
+        c, ldc, accumulate
+    );
+}
+
+void gemm_mixed_custom_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_driver(
+        transpose_a, m, n, k, a, half_get_to_f32(a_dtype), lda, NULL,
+        pack_b, pack_b_ctx, NULL,
+        c, ldc, accumulate
+    );
+}
+
+u64 gemm_packed_b_size(u32 n, u32 k) {
+    return (u64)k * _gemm_round_up(n, GEMM_NR);
+}
+
+void gemm_pack_b_full(f32* packed_b, b32 transpose_b, u32 n, u32 k, const f32* b, u32 ldb) {
+    gemm_pack_b_full_mixed(packed_b, transpose_b, n, k, b, TENSOR_DTYPE_F32, ldb);
+}
+
+void gemm_pack_b_full_mixed(
+    f32* packed_b, b32 transpose_b, u32 n, u32 k,
+    const void* b, tensor_dtype b_dtype, u32 ldb
+) {
+    half_to_f32_func* to_f32 = half_get_to_f32(b_dtype);
+
+    for (u32 jc = 0; jc < n; jc += GEMM_NC) {
+        u32 nc = MIN(GEMM_NC, n - jc);
+
+        for (u32 pc = 0; pc < k; pc += GEMM_KC) {
+            u32 kc = MIN(GEMM_KC, k - pc);
+
+            _gemm_pack_b_any(
+                packed_b + _gemm_packed_b_offset(k, pc, jc, nc),
+                transpose_b, b, to_f32, ldb, pc, kc, jc, nc
+            );
+        }
+    }
+}
+
+void gemm_f32_packed_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    const f32* packed_b,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_driver(
+        transpose_a, m, n, k, a, NULL, lda, NULL,
+        NULL, NULL, packed_b,
+        c, ldc, accumulate
+    );
+}
+
+u64 gemm_packed_a_size(u32 m, u32 k) {
+    return (u64)k * _gemm_round_up(m, GEMM_MR);
+}
+
+void gemm_pack_a_full(f32* packed_a, b32 transpose_a, u32 m, u32 k, const f32* a, u32 lda) {
+    gemm_pack_a_full_mixed(packed_a, transpose_a, m, k, a, TENSOR_DTYPE_F32, lda);
+}
+
+void gemm_pack_a_full_mixed(
+    f32* packed_a, b32 transpose_a, u32 m, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda
+) {
+    half_to_f32_func* to_f32 = half_get_to_f32(a_dtype);
+
+    for (u32 ic = 0; ic < m; ic += GEMM_MC) {
+        u32 mc = MIN(GEMM_MC, m - ic);
+
+        for (u32 pc = 0; pc < k; pc += GEMM_KC) {
+            u32 kc = MIN(GEMM_KC, k - pc);
+
+            _gemm_pack_a_any(
+                packed_a + _gemm_packed_a_offset(k, pc, ic, mc),
+                transpose_a, a, to_f32, lda, ic, mc, pc, kc
+            );
+        }
+    }
+}
+
+void gemm_f32_packed_a(
+    u32 m, u32 n, u32 k,
+    const f32* packed_a,
+    b32 transpose_b, const f32* b, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_b_matrix mat = {
+        .transpose_b = transpose_b,
+        .b = b,
+        .ldb = ldb
+    };
+
+    _gemm_driver(
+        false, m, n, k, NULL, NULL, 0, packed_a,
+        _gemm_pack_b_matrix, &mat, NULL,
+        c, ldc, accumulate
+    );
+}
+
+void gemm_f32_packed_a_custom_b(
+    u32 m, u32 n, u32 k,
+    const f32* packed_a,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+) {
+    _gemm_driver(
+        false, m, n, k, NULL, NULL, 0, packed_a,
+        pack_b, pack_b_ctx, NULL,
+        c, ldc, accumulate
+    );
+}
+
+typedef struct {
+    b32 transpose_a;
+    b32 transpose_b;
+    u32 m, n, k;
+
+    // NULL unless A is shared by every slice, and B is not
+    const f32* packed_a;
+    const f32* a;
+    u32 lda;
+    u64 stride_a;
+
+    // NULL unless B is shared by every slice
+    const f32* packed_b;
+    const f32* b;
+    u32 ldb;
+    u64 stride_b;
+
+    f32* c;
+    u32 ldc;
+    u64 stride_c;
+
+    b32 accumulate;
+} _gemm_batch;
+
+static void _gemm_batch_range(void* ctx, u32 start, u32 end) {
+    const _gemm_batch* batch = (const _gemm_batch*)ctx;
+
+    for (u32 z = start; z < end; z++) {
+        const f32* a = batch->a + z * batch->stride_a;
+        f32* c = batch->c + z * batch->stride_c;
+
+        if (batch->packed_b != NULL) {
+            gemm_f32_packed_b(
+                batch->transpose_a, batch->m, batch->n, batch->k,
+                a, batch->lda, batch->packed_b,
+                c, batch->ldc, batch->accumulate
+            );
+        } else if (batch->packed_a != NULL) {
+            gemm_f32_packed_a(
+                batch->m, batch->n, batch->k, batch->packed_a,
+                batch->transpose_b, batch->b + z * batch->stride_b, batch->ldb,
+                c, batch->ldc, batch->accumulate
+            );
+        } else {
+            gemm_f32(
+                batch->transpose_a, batch->transpose_b, batch->m, batch->n, batch->k,
+                a, batch->lda, batch->b + z * batch->stride_b, batch->ldb,
+                c, batch->ldc, batch->accumulate
+            );
+        }
+    }
+}
+
+void gemm_f32_batched(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda, u64 stride_a,
+    const f32* b, u32 ldb, u64 stride_b,
+    f32* c, u32 ldc, u64 stride_c,
+    u32 batch_size, b32 accumulate
+) {
+    if (batch_size == 0) {
+        return;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    _gemm_batch batch = {
+        .transpose_a = transpose_a,
+        .transpose_b = transpose_b,
+        .m = m, .n = n, .k = k,
+        .a = a, .lda = lda, .stride_a = stride_a,
+        .b = b, .ldb = ldb, .stride_b = stride_b,
+        .c = c, .ldc = ldc, .stride_c = stride_c,
+        .accumulate = accumulate
+    };
+
+    // A shared operand only gets packed once, instead of once per slice
+    b32 shareable = batch_size > 1 && m != 0 && n != 0 && k != 0;
+
+    if (shareable && stride_b == 0) {
+        f32* packed_b = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, gemm_packed_b_size(n, k), TENSOR_ALIGN);
+        gemm_pack_b_full(packed_b, transpose_b, n, k, b, ldb);
+
+        batch.packed_b = packed_b;
+    } else if (shareable && stride_a == 0) {
+        f32* packed_a = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, gemm_packed_a_size(m, k), TENSOR_ALIGN);
+        gemm_pack_a_full(packed_a, transpose_a, m, k, a, lda);
+
+        batch.packed_a = packed_a;
+    }
+
+    // With fewer slices than threads, each GEMM splits its own tiles instead
+    if (batch_size >= parallel_get_num_threads()) {
+        parallel_for(batch_size, _gemm_batch_range, &batch);
+    } else {
+        _gemm_batch_range(&batch, 0, batch_size);
+    }
+
+    mga_scratch_release(scratch);
+}
+
+void gemm_tensor_dot(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b) {
+    u32 m = transpose_a ? a->shape.width : a->shape.height;
+    u32 k = transpose_a ? a->shape.height : a->shape.width;
+    u32 n = transpose_b ? b->shape.height : b->shape.width;
+
+    // Backprop does things like `tensor_dot_ip(delta, false, true, delta, weight)`
+    b32 aliased = tensor_overlaps(out, a) || tensor_overlaps(out, b);
+    // Half outputs are rounded once, after all of k is accumulated in f32
+    half_from_f32_func* out_from_f32 = half_get_from_f32(out->dtype);
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    f32* c = aliased || out_from_f32 != NULL ?
+        MGA_PUSH_ARRAY(scratch.arena, f32, (u64)m * n) : (f32*)out->data;
+
+    gemm_mixed(
+        transpose_a, transpose_b, m, n, k,
+        a->data, a->dtype, a->shape.width,
+        b->data, b->dtype, b->shape.width,
+        c, n, false
+    );
+
+    if (out_from_f32 != NULL) {
+        out_from_f32((u16*)out->data, c, (u64)m * n);
+    } else if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * (u64)m * n);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, 1 };
+}
+
+void gemm_tensor_dot_batched(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b) {
+    u32 m = transpose_a ? a->shape.width : a->shape.height;
+    u32 k = transpose_a ? a->shape.height : a->shape.width;
+    u32 n = transpose_b ? b->shape.height : b->shape.width;
+    u32 depth = a->shape.depth;
+
+    u64 stride_a = (u64)a->shape.width * a->shape.height;
+    u64 stride_b = b->shape.depth == 1 ? 0 : (u64)b->shape.width * b->shape.height;
+    u64 stride_c = (u64)m * n;
+
+    b32 aliased = tensor_overlaps(out, a) || tensor_overlaps(out, b);
+    half_from_f32_func* out_from_f32 = half_get_from_f32(out->dtype);
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    f32* c = aliased || out_from_f32 != NULL ?
+        MGA_PUSH_ARRAY(scratch.arena, f32, stride_c * depth) : (f32*)out->data;
+
+    if (a->dtype == TENSOR_DTYPE_F32 && b->dtype == TENSOR_DTYPE_F32) {
+        gemm_f32_batched(
+            transpose_a, transpose_b, m, n, k,
+            (const f32*)a->data, a->shape.width, stride_a,
+            (const f32*)b->data, b->shape.width, stride_b,
+            c, n, stride_c,
+            depth, false
+        );
+    } else {
+        // Half operands go slice by slice, each GEMM still splits its own tiles across the pool
+        u64 a_elem_size = tensor_dtype_size(a->dtype);
+        u64 b_elem_size = tensor_dtype_size(b->dtype);
+
+        // Shared half weights are converted and packed once, instead of once per slice
+        f32* packed_b = NULL;
+        if (stride_b == 0 && depth > 1 && m != 0 && n != 0 && k != 0) {
+            packed_b = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, gemm_packed_b_size(n, k), TENSOR_ALIGN);
+            gemm_pack_b_full_mixed(packed_b, transpose_b, n, k, b->data, b->dtype, b->shape.width);
+        }
+
+        for (u32 z = 0; z < depth; z++) {
+            const u8* a_slice = (const u8*)a->data + z * stride_a * a_elem_size;
+
+            if (packed_b != NULL) {
+                _gemm_driver(
+                    transpose_a, m, n, k, a_slice, half_get_to_f32(a->dtype), a->shape.width, NULL,
+                    NULL, NULL, packed_b,
+                    c + z * stride_c, n, false
+                );
+            } else {
+                gemm_mixed(
+                    transpose_a, transpose_b, m, n, k,
+                    a_slice, a->dtype, a->shape.width,
+                    (const u8*)b->data + z * stride_b * b_elem_size, b->dtype, b->shape.width,
+                    c + z * stride_c, n, false
+                );
+            }
+        }
+    }
+
+    if (out_from_f32 != NULL) {
+        out_from_f32((u16*)out->data, c, stride_c * depth);
+    } else if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * stride_c * depth);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, depth };
+}
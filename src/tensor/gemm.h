@@ -0,0 +1,219 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file gemm.h
+ * @brief Blocked single precision matrix multiplication (CPU backend of `tensor_dot_ip`)
+ *
+ * All matrices are row major, like 2D tensors:
+ * `Element[col, row] == data[col + row * ld]` <br>
+ * The `_mixed` functions also take f16 and bf16 operands.
+ * Those are converted to f32 while packing, so the micro-kernels and C are always f32
+ */
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "../../include/base_defs.h"
+#include "../../include/tensorNew.h"
+
+/// Rows of C computed by one micro-kernel call
+#define GEMM_MR 6
+/// Columns of C computed by one micro-kernel call
+#define GEMM_NR 16
+
+/// Rows of op(A) packed per block. Sized so that an MC x KC block stays in L2
+#define GEMM_MC 96
+/// Depth of each packed block. Sized so that a KC x NR sliver of B stays in L1
+#define GEMM_KC 256
+/// Columns of op(B) packed per block. Sized so that a KC x NC block stays in L3
+#define GEMM_NC 2048
+
+#ifndef GEMM_PARALLEL_MIN_WORK
+/**
+ * @brief Smallest m * n * k that gets split across the tensor thread pool
+ *
+ * Below this, dispatching to the pool costs more than it saves
+ * (e.g. the 12 x 128 layers of the snake example)
+ */
+#   define GEMM_PARALLEL_MIN_WORK (1 << 21)
+#endif
+
+/**
+ * @brief Computes `C = op(A) * op(B)` or `C += op(A) * op(B)`
+ *
+ * op(A) is m x k and op(B) is k x n. Transposes are handled while packing,
+ * so the transposed operands are never materialized. <br>
+ * Large products split the tiles of C across the tensor thread pool (see parallel.h). <br>
+ * `c` cannot overlap `a` or `b`
+ *
+ * @param transpose_a Whether or not op(A) is the transpose of `a`
+ * @param transpose_b Whether or not op(B) is the transpose of `b`
+ * @param m Rows of op(A) and C
+ * @param n Columns of op(B) and C
+ * @param k Columns of op(A) and rows of op(B)
+ * @param a Data of A
+ * @param lda Row stride of A in elements
+ * @param b Data of B
+ * @param ldb Row stride of B in elements
+ * @param c Data of C
+ * @param ldc Row stride of C in elements
+ * @param accumulate Adds to C instead of overwriting it
+ */
+void gemm_f32(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    const f32* b, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/**
+ * @brief Packs a block of op(B) for `gemm_f32_custom_b`
+ *
+ * Must write rows [p0, p0 + kc) and columns [j0, j0 + nc) of op(B) into `bp`
+ * as consecutive GEMM_NR wide panels, where `bp[p * GEMM_NR + j]` of each panel
+ * is `op(B)[p0 + p, j0 + jr + j]` (jr is the first column of the panel).
+ * Columns past `nc` in the last panel must be zero
+ */
+typedef void (gemm_pack_b_func)(void* ctx, f32* bp, u32 p0, u32 kc, u32 j0, u32 nc);
+
+/**
+ * @brief `gemm_f32`, but op(B) is produced block by block by `pack_b`
+ *
+ * Lets callers like the implicit GEMM convolution build
+ * B straight into the packing buffer instead of materializing it
+ */
+void gemm_f32_custom_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/**
+ * @brief `gemm_f32` where `a` and `b` can be stored as any `tensor_dtype`
+ *
+ * Strides are in elements of each operand's dtype. Products accumulate in f32
+ */
+void gemm_mixed(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda,
+    const void* b, tensor_dtype b_dtype, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/// `gemm_f32_custom_b` where `a` can be stored as any `tensor_dtype`
+void gemm_mixed_custom_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/// Size in f32s of op(B) packed by `gemm_pack_b_full`
+u64 gemm_packed_b_size(u32 n, u32 k);
+
+/**
+ * @brief Packs all of op(B) (k x n) ahead of time, in the block order `gemm_f32_packed_b` reads it
+ *
+ * @param packed_b Output, needs `gemm_packed_b_size(n, k)` f32s
+ */
+void gemm_pack_b_full(f32* packed_b, b32 transpose_b, u32 n, u32 k, const f32* b, u32 ldb);
+/// `gemm_pack_b_full` from a `b` stored as any `tensor_dtype`. The packed data is still f32
+void gemm_pack_b_full_mixed(
+    f32* packed_b, b32 transpose_b, u32 n, u32 k,
+    const void* b, tensor_dtype b_dtype, u32 ldb
+);
+
+/**
+ * @brief `gemm_f32` with an op(B) that was already packed by `gemm_pack_b_full`
+ *
+ * Skips all B packing, which pays off when the same B is multiplied many times
+ */
+void gemm_f32_packed_b(
+    b32 transpose_a,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    const f32* packed_b,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/// Size in f32s of op(A) packed by `gemm_pack_a_full`
+u64 gemm_packed_a_size(u32 m, u32 k);
+
+/**
+ * @brief Packs all of op(A) (m x k) ahead of time, in the block order `gemm_f32_packed_a` reads it
+ *
+ * @param packed_a Output, needs `gemm_packed_a_size(m, k)` f32s
+ */
+void gemm_pack_a_full(f32* packed_a, b32 transpose_a, u32 m, u32 k, const f32* a, u32 lda);
+/// `gemm_pack_a_full` from an `a` stored as any `tensor_dtype`. The packed data is still f32
+void gemm_pack_a_full_mixed(
+    f32* packed_a, b32 transpose_a, u32 m, u32 k,
+    const void* a, tensor_dtype a_dtype, u32 lda
+);
+
+/// `gemm_f32` with an op(A) that was already packed by `gemm_pack_a_full`
+void gemm_f32_packed_a(
+    u32 m, u32 n, u32 k,
+    const f32* packed_a,
+    b32 transpose_b, const f32* b, u32 ldb,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/// `gemm_f32_custom_b` with an op(A) that was already packed by `gemm_pack_a_full`
+void gemm_f32_packed_a_custom_b(
+    u32 m, u32 n, u32 k,
+    const f32* packed_a,
+    gemm_pack_b_func* pack_b, void* pack_b_ctx,
+    f32* c, u32 ldc,
+    b32 accumulate
+);
+
+/**
+ * @brief Runs `gemm_f32` on `batch_size` matrices at fixed strides
+ *
+ * Slice z is `a + z * stride_a`, `b + z * stride_b` and `c + z * stride_c`.
+ * A `stride_b` of 0 shares B between every slice, and it is only packed once.
+ * The same goes for A with a `stride_a` of 0, when B is not shared.
+ * Slices are split across the tensor thread pool (see parallel.h)
+ */
+void gemm_f32_batched(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda, u64 stride_a,
+    const f32* b, u32 ldb, u64 stride_b,
+    f32* c, u32 ldc, u64 stride_c,
+    u32 batch_size, b32 accumulate
+);
+
+/**
+ * @brief CPU backend of `tensor_dot_ip`
+ *
+ * Shapes must already be validated by `tensor_dot_ip`.
+ * `out` is allowed to be the same tensor as `a` or `b`.
+ * Any of the three can be f16 or bf16
+ */
+void gemm_tensor_dot(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b);
+
+/**
+ * @brief CPU backend of `tensor_dot_batched_ip`
+ *
+ * Shapes must already be validated by `tensor_dot_batched_ip`.
+ * `out` is allowed to be the same tensor as `a` or `b`.
+ * Any of the three can be f16 or bf16
+ */
+void gemm_tensor_dot_batched(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b);
+
+#endif // GEMM_H
@@ -0,0 +1,370 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "half.h"
+
+#include <string.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * The scalar conversions are exact integer versions of what F16C and AVX512-BF16 do,
+ * so the SIMD kernels can use them for their tails.
+ * Every SIMD loop does one full vector per iteration, conversions are bound by memory anyway
+ */
+
+static inline u32 _half_f32_bits(f32 x) {
+    u32 u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static inline f32 _half_bits_f32(u32 u) {
+    f32 x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+static inline f32 _half_f16_to_f32_one(u16 h) {
+    u32 sign = (u32)(h & 0x8000) << 16;
+    u32 u = (u32)(h & 0x7fff) << 13;
+    u32 exp = u & 0x0f800000;
+
+    // Rebias the exponent from 15 to 127
+    u += (127 - 15) << 23;
+
+    if (exp == 0x0f800000) {
+        // Inf and NaN keep the max exponent. NaNs come out quiet, like with F16C
+        u += (128 - 16) << 23;
+        if ((h & 0x3ff) != 0) {
+            u |= 0x00400000;
+        }
+    } else if (exp == 0) {
+        // Denormals get an implicit one, which the subtraction removes again while normalizing
+        u += 1 << 23;
+        u = _half_f32_bits(_half_bits_f32(u) - _half_bits_f32(113 << 23));
+    }
+
+    return _half_bits_f32(u | sign);
+}
+
+static inline u16 _half_f32_to_f16_one(f32 x) {
+    u32 u = _half_f32_bits(x);
+    u32 sign = (u >> 16) & 0x8000;
+    u &= 0x7fffffff;
+
+    if (u >= 0x7f800000) {
+        return (u16)(sign | (u > 0x7f800000 ? 0x7e00 | ((u >> 13) & 0x3ff) : 0x7c00));
+    }
+
+    // 65520 and up rounds past the largest f16 (65504)
+    if (u >= 0x477ff000) {
+        return (u16)(sign | 0x7c00);
+    }
+
+    // Below 2^-14 the result is denormal. Adding 0.5 lines the f16 mantissa up
+    // with the bottom of the f32 mantissa, so the FPU does the rounding
+    if (u < 0x38800000) {
+        f32 f = _half_bits_f32(u) + 0.5f;
+        return (u16)(sign | (_half_f32_bits(f) - 0x3f000000));
+    }
+
+    // Rebias the exponent and round to nearest even on the 13 dropped bits
+    u32 odd = (u >> 13) & 1;
+    u += ((u32)(15 - 127) << 23) + 0xfff + odd;
+
+    return (u16)(sign | (u >> 13));
+}
+
+static inline f32 _half_bf16_to_f32_one(u16 h) {
+    return _half_bits_f32((u32)h << 16);
+}
+
+static inline u16 _half_f32_to_bf16_one(f32 x) {
+    u32 u = _half_f32_bits(x);
+
+    if ((u & 0x7fffffff) > 0x7f800000) {
+        return (u16)((u >> 16) | 0x40);
+    }
+    if ((u & 0x7f800000) == 0) {
+        return (u16)((u >> 16) & 0x8000);
+    }
+
+    u += 0x7fff + ((u >> 16) & 1);
+
+    return (u16)(u >> 16);
+}
+
+static void _half_f16_to_f32_scalar(f32* out, const u16* in, u64 size) {
+    for (u64 i = 0; i < size; i++) {
+        out[i] = _half_f16_to_f32_one(in[i]);
+    }
+}
+
+static void _half_f32_to_f16_scalar(u16* out, const f32* in, u64 size) {
+    for (u64 i = 0; i < size; i++) {
+        out[i] = _half_f32_to_f16_one(in[i]);
+    }
+}
+
+static void _half_bf16_to_f32_scalar(f32* out, const u16* in, u64 size) {
+    for (u64 i = 0; i < size; i++) {
+        out[i] = _half_bf16_to_f32_one(in[i]);
+    }
+}
+
+static void _half_f32_to_bf16_scalar(u16* out, const f32* in, u64 size) {
+    for (u64 i = 0; i < size; i++) {
+        out[i] = _half_f32_to_bf16_one(in[i]);
+    }
+}
+
+static const half_kernels _half_kernels_scalar = {
+    .f16_to_f32 = _half_f16_to_f32_scalar,
+    .f32_to_f16 = _half_f32_to_f16_scalar,
+    .bf16_to_f32 = _half_bf16_to_f32_scalar,
+    .f32_to_bf16 = _half_f32_to_bf16_scalar,
+};
+
+#if SIMD_X86
+
+SIMD_TARGET_SSE static void _half_bf16_to_f32_sse(f32* out, const u16* in, u64 size) {
+    u64 i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_slli_epi32(h, 16));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_bf16_to_f32_one(in[i]);
+    }
+}
+
+// Rounds the f32 bits in `u` to bf16, leaving the result in the low half of each lane
+SIMD_TARGET_SSE static inline __m128i _half_round_bf16_sse(__m128i u) {
+    __m128i abs = _mm_and_si128(u, _mm_set1_epi32(0x7fffffff));
+    __m128i is_nan = _mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7f800000));
+    __m128i is_denorm = _mm_cmpeq_epi32(_mm_and_si128(u, _mm_set1_epi32(0x7f800000)), _mm_setzero_si128());
+
+    __m128i odd = _mm_and_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(1));
+    __m128i rounded = _mm_srli_epi32(_mm_add_epi32(u, _mm_add_epi32(odd, _mm_set1_epi32(0x7fff))), 16);
+    __m128i nan = _mm_or_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(0x40));
+    __m128i zero = _mm_and_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(0x8000));
+
+    __m128i out = _mm_blendv_epi8(rounded, zero, is_denorm);
+    return _mm_blendv_epi8(out, nan, is_nan);
+}
+
+SIMD_TARGET_SSE static void _half_f32_to_bf16_sse(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m128i lo = _half_round_bf16_sse(_mm_loadu_si128((const __m128i*)(in + i)));
+        __m128i hi = _half_round_bf16_sse(_mm_loadu_si128((const __m128i*)(in + i + 4)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi32(lo, hi));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_bf16_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX2_F16C static void _half_f16_to_f32_f16c(f32* out, const u16* in, u64 size) {
+    u64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f16_to_f32_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX2_F16C static void _half_f32_to_f16_f16c(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128((__m128i*)(out + i), h);
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_f16_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX2 static void _half_bf16_to_f32_avx2(f32* out, const u16* in, u64 size) {
+    u64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_slli_epi32(h, 16));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_bf16_to_f32_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX2 static void _half_f32_to_bf16_avx2(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i u = _mm256_loadu_si256((const __m256i*)(in + i));
+
+        __m256i abs = _mm256_and_si256(u, _mm256_set1_epi32(0x7fffffff));
+        __m256i is_nan = _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x7f800000));
+        __m256i is_denorm = _mm256_cmpeq_epi32(
+            _mm256_and_si256(u, _mm256_set1_epi32(0x7f800000)), _mm256_setzero_si256()
+        );
+
+        __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(1));
+        __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff))), 16);
+        __m256i nan = _mm256_or_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(0x40));
+        __m256i zero = _mm256_and_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(0x8000));
+
+        __m256i r = _mm256_blendv_epi8(_mm256_blendv_epi8(rounded, zero, is_denorm), nan, is_nan);
+
+        // packus works within 128-bit lanes, so pack the two halves instead
+        __m128i h = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+        _mm_storeu_si128((__m128i*)(out + i), h);
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_bf16_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX512 static void _half_f16_to_f32_avx512(f32* out, const u16* in, u64 size) {
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(in + i))));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f16_to_f32_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX512 static void _half_f32_to_f16_avx512(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256((__m256i*)(out + i), h);
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_f16_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX512 static void _half_bf16_to_f32_avx512(f32* out, const u16* in, u64 size) {
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m512i h = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(in + i)));
+        _mm512_storeu_si512(out + i, _mm512_slli_epi32(h, 16));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_bf16_to_f32_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX512 static void _half_f32_to_bf16_avx512(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m512i u = _mm512_loadu_si512(in + i);
+
+        __mmask16 is_nan = _mm512_cmpgt_epi32_mask(
+            _mm512_and_si512(u, _mm512_set1_epi32(0x7fffffff)), _mm512_set1_epi32(0x7f800000)
+        );
+        __mmask16 is_denorm = _mm512_testn_epi32_mask(u, _mm512_set1_epi32(0x7f800000));
+
+        __m512i odd = _mm512_and_si512(_mm512_srli_epi32(u, 16), _mm512_set1_epi32(1));
+        __m512i r = _mm512_srli_epi32(_mm512_add_epi32(u, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7fff))), 16);
+        r = _mm512_mask_and_epi32(r, is_denorm, _mm512_srli_epi32(u, 16), _mm512_set1_epi32(0x8000));
+        r = _mm512_mask_or_epi32(r, is_nan, _mm512_srli_epi32(u, 16), _mm512_set1_epi32(0x40));
+
+        _mm256_storeu_si256((__m256i*)(out + i), _mm512_cvtepi32_epi16(r));
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_bf16_one(in[i]);
+    }
+}
+
+SIMD_TARGET_AVX512_BF16 static void _half_f32_to_bf16_avx512_bf16(u16* out, const f32* in, u64 size) {
+    u64 i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(in + i));
+        _mm256_storeu_si256((__m256i*)(out + i), (__m256i)h);
+    }
+    for (; i < size; i++) {
+        out[i] = _half_f32_to_bf16_one(in[i]);
+    }
+}
+
+static const half_kernels _half_kernels_sse = {
+    .f16_to_f32 = _half_f16_to_f32_scalar,
+    .f32_to_f16 = _half_f32_to_f16_scalar,
+    .bf16_to_f32 = _half_bf16_to_f32_sse,
+    .f32_to_bf16 = _half_f32_to_bf16_sse,
+};
+
+static const half_kernels _half_kernels_avx2 = {
+    .f16_to_f32 = _half_f16_to_f32_scalar,
+    .f32_to_f16 = _half_f32_to_f16_scalar,
+    .bf16_to_f32 = _half_bf16_to_f32_avx2,
+    .f32_to_bf16 = _half_f32_to_bf16_avx2,
+};
+
+static const half_kernels _half_kernels_avx2_f16c = {
+    .f16_to_f32 = _half_f16_to_f32_f16c,
+    .f32_to_f16 = _half_f32_to_f16_f16c,
+    .bf16_to_f32 = _half_bf16_to_f32_avx2,
+    .f32_to_bf16 = _half_f32_to_bf16_avx2,
+};
+
+static const half_kernels _half_kernels_avx512 = {
+    .f16_to_f32 = _half_f16_to_f32_avx512,
+    .f32_to_f16 = _half_f32_to_f16_avx512,
+    .bf16_to_f32 = _half_bf16_to_f32_avx512,
+    .f32_to_bf16 = _half_f32_to_bf16_avx512,
+};
+
+static const half_kernels _half_kernels_avx512_bf16 = {
+    .f16_to_f32 = _half_f16_to_f32_avx512,
+    .f32_to_f16 = _half_f32_to_f16_avx512,
+    .bf16_to_f32 = _half_bf16_to_f32_avx512,
+    .f32_to_bf16 = _half_f32_to_bf16_avx512_bf16,
+};
+
+#endif // SIMD_X86
+
+const half_kernels* half_kernels_get_level(simd_level level) {
+    level = MIN(level, simd_get_supported_level());
+
+    switch (level) {
+#if SIMD_X86
+        case SIMD_LEVEL_AVX512: {
+            return simd_has_feature(SIMD_FEATURE_AVX512_BF16) ?
+                &_half_kernels_avx512_bf16 : &_half_kernels_avx512;
+        }
+        case SIMD_LEVEL_AVX2: {
+            return simd_has_feature(SIMD_FEATURE_F16C) ?
+                &_half_kernels_avx2_f16c : &_half_kernels_avx2;
+        }
+        case SIMD_LEVEL_SSE: return &_half_kernels_sse;
+#endif
+        default: return &_half_kernels_scalar;
+    }
+}
+
+const half_kernels* half_kernels_get(void) {
+    return half_kernels_get_level(simd_get_level());
+}
+
+half_to_f32_func* half_get_to_f32(tensor_dtype dtype) {
+    switch (dtype) {
+        case TENSOR_DTYPE_F16: return half_kernels_get()->f16_to_f32;
+        case TENSOR_DTYPE_BF16: return half_kernels_get()->bf16_to_f32;
+        default: return NULL;
+    }
+}
+
+half_from_f32_func* half_get_from_f32(tensor_dtype dtype) {
+    switch (dtype) {
+        case TENSOR_DTYPE_F16: return half_kernels_get()->f32_to_f16;
+        case TENSOR_DTYPE_BF16: return half_kernels_get()->f32_to_bf16;
+        default: return NULL;
+    }
+}
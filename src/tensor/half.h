@@ -0,0 +1,50 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file half.h
+ * @brief Conversions between f32 and the 16-bit storage types f16 and bf16
+ *
+ * Half precision values are stored as raw `u16` bits:
+ *  - f16 is IEEE binary16 (5 exponent bits, 10 mantissa bits)
+ *  - bf16 is the upper half of an f32 (8 exponent bits, 7 mantissa bits)
+ *
+ * Conversions to half round to nearest even. Infinities are kept, NaNs stay NaN
+ * (quiet, with the top of the payload). f32 values too large for f16 become inf. <br>
+ * f16 keeps denormals. bf16 flushes f32 denormals to zero, like VCVTNEPS2BF16 does. <br>
+ * Every level returns the same bits. The AVX2 and AVX-512 levels use F16C and AVX512-BF16
+ * when `simd_has_feature` reports them, and integer rounding otherwise
+ */
+
+#ifndef HALF_H
+#define HALF_H
+
+#include "../../include/base_defs.h"
+#include "../../include/tensorNew.h"
+#include "simd.h"
+
+/// `out[i] = f32(in[i])`
+typedef void (half_to_f32_func)(f32* out, const u16* in, u64 size);
+/// `out[i] = half(in[i])`
+typedef void (half_from_f32_func)(u16* out, const f32* in, u64 size);
+
+/// Table of conversion kernels for one `simd_level`
+typedef struct {
+    half_to_f32_func* f16_to_f32;
+    half_from_f32_func* f32_to_f16;
+    half_to_f32_func* bf16_to_f32;
+    half_from_f32_func* f32_to_bf16;
+} half_kernels;
+
+/// Returns the kernels for the active `simd_level` (see `simd_get_level`)
+const half_kernels* half_kernels_get(void);
+/// Returns the kernels for a specific `simd_level`, clamped to what the CPU supports
+const half_kernels* half_kernels_get_level(simd_level level);
+
+/// Returns the active kernel converting `dtype` to f32, or NULL if `dtype` is not a half type
+half_to_f32_func* half_get_to_f32(tensor_dtype dtype);
+/// Returns the active kernel converting f32 to `dtype`, or NULL if `dtype` is not a half type
+half_from_f32_func* half_get_from_f32(tensor_dtype dtype);
+
+#endif // HALF_H
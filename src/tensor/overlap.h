@@ -0,0 +1,41 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file overlap.h
+ * @brief Aliasing checks shared by the tensor kernels
+ *
+ * Ranges are compared in bytes, and tensor ranges cover `alloc` elements of the tensor's dtype,
+ * so tensors of different dtypes are compared correctly
+ */
+
+#ifndef OVERLAP_H
+#define OVERLAP_H
+
+#include "../../include/tensorNew.h"
+
+/// Returns true if [a_start, a_end) and [b_start, b_end) share any byte
+static inline b32 tensor_ranges_overlap(
+    const void* a_start, const void* a_end, const void* b_start, const void* b_end
+) {
+    return (const u8*)a_start < (const u8*)b_end && (const u8*)b_start < (const u8*)a_end;
+}
+
+/// Returns true if the allocation of `t` shares any byte with [start, end)
+static inline b32 tensor_overlaps_range(const tensor* t, const void* start, const void* end) {
+    const u8* t_start = (const u8*)t->data;
+    const u8* t_end = t_start + tensor_dtype_size(t->dtype) * t->alloc;
+
+    return tensor_ranges_overlap(t_start, t_end, start, end);
+}
+
+/// Returns true if the allocations of `a` and `b` share any byte
+static inline b32 tensor_overlaps(const tensor* a, const tensor* b) {
+    const u8* b_start = (const u8*)b->data;
+    const u8* b_end = b_start + tensor_dtype_size(b->dtype) * b->alloc;
+
+    return tensor_overlaps_range(a, b_start, b_end);
+}
+
+#endif // OVERLAP_H
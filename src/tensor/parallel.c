@@ -0,0 +1,155 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "parallel.h"
+
+#include <stdbool.h>
+
+#include "../../include/tensorNew.h"
+#include "simd.h"
+
+// Number of parallel_for calls that can be split at the same time, later ones run inline
+#define _PARALLEL_MAX_CALLS 64
+// Ranges are about the same size, so the caller usually only waits briefly before yielding
+#define _PARALLEL_SPIN_COUNT 4096
+
+static thread_pool* _parallel_pool = NULL;
+static u32 _parallel_num_threads = 1;
+
+// Set while a thread runs a range, so that nested calls do not wait on the pool from inside it
+static THREAD_VAR b32 _parallel_in_task = false;
+
+// One parallel_for in progress.
+// Slots are never freed, so a pool task that starts after its call returned can still read one
+typedef struct {
+    // (number of ranges << 32) | next unclaimed range. 0 while the slot is being set up
+    u64 claim;
+    // Ranges claimed but not finished, and ranges not claimed yet
+    u32 remaining;
+    b32 busy;
+
+    parallel_func* func;
+    void* ctx;
+    u32 count;
+} _parallel_call;
+
+static _parallel_call _parallel_calls[_PARALLEL_MAX_CALLS];
+
+void tensor_set_thread_pool(thread_pool* pool, u32 num_threads) {
+    _parallel_pool = pool;
+    _parallel_num_threads = pool == NULL ? 1 : MAX(1, num_threads);
+}
+
+thread_pool* tensor_get_thread_pool(void) {
+    return _parallel_pool;
+}
+
+u32 parallel_get_num_threads(void) {
+    if (_parallel_pool == NULL || _parallel_in_task) {
+        return 1;
+    }
+
+    return _parallel_num_threads;
+}
+
+// Claims and runs ranges of the call until none are left.
+// Fields are only read after a successful claim, when the call cannot finish yet
+static void _parallel_run_ranges(_parallel_call* call) {
+    b32 prev_in_task = _parallel_in_task;
+    _parallel_in_task = true;
+
+    u64 claim = __atomic_load_n(&call->claim, __ATOMIC_ACQUIRE);
+
+    while (true) {
+        u32 num_ranges = (u32)(claim >> 32);
+        u32 index = (u32)claim;
+
+        if (index >= num_ranges) {
+            break;
+        }
+
+        if (!__atomic_compare_exchange_n(
+            &call->claim, &claim, claim + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE
+        )) {
+            continue;
+        }
+
+        u32 start = (u32)((u64)call->count * index / num_ranges);
+        u32 end = (u32)((u64)call->count * (index + 1) / num_ranges);
+
+        call->func(call->ctx, start, end);
+
+        __atomic_fetch_sub(&call->remaining, 1, __ATOMIC_RELEASE);
+
+        claim = __atomic_load_n(&call->claim, __ATOMIC_ACQUIRE);
+    }
+
+    _parallel_in_task = prev_in_task;
+}
+
+static void _parallel_task(void* arg) {
+    _parallel_run_ranges((_parallel_call*)arg);
+}
+
+static _parallel_call* _parallel_call_acquire(void) {
+    for (u32 i = 0; i < _PARALLEL_MAX_CALLS; i++) {
+        b32 expected = false;
+
+        if (__atomic_compare_exchange_n(
+            &_parallel_calls[i].busy, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+        )) {
+            return &_parallel_calls[i];
+        }
+    }
+
+    return NULL;
+}
+
+void parallel_for(u32 count, parallel_func* func, void* ctx) {
+    u32 num_ranges = MIN(parallel_get_num_threads(), count);
+    _parallel_call* call = num_ranges > 1 ? _parallel_call_acquire() : NULL;
+
+    if (call == NULL) {
+        if (count != 0) {
+            func(ctx, 0, count);
+        }
+
+        return;
+    }
+
+    call->func = func;
+    call->ctx = ctx;
+    call->count = count;
+    call->remaining = num_ranges;
+
+    // Publishes the fields above to the tasks that claim a range
+    __atomic_store_n(&call->claim, (u64)num_ranges << 32, __ATOMIC_RELEASE);
+
+    for (u32 i = 1; i < num_ranges; i++) {
+        thread_task task = { .func = _parallel_task, .arg = call };
+
+        // A full task queue is not an error, the caller claims the range
+        if (!thread_pool_add_task(_parallel_pool, task)) {
+            break;
+        }
+    }
+
+    // Also runs every range no pool thread has started yet,
+    // so the wait below never depends on tasks still in the queue.
+    // That keeps parallel_for safe to call from other tasks on the same pool
+    _parallel_run_ranges(call);
+
+    for (u32 spins = 0; __atomic_load_n(&call->remaining, __ATOMIC_ACQUIRE) != 0; spins++) {
+        if (spins < _PARALLEL_SPIN_COUNT) {
+#if SIMD_X86
+            __builtin_ia32_pause();
+#endif
+        } else {
+            sleep_msec(0);
+        }
+    }
+
+    __atomic_store_n(&call->claim, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&call->busy, false, __ATOMIC_RELEASE);
+}
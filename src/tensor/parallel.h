@@ -0,0 +1,43 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file parallel.h
+ * @brief Splits CPU tensor kernels across the thread pool set with `tensor_set_thread_pool`
+ *
+ * Calls made from inside a pool task run inline,
+ * so a kernel called from a worker thread can never wait on its own pool
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "../../include/base_defs.h"
+#include "../../include/os.h"
+
+/**
+ * @brief Work function for `parallel_for`
+ *
+ * @param ctx Context passed into `parallel_for`
+ * @param start First index of the range
+ * @param end One past the last index of the range
+ */
+typedef void (parallel_func)(void* ctx, u32 start, u32 end);
+
+/**
+ * @brief Number of threads that `parallel_for` splits work across
+ *
+ * 1 if there is no thread pool or if the caller is already a pool task
+ */
+u32 parallel_get_num_threads(void);
+
+/**
+ * @brief Runs `func` over [0, count), split into at most one range per thread
+ *
+ * The calling thread runs every range no pool thread has started.
+ * Returns once every range of this call is done, without waiting on other pool tasks
+ */
+void parallel_for(u32 count, parallel_func* func, void* ctx);
+
+#endif // PARALLEL_H
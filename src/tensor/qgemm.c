@@ -0,0 +1,343 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "qgemm.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../mg/mg_arena.h"
+#include "gemm.h"
+#include "parallel.h"
+#include "simd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Same blocking idea as gemm.c, but B is always packed ahead of time (weights),
+ * so only A gets packed per block:
+ *
+ * for each block of QGEMM_MB rows of A:   quantize/gather the rows into a zero padded buffer
+ *   for jp in column panels:              one k x NR panel of B, streamed from the packed weights
+ *     for ir in MB by MR:                 MR x NR tile of int32 C in registers
+ *       micro-kernel
+ *   dequantize the int32 block into C
+ *
+ * The micro-kernels broadcast 4 consecutive bytes of a row of A,
+ * and multiply them with the 4 bytes each column has for the same 4 rows of B
+ */
+
+// Rows of A packed per block
+#define _QGEMM_MB 64
+
+static u32 _qgemm_round_up(u32 x, u32 multiple) {
+    return (x + multiple - 1) / multiple * multiple;
+}
+
+u64 qgemm_packed_b_size(u32 n, u32 k) {
+    return (u64)_qgemm_round_up(n, QGEMM_NR) * _qgemm_round_up(k, QGEMM_KU);
+}
+
+static u64 _qgemm_packed_b_index(u32 k, u32 row, u32 col) {
+    u32 k4 = _qgemm_round_up(k, QGEMM_KU) / QGEMM_KU;
+    u32 jp = col / QGEMM_NR;
+    u32 p4 = row / QGEMM_KU;
+
+    return (((u64)jp * k4 + p4) * QGEMM_NR + col % QGEMM_NR) * QGEMM_KU + row % QGEMM_KU;
+}
+
+void qgemm_pack_b(i8* packed_b, i32* col_sums, u32 n, u32 k, const i8* b, u32 ldb) {
+    memset(packed_b, 0, qgemm_packed_b_size(n, k));
+    memset(col_sums, 0, sizeof(i32) * n);
+
+    for (u32 p = 0; p < k; p++) {
+        const i8* row = b + (u64)p * ldb;
+
+        for (u32 j = 0; j < n; j++) {
+            packed_b[_qgemm_packed_b_index(k, p, j)] = row[j];
+            col_sums[j] += row[j];
+        }
+    }
+}
+
+i8 qgemm_packed_b_get(const i8* packed_b, u32 k, u32 row, u32 col) {
+    return packed_b[_qgemm_packed_b_index(k, row, col)];
+}
+
+void qgemm_quantize_a(u8* out, const f32* in, u64 size, f32 scale, i32 zero_point) {
+    f32 inv_scale = 1.0f / scale;
+    f32 lo = (f32)-zero_point;
+    f32 hi = (f32)(QGEMM_A_MAX - zero_point);
+
+    for (u64 i = 0; i < size; i++) {
+        // Clamping first keeps NaN out and lets the magic number round to nearest even
+        f32 x = in[i] * inv_scale;
+        x = x > lo ? x : lo;
+        x = x < hi ? x : hi;
+        x = (x + 12582912.0f) - 12582912.0f;
+
+        out[i] = (u8)((i32)x + zero_point);
+    }
+}
+
+// Computes a QGEMM_MR x QGEMM_NR tile of int32 C over k4 groups of QGEMM_KU
+typedef void (_qgemm_kernel_func)(u32 k4, const u8* a, u32 lda, const i8* bp, i32* c, u32 ldc);
+
+static void _qgemm_kernel_scalar(u32 k4, const u8* a, u32 lda, const i8* bp, i32* c, u32 ldc) {
+    i32 acc[QGEMM_MR][QGEMM_NR] = { 0 };
+
+    for (u32 p4 = 0; p4 < k4; p4++) {
+        for (u32 i = 0; i < QGEMM_MR; i++) {
+            const u8* a_group = a + (u64)i * lda + (u64)p4 * QGEMM_KU;
+
+            for (u32 j = 0; j < QGEMM_NR; j++) {
+                const i8* b_group = bp + j * QGEMM_KU;
+
+                for (u32 q = 0; q < QGEMM_KU; q++) {
+                    acc[i][j] += (i32)a_group[q] * b_group[q];
+                }
+            }
+        }
+
+        bp += QGEMM_NR * QGEMM_KU;
+    }
+
+    for (u32 i = 0; i < QGEMM_MR; i++) {
+        memcpy(c + (u64)i * ldc, acc[i], sizeof(i32) * QGEMM_NR);
+    }
+}
+
+#if SIMD_X86
+
+static inline i32 _qgemm_load_group(const u8* a, u32 lda, u32 row, u32 p4) {
+    i32 group;
+    memcpy(&group, a + (u64)row * lda + (u64)p4 * QGEMM_KU, sizeof(group));
+    return group;
+}
+
+// VPMADDUBSW sums pairs into int16, VPMADDWD with ones sums those pairs into int32
+#define _QGEMM_ROW_AVX2(r) do { \
+        __m256i a##r = _mm256_set1_epi32(_qgemm_load_group(a, lda, r, p4)); \
+        c##r##0 = _mm256_add_epi32(c##r##0, _mm256_madd_epi16(_mm256_maddubs_epi16(a##r, b0), ones)); \
+        c##r##1 = _mm256_add_epi32(c##r##1, _mm256_madd_epi16(_mm256_maddubs_epi16(a##r, b1), ones)); \
+    } while (0)
+
+#define _QGEMM_ROW_AVX2_VNNI(r) do { \
+        __m256i a##r = _mm256_set1_epi32(_qgemm_load_group(a, lda, r, p4)); \
+        c##r##0 = _mm256_dpbusd_avx_epi32(c##r##0, a##r, b0); \
+        c##r##1 = _mm256_dpbusd_avx_epi32(c##r##1, a##r, b1); \
+    } while (0)
+
+#define _QGEMM_ROW_STORE_AVX2(r) do { \
+        _mm256_storeu_si256((__m256i*)(c + (u64)r * ldc), c##r##0); \
+        _mm256_storeu_si256((__m256i*)(c + (u64)r * ldc + 8), c##r##1); \
+    } while (0)
+
+#define _QGEMM_KERNEL_AVX2(name, attr, row_op) \
+    attr static void name(u32 k4, const u8* a, u32 lda, const i8* bp, i32* c, u32 ldc) { \
+        __m256i ones = _mm256_set1_epi16(1); \
+        UNUSED(ones); \
+        __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256(); \
+        __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256(); \
+        __m256i c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256(); \
+        __m256i c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256(); \
+        for (u32 p4 = 0; p4 < k4; p4++) { \
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)bp); \
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)(bp + 32)); \
+            row_op(0); \
+            row_op(1); \
+            row_op(2); \
+            row_op(3); \
+            bp += QGEMM_NR * QGEMM_KU; \
+        } \
+        _QGEMM_ROW_STORE_AVX2(0); \
+        _QGEMM_ROW_STORE_AVX2(1); \
+        _QGEMM_ROW_STORE_AVX2(2); \
+        _QGEMM_ROW_STORE_AVX2(3); \
+    }
+
+_QGEMM_KERNEL_AVX2(_qgemm_kernel_avx2, SIMD_TARGET_AVX2, _QGEMM_ROW_AVX2)
+_QGEMM_KERNEL_AVX2(_qgemm_kernel_avx2_vnni, SIMD_TARGET_AVX2_VNNI, _QGEMM_ROW_AVX2_VNNI)
+
+#define _QGEMM_ROW_AVX512_VNNI(r) do { \
+        c##r = _mm512_dpbusd_epi32(c##r, _mm512_set1_epi32(_qgemm_load_group(a, lda, r, p4)), b); \
+    } while (0)
+
+SIMD_TARGET_AVX512_VNNI static void _qgemm_kernel_avx512_vnni(
+    u32 k4, const u8* a, u32 lda, const i8* bp, i32* c, u32 ldc
+) {
+    __m512i c0 = _mm512_setzero_si512(), c1 = _mm512_setzero_si512();
+    __m512i c2 = _mm512_setzero_si512(), c3 = _mm512_setzero_si512();
+
+    for (u32 p4 = 0; p4 < k4; p4++) {
+        __m512i b = _mm512_loadu_si512(bp);
+
+        _QGEMM_ROW_AVX512_VNNI(0);
+        _QGEMM_ROW_AVX512_VNNI(1);
+        _QGEMM_ROW_AVX512_VNNI(2);
+        _QGEMM_ROW_AVX512_VNNI(3);
+
+        bp += QGEMM_NR * QGEMM_KU;
+    }
+
+    _mm512_storeu_si512(c, c0);
+    _mm512_storeu_si512(c + ldc, c1);
+    _mm512_storeu_si512(c + 2 * (u64)ldc, c2);
+    _mm512_storeu_si512(c + 3 * (u64)ldc, c3);
+}
+
+#undef _QGEMM_ROW_AVX2
+#undef _QGEMM_ROW_AVX2_VNNI
+#undef _QGEMM_ROW_STORE_AVX2
+#undef _QGEMM_KERNEL_AVX2
+#undef _QGEMM_ROW_AVX512_VNNI
+
+#endif // SIMD_X86
+
+static _qgemm_kernel_func* _qgemm_get_kernel(void) {
+#if SIMD_X86
+    simd_level level = simd_get_level();
+
+    if (level >= SIMD_LEVEL_AVX512 && simd_has_feature(SIMD_FEATURE_AVX512_VNNI)) {
+        return _qgemm_kernel_avx512_vnni;
+    }
+    if (level >= SIMD_LEVEL_AVX2) {
+        return simd_has_feature(SIMD_FEATURE_AVX_VNNI) ? _qgemm_kernel_avx2_vnni : _qgemm_kernel_avx2;
+    }
+#endif
+
+    return _qgemm_kernel_scalar;
+}
+
+typedef struct {
+    const qgemm_desc* desc;
+    _qgemm_kernel_func* kernel;
+
+    // Padded row stride of the packed A blocks
+    u32 lda;
+    u32 num_panels;
+
+    // Work grid, in blocks of _QGEMM_MB rows and groups of column panels
+    u32 grid_m;
+    u32 grid_n;
+
+    // a_scale * b_scales[j] and a_zero_point * b_col_sums[j]
+    const f32* scales;
+    const i32* offsets;
+} _qgemm_args;
+
+// Computes rows [i0, i0 + rows) and column panels [jp0, jp1) of C
+static void _qgemm_block(const _qgemm_args* args, u32 i0, u32 rows, u32 jp0, u32 jp1) {
+    const qgemm_desc* desc = args->desc;
+
+    u32 lda = args->lda;
+    u32 k4 = lda / QGEMM_KU;
+    u32 rows_pad = _qgemm_round_up(rows, QGEMM_MR);
+    u32 ldt = (jp1 - jp0) * QGEMM_NR;
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // Zero padding on both sides of A and B keeps the padded products at zero
+    u8* a = MGA_PUSH_ZERO_ARRAY_ALIGNED(scratch.arena, u8, (u64)rows_pad * lda, TENSOR_ALIGN);
+    i32* tile = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, i32, (u64)rows_pad * ldt, TENSOR_ALIGN);
+
+    desc->pack_a(desc->pack_a_ctx, a, lda, i0, rows);
+
+    for (u32 jp = jp0; jp < jp1; jp++) {
+        const i8* bp = desc->packed_b + (u64)jp * k4 * QGEMM_NR * QGEMM_KU;
+
+        for (u32 ir = 0; ir < rows_pad; ir += QGEMM_MR) {
+            args->kernel(k4, a + (u64)ir * lda, lda, bp, tile + (u64)ir * ldt + (jp - jp0) * QGEMM_NR, ldt);
+        }
+    }
+
+    u32 j0 = jp0 * QGEMM_NR;
+    u32 j1 = MIN(jp1 * QGEMM_NR, desc->n);
+
+    for (u32 r = 0; r < rows; r++) {
+        const i32* src = tile + (u64)r * ldt;
+        u32 i = i0 + r;
+
+        if (desc->transpose_c) {
+            for (u32 j = j0; j < j1; j++) {
+                desc->c[i + (u64)j * desc->ldc] = (f32)(src[j - j0] - args->offsets[j]) * args->scales[j];
+            }
+        } else {
+            f32* dst = desc->c + (u64)i * desc->ldc;
+
+            for (u32 j = j0; j < j1; j++) {
+                dst[j] = (f32)(src[j - j0] - args->offsets[j]) * args->scales[j];
+            }
+        }
+    }
+
+    mga_scratch_release(scratch);
+}
+
+static void _qgemm_range(void* ctx, u32 start, u32 end) {
+    const _qgemm_args* args = (const _qgemm_args*)ctx;
+    u32 m = args->desc->m;
+
+    for (u32 t = start; t < end; t++) {
+        u32 gi = t % args->grid_m;
+        u32 gj = t / args->grid_m;
+
+        u32 i0 = gi * _QGEMM_MB;
+        u32 jp0 = (u32)((u64)args->num_panels * gj / args->grid_n);
+        u32 jp1 = (u32)((u64)args->num_panels * (gj + 1) / args->grid_n);
+
+        if (jp0 < jp1) {
+            _qgemm_block(args, i0, MIN(_QGEMM_MB, m - i0), jp0, jp1);
+        }
+    }
+}
+
+void qgemm_u8s8(const qgemm_desc* desc) {
+    u32 m = desc->m;
+    u32 n = desc->n;
+
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    f32* scales = MGA_PUSH_ARRAY(scratch.arena, f32, n);
+    i32* offsets = MGA_PUSH_ARRAY(scratch.arena, i32, n);
+
+    for (u32 j = 0; j < n; j++) {
+        scales[j] = desc->a_scale * desc->b_scales[j];
+        offsets[j] = desc->a_zero_point * desc->b_col_sums[j];
+    }
+
+    _qgemm_args args = {
+        .desc = desc,
+        .kernel = _qgemm_get_kernel(),
+        .lda = _qgemm_round_up(desc->k, QGEMM_KU),
+        .num_panels = _qgemm_round_up(n, QGEMM_NR) / QGEMM_NR,
+        .grid_m = (m + _QGEMM_MB - 1) / _QGEMM_MB,
+        .grid_n = 1,
+        .scales = scales,
+        .offsets = offsets
+    };
+
+    u32 num_threads = parallel_get_num_threads();
+
+    // Single examples have one block of rows, so their columns get split instead
+    if (num_threads > 1 && (u64)m * n * desc->k >= GEMM_PARALLEL_MIN_WORK && args.grid_m < num_threads) {
+        args.grid_n = MIN(args.num_panels, (num_threads + args.grid_m - 1) / args.grid_m);
+    }
+
+    u32 num_tasks = args.grid_m * args.grid_n;
+
+    if (num_threads > 1 && (u64)m * n * desc->k >= GEMM_PARALLEL_MIN_WORK && num_tasks > 1) {
+        parallel_for(num_tasks, _qgemm_range, &args);
+    } else {
+        _qgemm_range(&args, 0, num_tasks);
+    }
+
+    mga_scratch_release(scratch);
+}
@@ -0,0 +1,110 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file qgemm.h
+ * @brief int8 matrix multiplication for quantized inference (CPU backend of `tensor_dot_quantized_ip`)
+ *
+ * C = dequant(A_u8 * B_s8), with int32 accumulation:
+ *  - A is quantized per tensor to [0, QGEMM_A_MAX] with a scale and zero point:
+ *    `A ~= a_scale * (A_u8 - a_zero_point)`
+ *  - B is quantized per column (output channel) to [-QGEMM_B_MAX, QGEMM_B_MAX]:
+ *    `B[:, j] ~= b_scales[j] * B_s8[:, j]`
+ *
+ * A only uses 7 bits, so the pairs summed by VPMADDUBSW never saturate the int16 lanes.
+ * That way the AVX2 kernel returns the same int32 sums as the VNNI kernels (VPDPBUSD)
+ * and the scalar kernel on every input
+ */
+
+#ifndef QGEMM_H
+#define QGEMM_H
+
+#include "../../include/base_defs.h"
+
+/// Largest quantized value of A
+#define QGEMM_A_MAX 127
+/// Largest magnitude of a quantized value of B
+#define QGEMM_B_MAX 127
+
+/// Rows of C computed by one micro-kernel call
+#define QGEMM_MR 4
+/// Columns of C computed by one micro-kernel call
+#define QGEMM_NR 16
+/// k is padded to a multiple of QGEMM_KU, the depth of one VPDPBUSD lane
+#define QGEMM_KU 4
+
+/// Size in bytes of B packed by `qgemm_pack_b`
+u64 qgemm_packed_b_size(u32 n, u32 k);
+
+/**
+ * @brief Packs a quantized k x n B into the panel layout of the micro-kernels
+ *
+ * Each QGEMM_NR wide panel stores groups of QGEMM_KU rows,
+ * so `packed[((jp * k4 + p4) * QGEMM_NR + j) * QGEMM_KU + p] == B[p4 * 4 + p, jp * 16 + j]`.
+ * Padding is zero
+ *
+ * @param packed_b Output, needs `qgemm_packed_b_size(n, k)` bytes
+ * @param col_sums Output, sum of each column of B. Needs `n` i32s
+ * @param b Row major k x n B
+ * @param ldb Row stride of B
+ */
+void qgemm_pack_b(i8* packed_b, i32* col_sums, u32 n, u32 k, const i8* b, u32 ldb);
+
+/// Reads one element of a packed B back
+i8 qgemm_packed_b_get(const i8* packed_b, u32 k, u32 row, u32 col);
+
+/**
+ * @brief Quantizes `size` f32s to [0, QGEMM_A_MAX]
+ *
+ * `out[i] = clamp(round(in[i] * (1 / scale)) + zero_point, 0, QGEMM_A_MAX)`, rounding to nearest even
+ */
+void qgemm_quantize_a(u8* out, const f32* in, u64 size, f32 scale, i32 zero_point);
+
+/**
+ * @brief Fills rows [i0, i0 + rows) of A
+ *
+ * Row r goes into `a + r * lda`. Only the first k bytes of each row are read
+ * from the ctx, `qgemm_u8s8` zeroes the padding up to `lda`
+ */
+typedef void (qgemm_pack_a_func)(void* ctx, u8* a, u32 lda, u32 i0, u32 rows);
+
+/// Description of one quantized product for `qgemm_u8s8`
+typedef struct {
+    /// Rows of A and C
+    u32 m;
+    /// Columns of B and C
+    u32 n;
+    /// Columns of A and rows of B
+    u32 k;
+
+    /// Produces A a block of rows at a time
+    qgemm_pack_a_func* pack_a;
+    void* pack_a_ctx;
+    f32 a_scale;
+    i32 a_zero_point;
+
+    /// B packed by `qgemm_pack_b`
+    const i8* packed_b;
+    /// Column sums from `qgemm_pack_b`, for the zero point of A
+    const i32* b_col_sums;
+    /// Scale of each column of B
+    const f32* b_scales;
+
+    /// Dequantized output
+    f32* c;
+    /// Row stride of C
+    u32 ldc;
+    /// Stores C transposed (`c[i + j * ldc]`), like the channel major output of a convolution
+    b32 transpose_c;
+} qgemm_desc;
+
+/**
+ * @brief Computes `C = dequant(A_u8 * B_s8)` as described by `desc`
+ *
+ * Blocks of rows are split across the tensor thread pool (see parallel.h).
+ * Uses AVX512-VNNI, AVX-VNNI or AVX2 when the CPU has them
+ */
+void qgemm_u8s8(const qgemm_desc* desc);
+
+#endif // QGEMM_H
@@ -0,0 +1,240 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "reduce.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Like elementwise.c, every instruction set gets the same kernels from the macros below.
+ *
+ * The main loops run four vectors per iteration into four accumulators,
+ * then one vector at a time, then the scalar tail.
+ * The accumulators are combined and reduced horizontally once at the end.
+ *
+ * `hadd`, `hmax` and `hmin` reduce one vector to an f32,
+ * `any_nz` returns nonzero if any lane is not zero (NaN counts as nonzero),
+ * `eq_mask` returns a bit mask of the lanes equal to the second argument
+ */
+
+#define _RED_SUM(name, attr, vec, w, load, set1, vadd, hadd) \
+    attr static f32 name(const f32* x, u64 size) { \
+        vec acc0 = set1(0.0f), acc1 = set1(0.0f), acc2 = set1(0.0f), acc3 = set1(0.0f); \
+        u64 i = 0; \
+        for (; i + 4 * (w) <= size; i += 4 * (w)) { \
+            acc0 = vadd(acc0, load(x + i)); \
+            acc1 = vadd(acc1, load(x + i + (w))); \
+            acc2 = vadd(acc2, load(x + i + 2 * (w))); \
+            acc3 = vadd(acc3, load(x + i + 3 * (w))); \
+        } \
+        for (; i + (w) <= size; i += (w)) { acc0 = vadd(acc0, load(x + i)); } \
+        f32 out = hadd(vadd(vadd(acc0, acc1), vadd(acc2, acc3))); \
+        for (; i < size; i++) { out += x[i]; } \
+        return out; \
+    }
+
+#define _RED_DOT(name, attr, vec, w, load, set1, vadd, vfmadd, hadd) \
+    attr static f32 name(const f32* a, const f32* b, u64 size) { \
+        vec acc0 = set1(0.0f), acc1 = set1(0.0f), acc2 = set1(0.0f), acc3 = set1(0.0f); \
+        u64 i = 0; \
+        for (; i + 4 * (w) <= size; i += 4 * (w)) { \
+            acc0 = vfmadd(load(a + i), load(b + i), acc0); \
+            acc1 = vfmadd(load(a + i + (w)), load(b + i + (w)), acc1); \
+            acc2 = vfmadd(load(a + i + 2 * (w)), load(b + i + 2 * (w)), acc2); \
+            acc3 = vfmadd(load(a + i + 3 * (w)), load(b + i + 3 * (w)), acc3); \
+        } \
+        for (; i + (w) <= size; i += (w)) { acc0 = vfmadd(load(a + i), load(b + i), acc0); } \
+        f32 out = hadd(vadd(vadd(acc0, acc1), vadd(acc2, acc3))); \
+        for (; i < size; i++) { out += a[i] * b[i]; } \
+        return out; \
+    }
+
+#define _RED_SUM_SQUARES(name, attr, vec, w, load, set1, vadd, vfmadd, hadd) \
+    attr static f32 name(const f32* x, u64 size) { \
+        vec acc0 = set1(0.0f), acc1 = set1(0.0f), acc2 = set1(0.0f), acc3 = set1(0.0f); \
+        u64 i = 0; \
+        for (; i + 4 * (w) <= size; i += 4 * (w)) { \
+            vec v0 = load(x + i); \
+            vec v1 = load(x + i + (w)); \
+            vec v2 = load(x + i + 2 * (w)); \
+            vec v3 = load(x + i + 3 * (w)); \
+            acc0 = vfmadd(v0, v0, acc0); \
+            acc1 = vfmadd(v1, v1, acc1); \
+            acc2 = vfmadd(v2, v2, acc2); \
+            acc3 = vfmadd(v3, v3, acc3); \
+        } \
+        for (; i + (w) <= size; i += (w)) { vec v = load(x + i); acc0 = vfmadd(v, v, acc0); } \
+        f32 out = hadd(vadd(vadd(acc0, acc1), vadd(acc2, acc3))); \
+        for (; i < size; i++) { out += x[i] * x[i]; } \
+        return out; \
+    }
+
+// Accumulators start at x[0], so `size` must be at least 1
+#define _RED_EXTREMUM(name, attr, vec, w, load, set1, vop, hop, sop) \
+    attr static f32 name(const f32* x, u64 size) { \
+        vec acc0 = set1(x[0]), acc1 = acc0, acc2 = acc0, acc3 = acc0; \
+        u64 i = 0; \
+        for (; i + 4 * (w) <= size; i += 4 * (w)) { \
+            acc0 = vop(acc0, load(x + i)); \
+            acc1 = vop(acc1, load(x + i + (w))); \
+            acc2 = vop(acc2, load(x + i + 2 * (w))); \
+            acc3 = vop(acc3, load(x + i + 3 * (w))); \
+        } \
+        for (; i + (w) <= size; i += (w)) { acc0 = vop(acc0, load(x + i)); } \
+        f32 out = hop(vop(vop(acc0, acc1), vop(acc2, acc3))); \
+        for (; i < size; i++) { out = x[i] sop out ? x[i] : out; } \
+        return out; \
+    }
+
+// Finds the maximum with all accumulators, then the first element equal to it
+#define _RED_ARGMAX(name, attr, vec, w, load, set1, max_func, eq_mask) \
+    attr static u64 name(const f32* x, u64 size) { \
+        f32 max_val = max_func(x, size); \
+        vec vmax = set1(max_val); \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { \
+            u32 mask = (u32)(eq_mask(load(x + i), vmax)); \
+            if (mask) { return i + (u64)__builtin_ctz(mask); } \
+        } \
+        for (; i < size; i++) { if (x[i] == max_val) { return i; } } \
+        return 0; \
+    }
+
+#define _RED_IS_ZERO(name, attr, vec, w, load, any_nz) \
+    attr static b32 name(const f32* x, u64 size) { \
+        u64 i = 0; \
+        for (; i + 4 * (w) <= size; i += 4 * (w)) { \
+            if (any_nz(load(x + i)) | any_nz(load(x + i + (w))) | \
+                any_nz(load(x + i + 2 * (w))) | any_nz(load(x + i + 3 * (w)))) { return 0; } \
+        } \
+        for (; i + (w) <= size; i += (w)) { if (any_nz(load(x + i))) { return 0; } } \
+        for (; i < size; i++) { if (x[i] != 0.0f) { return 0; } } \
+        return 1; \
+    }
+
+#define _RED_ALL(isa, attr, vec, w, load, set1, vadd, vfmadd, vmax, vmin, hadd, hmax, hmin, eq_mask, any_nz) \
+    _RED_SUM(_red_sum_##isa, attr, vec, w, load, set1, vadd, hadd) \
+    _RED_SUM_SQUARES(_red_sum_squares_##isa, attr, vec, w, load, set1, vadd, vfmadd, hadd) \
+    _RED_DOT(_red_dot_##isa, attr, vec, w, load, set1, vadd, vfmadd, hadd) \
+    _RED_EXTREMUM(_red_max_##isa, attr, vec, w, load, set1, vmax, hmax, >) \
+    _RED_EXTREMUM(_red_min_##isa, attr, vec, w, load, set1, vmin, hmin, <) \
+    _RED_ARGMAX(_red_argmax_##isa, attr, vec, w, load, set1, _red_max_##isa, eq_mask) \
+    _RED_IS_ZERO(_red_is_zero_##isa, attr, vec, w, load, any_nz) \
+    static const reduce_kernels _red_kernels_##isa = { \
+        .sum = _red_sum_##isa, \
+        .sum_squares = _red_sum_squares_##isa, \
+        .max = _red_max_##isa, \
+        .min = _red_min_##isa, \
+        .dot = _red_dot_##isa, \
+        .argmax = _red_argmax_##isa, \
+        .is_zero = _red_is_zero_##isa, \
+    };
+
+// Scalar "vectors" of width 1. The four accumulators still break up the dependency chain
+#define _RED_NO_ATTR
+#define _RED_S_LOAD(p) (*(p))
+#define _RED_S_SET1(x) (x)
+#define _RED_S_ADD(a, b) ((a) + (b))
+#define _RED_S_FMADD(a, b, c) ((a) * (b) + (c))
+#define _RED_S_MAX(a, b) ((b) > (a) ? (b) : (a))
+#define _RED_S_MIN(a, b) ((b) < (a) ? (b) : (a))
+#define _RED_S_IDENTITY(a) (a)
+#define _RED_S_EQ_MASK(a, b) ((a) == (b))
+#define _RED_S_ANY_NZ(a) ((a) != 0.0f)
+
+_RED_ALL(
+    scalar, _RED_NO_ATTR, f32, 1,
+    _RED_S_LOAD, _RED_S_SET1, _RED_S_ADD, _RED_S_FMADD, _RED_S_MAX, _RED_S_MIN,
+    _RED_S_IDENTITY, _RED_S_IDENTITY, _RED_S_IDENTITY,
+    _RED_S_EQ_MASK, _RED_S_ANY_NZ
+)
+
+#if SIMD_X86
+
+SIMD_TARGET_SSE static inline f32 _red_hadd_sse(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+SIMD_TARGET_SSE static inline f32 _red_hmax_sse(__m128 v) {
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+SIMD_TARGET_SSE static inline f32 _red_hmin_sse(__m128 v) {
+    v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+SIMD_TARGET_SSE static inline __m128 _red_fmadd_sse(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+SIMD_TARGET_SSE static inline int _red_eq_mask_sse(__m128 a, __m128 b) {
+    return _mm_movemask_ps(_mm_cmpeq_ps(a, b));
+}
+SIMD_TARGET_SSE static inline int _red_any_nz_sse(__m128 v) {
+    return _mm_movemask_ps(_mm_cmpneq_ps(v, _mm_setzero_ps()));
+}
+
+SIMD_TARGET_AVX2 static inline f32 _red_hadd_avx2(__m256 v) {
+    return _red_hadd_sse(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+SIMD_TARGET_AVX2 static inline f32 _red_hmax_avx2(__m256 v) {
+    return _red_hmax_sse(_mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+SIMD_TARGET_AVX2 static inline f32 _red_hmin_avx2(__m256 v) {
+    return _red_hmin_sse(_mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+SIMD_TARGET_AVX2 static inline int _red_eq_mask_avx2(__m256 a, __m256 b) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+}
+SIMD_TARGET_AVX2 static inline int _red_any_nz_avx2(__m256 v) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+}
+
+SIMD_TARGET_AVX512 static inline int _red_any_nz_avx512(__m512 v) {
+    return _mm512_cmp_ps_mask(v, _mm512_setzero_ps(), _CMP_NEQ_UQ);
+}
+
+_RED_ALL(
+    sse, SIMD_TARGET_SSE, __m128, 4,
+    _mm_loadu_ps, _mm_set1_ps, _mm_add_ps, _red_fmadd_sse, _mm_max_ps, _mm_min_ps,
+    _red_hadd_sse, _red_hmax_sse, _red_hmin_sse,
+    _red_eq_mask_sse, _red_any_nz_sse
+)
+
+_RED_ALL(
+    avx2, SIMD_TARGET_AVX2, __m256, 8,
+    _mm256_loadu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_fmadd_ps, _mm256_max_ps, _mm256_min_ps,
+    _red_hadd_avx2, _red_hmax_avx2, _red_hmin_avx2,
+    _red_eq_mask_avx2, _red_any_nz_avx2
+)
+
+_RED_ALL(
+    avx512, SIMD_TARGET_AVX512, __m512, 16,
+    _mm512_loadu_ps, _mm512_set1_ps, _mm512_add_ps, _mm512_fmadd_ps, _mm512_max_ps, _mm512_min_ps,
+    _mm512_reduce_add_ps, _mm512_reduce_max_ps, _mm512_reduce_min_ps,
+    _mm512_cmpeq_ps_mask, _red_any_nz_avx512
+)
+
+#endif // SIMD_X86
+
+const reduce_kernels* reduce_kernels_get_level(simd_level level) {
+    level = MIN(level, simd_get_supported_level());
+
+    switch (level) {
+#if SIMD_X86
+        case SIMD_LEVEL_AVX512: return &_red_kernels_avx512;
+        case SIMD_LEVEL_AVX2: return &_red_kernels_avx2;
+        case SIMD_LEVEL_SSE: return &_red_kernels_sse;
+#endif
+        default: return &_red_kernels_scalar;
+    }
+}
+
+const reduce_kernels* reduce_kernels_get(void) {
+    return reduce_kernels_get_level(simd_get_level());
+}
@@ -0,0 +1,50 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file reduce.h
+ * @brief Per instruction set reduction kernels
+ *
+ * Every kernel keeps four independent vector accumulators,
+ * so consecutive loads do not wait on each other's adds. <br>
+ * The CPU backends of `tensor_argmax`, `tensor_is_zero` and the
+ * tensor reduction functions (`tensor_sum`, `tensor_max`, ...) call these
+ * through `reduce_kernels_get`
+ */
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include "../../include/base_defs.h"
+#include "simd.h"
+
+/// Returns a reduction of `x[0 .. size)`
+typedef f32 (reduce_func)(const f32* x, u64 size);
+/// Returns the sum of `a[i] * b[i]`
+typedef f32 (reduce_dot_func)(const f32* a, const f32* b, u64 size);
+/// Returns the index of the first maximum element. `size` must be at least 1
+typedef u64 (reduce_argmax_func)(const f32* x, u64 size);
+/// Returns true if every element is zero (positive or negative). Stops at the first nonzero vector
+typedef b32 (reduce_is_zero_func)(const f32* x, u64 size);
+
+/// Table of reduction kernels for one `simd_level`
+typedef struct {
+    reduce_func* sum;
+    reduce_func* sum_squares;
+    /// `size` must be at least 1
+    reduce_func* max;
+    /// `size` must be at least 1
+    reduce_func* min;
+
+    reduce_dot_func* dot;
+    reduce_argmax_func* argmax;
+    reduce_is_zero_func* is_zero;
+} reduce_kernels;
+
+/// Returns the kernels for the active `simd_level` (see `simd_get_level`)
+const reduce_kernels* reduce_kernels_get(void);
+/// Returns the kernels for a specific `simd_level`, clamped to what the CPU supports
+const reduce_kernels* reduce_kernels_get_level(simd_level level);
+
+#endif // REDUCE_H
@@ -0,0 +1,140 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "simd.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "../../include/err.h"
+
+static const string8 _level_names[SIMD_LEVEL_COUNT] = {
+    [SIMD_LEVEL_SCALAR] = STR8("scalar"),
+    [SIMD_LEVEL_SSE] = STR8("sse"),
+    [SIMD_LEVEL_AVX2] = STR8("avx2"),
+    [SIMD_LEVEL_AVX512] = STR8("avx512"),
+};
+
+// Negative until the first call to `simd_get_level`
+static i32 _supported_level = -1;
+static i32 _active_level = -1;
+// Bitmask of `simd_feature`s, negative until the first call to `simd_has_feature`
+static i32 _features = -1;
+
+static simd_level _simd_detect(void) {
+#if SIMD_X86
+    __builtin_cpu_init();
+
+    // __builtin_cpu_supports also checks that the OS saves the wider registers (XGETBV)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+        return SIMD_LEVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SIMD_LEVEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SIMD_LEVEL_SSE;
+    }
+#endif
+
+    return SIMD_LEVEL_SCALAR;
+}
+
+simd_level simd_get_supported_level(void) {
+    if (_supported_level < 0) {
+        _supported_level = (i32)_simd_detect();
+    }
+
+    return (simd_level)_supported_level;
+}
+
+simd_level simd_get_level(void) {
+    if (_active_level >= 0) {
+        return (simd_level)_active_level;
+    }
+
+    simd_level level = simd_get_supported_level();
+
+    const char* env = getenv("MLFRAMEWORK_SIMD");
+    if (env != NULL) {
+        simd_level forced = simd_level_from_name(str8_from_cstr((u8*)env));
+
+        if (forced == SIMD_LEVEL_COUNT) {
+            ERR(ERR_INVALID_INPUT, "Invalid MLFRAMEWORK_SIMD, expected scalar, sse, avx2 or avx512");
+        } else {
+            if (forced > level) {
+                ERR(ERR_INVALID_INPUT, "MLFRAMEWORK_SIMD is not supported by this CPU, using the highest supported level");
+            }
+
+            level = MIN(forced, level);
+        }
+    }
+
+    // Racing threads all compute the same value, so this does not need a lock
+    _active_level = (i32)level;
+
+    return level;
+}
+
+void simd_set_level(simd_level level) {
+    if (level >= SIMD_LEVEL_COUNT) {
+        ERR(ERR_INVALID_ENUM, "Invalid simd level");
+        return;
+    }
+
+    _active_level = (i32)MIN(level, simd_get_supported_level());
+}
+
+static i32 _simd_detect_features(void) {
+    i32 features = 0;
+
+#if SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("f16c")) {
+        features |= 1 << SIMD_FEATURE_F16C;
+    }
+    if (__builtin_cpu_supports("avx512bf16")) {
+        features |= 1 << SIMD_FEATURE_AVX512_BF16;
+    }
+    if (__builtin_cpu_supports("avxvnni")) {
+        features |= 1 << SIMD_FEATURE_AVX_VNNI;
+    }
+    if (__builtin_cpu_supports("avx512vnni")) {
+        features |= 1 << SIMD_FEATURE_AVX512_VNNI;
+    }
+#endif
+
+    return features;
+}
+
+b32 simd_has_feature(simd_feature feature) {
+    if (feature >= SIMD_FEATURE_COUNT) {
+        return false;
+    }
+
+    if (_features < 0) {
+        _features = _simd_detect_features();
+    }
+
+    return (_features >> feature) & 1;
+}
+
+string8 simd_level_get_name(simd_level level) {
+    if (level >= SIMD_LEVEL_COUNT) {
+        return (string8){ 0 };
+    }
+
+    return _level_names[level];
+}
+
+simd_level simd_level_from_name(string8 name) {
+    for (u32 i = 0; i < SIMD_LEVEL_COUNT; i++) {
+        if (str8_equals(name, _level_names[i])) {
+            return (simd_level)i;
+        }
+    }
+
+    return SIMD_LEVEL_COUNT;
+}
@@ -0,0 +1,95 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file simd.h
+ * @brief Runtime detection and selection of the SIMD instruction set used by CPU kernels
+ *
+ * The level is detected with CPUID the first time it is needed.
+ * It can be forced with the environment variable `MLFRAMEWORK_SIMD`
+ * (`scalar`, `sse`, `avx2` or `avx512`), which is useful for A/B testing.
+ * A forced level is clamped to what the CPU supports
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "../../include/base_defs.h"
+#include "../../include/str.h"
+
+/// Instruction set levels, each one includes the previous ones
+typedef enum {
+    /// Plain C
+    SIMD_LEVEL_SCALAR = 0,
+    /// SSE (128-bit)
+    SIMD_LEVEL_SSE,
+    /// AVX2 + FMA (256-bit)
+    SIMD_LEVEL_AVX2,
+    /// AVX-512F (512-bit)
+    SIMD_LEVEL_AVX512,
+
+    /// Number of SIMD levels
+    SIMD_LEVEL_COUNT
+} simd_level;
+
+/// Optional instruction set extensions that are not part of any level
+typedef enum {
+    /// f32 <-> f16 conversions (VCVTPS2PH). Present on almost every AVX2 CPU
+    SIMD_FEATURE_F16C = 0,
+    /// f32 -> bf16 conversions (VCVTNEPS2BF16)
+    SIMD_FEATURE_AVX512_BF16,
+    /// 256-bit u8 x s8 dot products (VPDPBUSD)
+    SIMD_FEATURE_AVX_VNNI,
+    /// 512-bit u8 x s8 dot products (VPDPBUSD)
+    SIMD_FEATURE_AVX512_VNNI,
+
+    /// Number of features
+    SIMD_FEATURE_COUNT
+} simd_feature;
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   define SIMD_X86 1
+/// Compiles one function for SSE, regardless of the target flags
+#   define SIMD_TARGET_SSE __attribute__((target("sse4.1")))
+/// Compiles one function for AVX2 + FMA, regardless of the target flags
+#   define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+/// Compiles one function for AVX-512F, regardless of the target flags
+#   define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+/// `SIMD_TARGET_AVX2` + F16C
+#   define SIMD_TARGET_AVX2_F16C __attribute__((target("avx2,fma,f16c")))
+/// `SIMD_TARGET_AVX512` + AVX512-BF16
+#   define SIMD_TARGET_AVX512_BF16 __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl,avx512bf16")))
+/// `SIMD_TARGET_AVX2` + AVX-VNNI
+#   define SIMD_TARGET_AVX2_VNNI __attribute__((target("avx2,fma,avxvnni")))
+/// `SIMD_TARGET_AVX512` + AVX512-VNNI
+#   define SIMD_TARGET_AVX512_VNNI __attribute__((target("avx512f,avx512dq,avx512bw,avx512vnni")))
+#else
+#   define SIMD_X86 0
+#endif
+
+/// Returns the highest level supported by the CPU and OS
+simd_level simd_get_supported_level(void);
+/// Returns the level the kernels are currently using
+simd_level simd_get_level(void);
+/**
+ * @brief Forces the level used by the kernels
+ *
+ * `level` is clamped to `simd_get_supported_level()`
+ */
+void simd_set_level(simd_level level);
+
+/**
+ * @brief Returns true if the CPU supports `feature`
+ *
+ * Features are independent of the active level,
+ * kernels only use one if their level is also active
+ */
+b32 simd_has_feature(simd_feature feature);
+
+/// Gets the name of a level. Do not modify the returned string
+string8 simd_level_get_name(simd_level level);
+/// Gets the level from `name`, or `SIMD_LEVEL_COUNT` if `name` is invalid
+simd_level simd_level_from_name(string8 name);
+
+#endif // SIMD_H
@@ -0,0 +1,33 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+
+#include <string.h>
+
+static u64 _align_up(u64 x, u64 align) {
+    return (x + align - 1) & ~(align - 1);
+}
+
+void* mga_push_aligned(mg_arena* arena, u64 size, u64 align) {
+    u8* out = (u8*)mga_push(arena, size + align - 1);
+    if (out == NULL) {
+        return NULL;
+    }
+
+    return (void*)_align_up((u64)(uintptr_t)out, align);
+}
+
+void* mga_push_zero_aligned(mg_arena* arena, u64 size, u64 align) {
+    void* out = mga_push_aligned(arena, size, align);
+    if (out != NULL) {
+        memset(out, 0, size);
+    }
+
+    return out;
+}
+
+u64 tensor_data_size(u64 alloc, u64 elem_size) {
+    return _align_up(alloc * elem_size, TENSOR_ALIGN);
+}
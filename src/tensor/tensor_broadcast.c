@@ -0,0 +1,245 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "elementwise.h"
+#include "overlap.h"
+
+// Stack buffer for expanding a broadcast scalar on the left of sub and div
+#define _BROADCAST_BLOCK_SIZE 256
+
+typedef enum {
+    _BROADCAST_ADD,
+    _BROADCAST_SUB,
+    _BROADCAST_MUL,
+    _BROADCAST_DIV,
+} _broadcast_op;
+
+/*
+ * The output is split into segments that every operand either covers fully or broadcasts one value over.
+ * Those are whole planes if every operand is full or 1x1 in width and height (e.g. per channel biases),
+ * otherwise rows (e.g. a bias row added to every example of a batch).
+ * Each segment is then one call to a binary or scalar kernel
+ */
+typedef struct {
+    const f32* data;
+    // Covers the whole segment, otherwise one value is broadcast over it
+    b32 full;
+    u64 y_stride;
+    u64 z_stride;
+} _broadcast_operand;
+
+b32 tensor_broadcast_shape(tensor_shape* out, tensor_shape a, tensor_shape b) {
+    if (
+        (a.width != b.width && a.width != 1 && b.width != 1) ||
+        (a.height != b.height && a.height != 1 && b.height != 1) ||
+        (a.depth != b.depth && a.depth != 1 && b.depth != 1)
+    ) {
+        return false;
+    }
+
+    *out = (tensor_shape){ MAX(a.width, b.width), MAX(a.height, b.height), MAX(a.depth, b.depth) };
+
+    return true;
+}
+
+static f32 _broadcast_apply(_broadcast_op op, f32 a, f32 b) {
+    switch (op) {
+        case _BROADCAST_ADD: return a + b;
+        case _BROADCAST_SUB: return a - b;
+        case _BROADCAST_MUL: return a * b;
+        case _BROADCAST_DIV: return a / b;
+    }
+
+    return 0.0f;
+}
+
+// Binary and scalar kernels of one op
+typedef struct {
+    _broadcast_op op;
+    elementwise_binary_func* binary;
+    elementwise_scalar_func* scalar;
+    elementwise_fill_func* fill;
+} _broadcast_kernels;
+
+static _broadcast_kernels _broadcast_kernels_get(_broadcast_op op) {
+    const elementwise_kernels* ew = elementwise_kernels_get();
+    _broadcast_kernels out = { .op = op, .fill = ew->fill };
+
+    switch (op) {
+        case _BROADCAST_ADD: { out.binary = ew->add; out.scalar = ew->add_all; } break;
+        case _BROADCAST_SUB: { out.binary = ew->sub; out.scalar = ew->sub_all; } break;
+        case _BROADCAST_MUL: { out.binary = ew->mul; out.scalar = ew->scale; } break;
+        case _BROADCAST_DIV: { out.binary = ew->div; out.scalar = ew->div_all; } break;
+    }
+
+    return out;
+}
+
+static void _broadcast_segment(
+    const _broadcast_kernels* kernels, f32* out,
+    const f32* a, b32 a_full, const f32* b, b32 b_full, u64 size
+) {
+    _broadcast_op op = kernels->op;
+    elementwise_binary_func* binary = kernels->binary;
+    elementwise_scalar_func* scalar = kernels->scalar;
+
+    if (a_full && b_full) {
+        binary(out, a, b, size);
+    } else if (a_full) {
+        scalar(out, a, *b, size);
+    } else if (!b_full) {
+        kernels->fill(out, _broadcast_apply(op, *a, *b), size);
+    } else if (op == _BROADCAST_ADD || op == _BROADCAST_MUL) {
+        scalar(out, b, *a, size);
+    } else {
+        // x - b and x / b do not commute, so x is expanded one block at a time
+        f32 expanded[_BROADCAST_BLOCK_SIZE];
+        kernels->fill(expanded, *a, MIN(size, _BROADCAST_BLOCK_SIZE));
+
+        for (u64 i = 0; i < size; i += _BROADCAST_BLOCK_SIZE) {
+            binary(out + i, expanded, b + i, MIN(size - i, _BROADCAST_BLOCK_SIZE));
+        }
+    }
+}
+
+static _broadcast_operand _broadcast_operand_init(const f32* data, tensor_shape shape, tensor_shape out_shape, b32 planes) {
+    b32 full = planes ?
+        shape.width == out_shape.width && shape.height == out_shape.height :
+        shape.width == out_shape.width;
+
+    return (_broadcast_operand){
+        .data = data,
+        .full = full,
+        .y_stride = shape.height == 1 ? 0 : shape.width,
+        .z_stride = shape.depth == 1 ? 0 : (u64)shape.width * shape.height,
+    };
+}
+
+static b32 _broadcast_op_ip(tensor* out, const tensor* a, const tensor* b, _broadcast_op op) {
+    if (out->dtype != TENSOR_DTYPE_F32 || a->dtype != TENSOR_DTYPE_F32 || b->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot broadcast tensors: out, a and b must be f32");
+        return false;
+    }
+
+    tensor_shape shape = { 0 };
+    if (!tensor_broadcast_shape(&shape, a->shape, b->shape)) {
+        ERR(ERR_BAD_SHAPE, "Cannot broadcast tensors: dims must be equal or 1");
+        return false;
+    }
+
+    u64 out_size = (u64)shape.width * shape.height * shape.depth;
+    if (out->alloc < out_size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot broadcast tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    const f32* a_data = (const f32*)a->data;
+    const f32* b_data = (const f32*)b->data;
+    u64 a_size = (u64)a->shape.width * a->shape.height * a->shape.depth;
+    u64 b_size = (u64)b->shape.width * b->shape.height * b->shape.depth;
+
+    // A broadcast operand in `out` would be overwritten before its later uses
+    if (a_size != out_size && tensor_overlaps_range(out, a_data, a_data + a_size)) {
+        f32* copy = MGA_PUSH_ARRAY(scratch.arena, f32, a_size);
+        memcpy(copy, a_data, sizeof(f32) * a_size);
+        a_data = copy;
+    }
+    if (b_size != out_size && tensor_overlaps_range(out, b_data, b_data + b_size)) {
+        f32* copy = MGA_PUSH_ARRAY(scratch.arena, f32, b_size);
+        memcpy(copy, b_data, sizeof(f32) * b_size);
+        b_data = copy;
+    }
+
+    b32 a_plane = (a->shape.width == shape.width && a->shape.height == shape.height) ||
+        (a->shape.width == 1 && a->shape.height == 1);
+    b32 b_plane = (b->shape.width == shape.width && b->shape.height == shape.height) ||
+        (b->shape.width == 1 && b->shape.height == 1);
+    b32 planes = a_plane && b_plane;
+
+    u64 segment_size = planes ? (u64)shape.width * shape.height : shape.width;
+    u32 rows = planes ? 1 : shape.height;
+
+    _broadcast_operand oa = _broadcast_operand_init(a_data, a->shape, shape, planes);
+    _broadcast_operand ob = _broadcast_operand_init(b_data, b->shape, shape, planes);
+
+    _broadcast_kernels kernels = _broadcast_kernels_get(op);
+    f32* out_data = (f32*)out->data;
+
+    for (u32 z = 0; z < shape.depth; z++) {
+        for (u32 y = 0; y < rows; y++) {
+            _broadcast_segment(
+                &kernels, out_data + ((u64)z * rows + y) * segment_size,
+                oa.data + y * oa.y_stride + z * oa.z_stride, oa.full,
+                ob.data + y * ob.y_stride + z * ob.z_stride, ob.full,
+                segment_size
+            );
+        }
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = shape;
+
+    return true;
+}
+
+static tensor* _broadcast_op_create(mg_arena* arena, const tensor* a, const tensor* b, _broadcast_op op) {
+    if (a->dtype != TENSOR_DTYPE_F32 || b->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot broadcast tensors: a and b must be f32");
+        return NULL;
+    }
+
+    tensor_shape shape = { 0 };
+    if (!tensor_broadcast_shape(&shape, a->shape, b->shape)) {
+        ERR(ERR_BAD_SHAPE, "Cannot broadcast tensors: dims must be equal or 1");
+        return NULL;
+    }
+
+    tensor* out = tensor_create_uninit(arena, shape);
+    _broadcast_op_ip(out, a, b, op);
+
+    return out;
+}
+
+b32 tensor_add_broadcast_ip(tensor* out, const tensor* a, const tensor* b) {
+    return _broadcast_op_ip(out, a, b, _BROADCAST_ADD);
+}
+
+b32 tensor_sub_broadcast_ip(tensor* out, const tensor* a, const tensor* b) {
+    return _broadcast_op_ip(out, a, b, _BROADCAST_SUB);
+}
+
+b32 tensor_component_mul_broadcast_ip(tensor* out, const tensor* a, const tensor* b) {
+    return _broadcast_op_ip(out, a, b, _BROADCAST_MUL);
+}
+
+b32 tensor_component_div_broadcast_ip(tensor* out, const tensor* a, const tensor* b) {
+    return _broadcast_op_ip(out, a, b, _BROADCAST_DIV);
+}
+
+tensor* tensor_add_broadcast(mg_arena* arena, const tensor* a, const tensor* b) {
+    return _broadcast_op_create(arena, a, b, _BROADCAST_ADD);
+}
+
+tensor* tensor_sub_broadcast(mg_arena* arena, const tensor* a, const tensor* b) {
+    return _broadcast_op_create(arena, a, b, _BROADCAST_SUB);
+}
+
+tensor* tensor_component_mul_broadcast(mg_arena* arena, const tensor* a, const tensor* b) {
+    return _broadcast_op_create(arena, a, b, _BROADCAST_MUL);
+}
+
+tensor* tensor_component_div_broadcast(mg_arena* arena, const tensor* a, const tensor* b) {
+    return _broadcast_op_create(arena, a, b, _BROADCAST_DIV);
+}
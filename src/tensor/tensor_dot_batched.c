@@ -0,0 +1,63 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+
+#include "gemm.h"
+
+// Output shape if a and b are valid, or a zero shape
+static tensor_shape _dot_batched_shape(b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b) {
+    u32 a_width = transpose_a ? a->shape.height : a->shape.width;
+    u32 a_height = transpose_a ? a->shape.width : a->shape.height;
+    u32 b_width = transpose_b ? b->shape.height : b->shape.width;
+    u32 b_height = transpose_b ? b->shape.width : b->shape.height;
+
+    if (a_width != b_height) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: a.width does not equal b.height");
+        return (tensor_shape){ 0 };
+    }
+
+    if (b->shape.depth != 1 && b->shape.depth != a->shape.depth) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: b.depth must be 1 or a.depth");
+        return (tensor_shape){ 0 };
+    }
+
+    return (tensor_shape){ b_width, a_height, a->shape.depth };
+}
+
+b32 tensor_dot_batched_ip(tensor* out, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b) {
+    tensor_shape shape = _dot_batched_shape(transpose_a, transpose_b, a, b);
+
+    if (shape.depth == 0) {
+        return false;
+    }
+
+    if (out->alloc < (u64)shape.width * shape.height * shape.depth) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    gemm_tensor_dot_batched(out, transpose_a, transpose_b, a, b);
+
+    return true;
+}
+
+tensor* tensor_dot_batched(mg_arena* arena, b32 transpose_a, b32 transpose_b, const tensor* a, const tensor* b) {
+    tensor_shape shape = _dot_batched_shape(transpose_a, transpose_b, a, b);
+
+    if (shape.depth == 0) {
+        return NULL;
+    }
+
+    tensor* out = tensor_create_uninit(arena, shape);
+
+    gemm_tensor_dot_batched(out, transpose_a, transpose_b, a, b);
+
+    return out;
+}
@@ -0,0 +1,141 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "half.h"
+#include "overlap.h"
+
+// Conversions between two half types go through f32 one block at a time
+#define _DTYPE_BLOCK_SIZE 256
+
+u64 tensor_dtype_size(tensor_dtype dtype) {
+    switch (dtype) {
+        case TENSOR_DTYPE_F32: return sizeof(f32);
+        case TENSOR_DTYPE_F16: return sizeof(u16);
+        case TENSOR_DTYPE_BF16: return sizeof(u16);
+        default: return 0;
+    }
+}
+
+static tensor* _dtype_create(mg_arena* arena, tensor_shape shape, u64 alloc, tensor_dtype dtype, b32 zero) {
+    u64 elem_size = tensor_dtype_size(dtype);
+    u64 data_size = tensor_data_size(alloc, elem_size);
+
+    tensor* out = MGA_PUSH_ZERO_STRUCT(arena, tensor);
+    out->shape = shape;
+    out->alloc = alloc;
+    out->dtype = dtype;
+
+    if (zero) {
+        out->data = MGA_PUSH_ZERO_ARRAY_ALIGNED(arena, u8, data_size, TENSOR_ALIGN);
+    } else {
+        out->data = MGA_PUSH_ARRAY_ALIGNED(arena, u8, data_size, TENSOR_ALIGN);
+
+        u64 used_size = alloc * elem_size;
+
+#if TENSOR_POISON_UNINIT
+        // All ones is a NaN in every dtype
+        memset(out->data, 0xff, used_size);
+#endif
+
+        // The padding stays zero, since SIMD tails can read it
+        memset((u8*)out->data + used_size, 0, data_size - used_size);
+    }
+
+    return out;
+}
+
+tensor* tensor_create_dtype(mg_arena* arena, tensor_shape shape, tensor_dtype dtype) {
+    if (tensor_dtype_size(dtype) == 0) {
+        ERR(ERR_INVALID_ENUM, "Cannot create tensor: invalid dtype");
+        return NULL;
+    }
+
+    u64 alloc = (u64)shape.width * shape.height * shape.depth;
+
+    return _dtype_create(arena, shape, alloc, dtype, true);
+}
+
+tensor* tensor_create_uninit(mg_arena* arena, tensor_shape shape) {
+    u64 alloc = (u64)shape.width * shape.height * shape.depth;
+
+    return _dtype_create(arena, shape, alloc, TENSOR_DTYPE_F32, false);
+}
+
+tensor* tensor_create_alloc_uninit(mg_arena* arena, tensor_shape shape, u64 alloc) {
+    u64 min_alloc = (u64)shape.width * shape.height * shape.depth;
+    if (alloc < min_alloc) {
+        ERR(ERR_ALLOC_SIZE, "Cannot create tensor: alloc is too small for shape");
+        return NULL;
+    }
+
+    return _dtype_create(arena, shape, alloc, TENSOR_DTYPE_F32, false);
+}
+
+b32 tensor_convert_ip(tensor* out, const tensor* t) {
+    u64 elem_size = tensor_dtype_size(out->dtype);
+    if (elem_size == 0 || tensor_dtype_size(t->dtype) == 0) {
+        ERR(ERR_INVALID_ENUM, "Cannot convert tensor: invalid dtype");
+        return false;
+    }
+
+    u64 size = (u64)t->shape.width * t->shape.height * t->shape.depth;
+
+    if (out->alloc < size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot convert tensor: not enough space in out");
+#endif
+        return false;
+    }
+
+    if (out->dtype == t->dtype) {
+        if (out->data != t->data) {
+            memmove(out->data, t->data, elem_size * size);
+        }
+    } else if (tensor_overlaps(out, t)) {
+        ERR(ERR_INVALID_INPUT, "Cannot convert tensor: out overlaps t and has a different dtype");
+        return false;
+    } else if (t->dtype == TENSOR_DTYPE_F32) {
+        half_get_from_f32(out->dtype)((u16*)out->data, (const f32*)t->data, size);
+    } else if (out->dtype == TENSOR_DTYPE_F32) {
+        half_get_to_f32(t->dtype)((f32*)out->data, (const u16*)t->data, size);
+    } else {
+        half_to_f32_func* to_f32 = half_get_to_f32(t->dtype);
+        half_from_f32_func* from_f32 = half_get_from_f32(out->dtype);
+
+        f32 block[_DTYPE_BLOCK_SIZE];
+
+        for (u64 i = 0; i < size; i += _DTYPE_BLOCK_SIZE) {
+            u64 block_size = MIN(size - i, _DTYPE_BLOCK_SIZE);
+
+            to_f32(block, (const u16*)t->data + i, block_size);
+            from_f32((u16*)out->data + i, block, block_size);
+        }
+    }
+
+    out->shape = t->shape;
+
+    return true;
+}
+
+tensor* tensor_convert(mg_arena* arena, const tensor* t, tensor_dtype dtype) {
+    if (tensor_dtype_size(dtype) == 0) {
+        ERR(ERR_INVALID_ENUM, "Cannot convert tensor: invalid dtype");
+        return NULL;
+    }
+
+    u64 alloc = (u64)t->shape.width * t->shape.height * t->shape.depth;
+
+    // Fully overwritten by the conversion
+    tensor* out = _dtype_create(arena, t->shape, alloc, dtype, false);
+
+    tensor_convert_ip(out, t);
+
+    return out;
+}
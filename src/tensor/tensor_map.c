@@ -0,0 +1,213 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "elementwise.h"
+
+// 8 stack slots of 512 f32s is 16 KiB, which leaves half of L1 for the inputs
+#define _MAP_BLOCK_SIZE 512
+
+// Checks indices and stack depth once, so the block loop does not have to
+static b32 _map_expr_validate(const tensor_map_expr* expr, u32 num_outputs, u32 num_inputs) {
+    u32 depth = 0;
+
+    for (u32 i = 0; i < expr->num_instrs; i++) {
+        const tensor_map_instr* instr = &expr->instrs[i];
+
+        switch (instr->op) {
+            case TENSOR_MAP_OP_INPUT: {
+                if (instr->index >= num_inputs) {
+                    ERR(ERR_INVALID_INPUT, "Cannot map tensors: input index out of range");
+                    return false;
+                }
+                depth++;
+            } break;
+            case TENSOR_MAP_OP_CONST: {
+                depth++;
+            } break;
+            case TENSOR_MAP_OP_STORE: {
+                if (instr->index >= num_outputs) {
+                    ERR(ERR_INVALID_INPUT, "Cannot map tensors: output index out of range");
+                    return false;
+                }
+                if (depth < 1) {
+                    ERR(ERR_INVALID_INPUT, "Cannot map tensors: store with empty stack");
+                    return false;
+                }
+                depth--;
+            } break;
+
+            case TENSOR_MAP_OP_ADD:
+            case TENSOR_MAP_OP_SUB:
+            case TENSOR_MAP_OP_MUL:
+            case TENSOR_MAP_OP_DIV: {
+                if (depth < 2) {
+                    ERR(ERR_INVALID_INPUT, "Cannot map tensors: binary op needs two values");
+                    return false;
+                }
+                depth--;
+            } break;
+
+            case TENSOR_MAP_OP_ADD_SCALAR:
+            case TENSOR_MAP_OP_MUL_SCALAR:
+            case TENSOR_MAP_OP_SQRT: {
+                if (depth < 1) {
+                    ERR(ERR_INVALID_INPUT, "Cannot map tensors: unary op needs a value");
+                    return false;
+                }
+            } break;
+
+            case TENSOR_MAP_OP_NULL: break;
+
+            default: {
+                ERR(ERR_INVALID_ENUM, "Cannot map tensors: invalid op");
+                return false;
+            }
+        }
+
+        if (depth > TENSOR_MAP_MAX_STACK) {
+            ERR(ERR_INVALID_INPUT, "Cannot map tensors: expression exceeds TENSOR_MAP_MAX_STACK");
+            return false;
+        }
+    }
+
+    if (depth != 0) {
+        ERR(ERR_INVALID_INPUT, "Cannot map tensors: expression does not leave the stack empty");
+        return false;
+    }
+
+    return true;
+}
+
+b32 tensor_map_ip(tensor** outputs, u32 num_outputs, const tensor** inputs, u32 num_inputs, const tensor_map_expr* expr) {
+    if (num_inputs == 0) {
+        ERR(ERR_INVALID_INPUT, "Cannot map tensors: no inputs");
+        return false;
+    }
+
+    tensor_shape shape = inputs[0]->shape;
+    u64 size = (u64)shape.width * shape.height * shape.depth;
+
+    for (u32 i = 0; i < num_inputs; i++) {
+        if (inputs[i]->dtype != TENSOR_DTYPE_F32) {
+            ERR(ERR_INVALID_INPUT, "Cannot map tensors: inputs must be f32");
+            return false;
+        }
+    }
+
+    for (u32 i = 0; i < num_outputs; i++) {
+        if (outputs[i]->dtype != TENSOR_DTYPE_F32) {
+            ERR(ERR_INVALID_INPUT, "Cannot map tensors: outputs must be f32");
+            return false;
+        }
+    }
+
+    for (u32 i = 1; i < num_inputs; i++) {
+        if (!tensor_shape_eq(shape, inputs[i]->shape)) {
+            ERR(ERR_BAD_SHAPE, "Cannot map tensors: inputs are not the same shape");
+            return false;
+        }
+    }
+
+    for (u32 i = 0; i < num_outputs; i++) {
+        if (outputs[i]->alloc < size) {
+#if TENSOR_IP_ALLOC_ERRORS
+            ERR(ERR_ALLOC_SIZE, "Cannot map tensors: not enough space in output");
+#endif
+            return false;
+        }
+    }
+
+    if (!_map_expr_validate(expr, num_outputs, num_inputs)) {
+        return false;
+    }
+
+    const elementwise_kernels* k = elementwise_kernels_get();
+
+    // Stack entries either point straight into an input or into their slot buffer
+    f32 slots[TENSOR_MAP_MAX_STACK][_MAP_BLOCK_SIZE];
+    const f32* stack[TENSOR_MAP_MAX_STACK];
+
+    for (u64 start = 0; start < size; start += _MAP_BLOCK_SIZE) {
+        u64 n = MIN((u64)_MAP_BLOCK_SIZE, size - start);
+        u32 sp = 0;
+
+        for (u32 i = 0; i < expr->num_instrs; i++) {
+            const tensor_map_instr* instr = &expr->instrs[i];
+
+            switch (instr->op) {
+                case TENSOR_MAP_OP_NULL: break;
+
+                case TENSOR_MAP_OP_INPUT: {
+                    stack[sp++] = (const f32*)inputs[instr->index]->data + start;
+                } break;
+                case TENSOR_MAP_OP_CONST: {
+                    k->fill(slots[sp], instr->value, n);
+                    stack[sp] = slots[sp];
+                    sp++;
+                } break;
+                case TENSOR_MAP_OP_STORE: {
+                    f32* dst = (f32*)outputs[instr->index]->data + start;
+                    const f32* src = stack[--sp];
+
+                    // Values still on the stack that point at dst must keep their old data
+                    for (u32 j = 0; j < sp; j++) {
+                        if (stack[j] == dst) {
+                            memcpy(slots[j], dst, sizeof(f32) * n);
+                            stack[j] = slots[j];
+                        }
+                    }
+
+                    if (src != dst) {
+                        memcpy(dst, src, sizeof(f32) * n);
+                    }
+                } break;
+
+                case TENSOR_MAP_OP_ADD:
+                case TENSOR_MAP_OP_SUB:
+                case TENSOR_MAP_OP_MUL:
+                case TENSOR_MAP_OP_DIV: {
+                    const f32* b = stack[--sp];
+                    const f32* a = stack[sp - 1];
+                    f32* dst = slots[sp - 1];
+
+                    switch (instr->op) {
+                        case TENSOR_MAP_OP_ADD: { k->add(dst, a, b, n); } break;
+                        case TENSOR_MAP_OP_SUB: { k->sub(dst, a, b, n); } break;
+                        case TENSOR_MAP_OP_MUL: { k->mul(dst, a, b, n); } break;
+                        default: { k->div(dst, a, b, n); } break;
+                    }
+
+                    stack[sp - 1] = dst;
+                } break;
+
+                case TENSOR_MAP_OP_ADD_SCALAR: {
+                    k->add_all(slots[sp - 1], stack[sp - 1], instr->value, n);
+                    stack[sp - 1] = slots[sp - 1];
+                } break;
+                case TENSOR_MAP_OP_MUL_SCALAR: {
+                    k->scale(slots[sp - 1], stack[sp - 1], instr->value, n);
+                    stack[sp - 1] = slots[sp - 1];
+                } break;
+                case TENSOR_MAP_OP_SQRT: {
+                    k->sqrt(slots[sp - 1], stack[sp - 1], n);
+                    stack[sp - 1] = slots[sp - 1];
+                } break;
+
+                default: break;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < num_outputs; i++) {
+        outputs[i]->shape = shape;
+    }
+
+    return true;
+}
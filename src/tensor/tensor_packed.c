@@ -0,0 +1,140 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "gemm.h"
+#include "overlap.h"
+
+tensor_packed* tensor_pack(mg_arena* arena, const tensor* t, b32 transpose, b32 left) {
+    if (t->shape.depth != 1) {
+        ERR(ERR_BAD_SHAPE, "Cannot pack tensor: tensor must be 2D");
+        return NULL;
+    }
+
+    u32 rows = transpose ? t->shape.width : t->shape.height;
+    u32 cols = transpose ? t->shape.height : t->shape.width;
+
+    tensor_packed* out = MGA_PUSH_ZERO_STRUCT(arena, tensor_packed);
+    out->rows = rows;
+    out->cols = cols;
+    out->left = left;
+
+    if (left) {
+        out->data = MGA_PUSH_ARRAY_ALIGNED(arena, f32, gemm_packed_a_size(rows, cols), TENSOR_ALIGN);
+        gemm_pack_a_full_mixed(out->data, transpose, rows, cols, t->data, t->dtype, t->shape.width);
+    } else {
+        out->data = MGA_PUSH_ARRAY_ALIGNED(arena, f32, gemm_packed_b_size(cols, rows), TENSOR_ALIGN);
+        gemm_pack_b_full_mixed(out->data, transpose, cols, rows, t->data, t->dtype, t->shape.width);
+    }
+
+    return out;
+}
+
+b32 tensor_dot_packed_a_ip(tensor* out, const tensor_packed* a, b32 transpose_b, const tensor* b) {
+    u32 b_width = transpose_b ? b->shape.height : b->shape.width;
+    u32 b_height = transpose_b ? b->shape.width : b->shape.height;
+
+    if (!a->left) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: a was not packed as a left operand");
+        return false;
+    }
+
+    if (out->dtype != TENSOR_DTYPE_F32 || b->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: out and b must be f32");
+        return false;
+    }
+
+    if (b->shape.depth != 1 || a->cols != b_height) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: a.width does not equal b.height");
+        return false;
+    }
+
+    u32 m = a->rows;
+    u32 n = b_width;
+
+    if (out->alloc < (u64)m * n) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    b32 aliased = tensor_overlaps(out, b);
+    f32* c = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, (u64)m * n) : (f32*)out->data;
+
+    gemm_f32_packed_a(
+        m, n, a->cols, a->data,
+        transpose_b, (const f32*)b->data, b->shape.width,
+        c, n, false
+    );
+
+    if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * (u64)m * n);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, 1 };
+
+    return true;
+}
+
+b32 tensor_dot_packed_b_ip(tensor* out, b32 transpose_a, const tensor* a, const tensor_packed* b) {
+    u32 a_width = transpose_a ? a->shape.height : a->shape.width;
+    u32 a_height = transpose_a ? a->shape.width : a->shape.height;
+
+    if (b->left) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: b was not packed as a right operand");
+        return false;
+    }
+
+    if (out->dtype != TENSOR_DTYPE_F32 || a->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: out and a must be f32");
+        return false;
+    }
+
+    if (a->shape.depth != 1 || a_width != b->rows) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: a.width does not equal b.height");
+        return false;
+    }
+
+    u32 m = a_height;
+    u32 n = b->cols;
+
+    if (out->alloc < (u64)m * n) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // Dense layers multiply in place on `in_out`
+    b32 aliased = tensor_overlaps(out, a);
+    f32* c = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, (u64)m * n) : (f32*)out->data;
+
+    gemm_f32_packed_b(
+        transpose_a, m, n, b->rows,
+        (const f32*)a->data, a->shape.width, b->data,
+        c, n, false
+    );
+
+    if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * (u64)m * n);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, 1 };
+
+    return true;
+}
@@ -0,0 +1,287 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "half.h"
+#include "qgemm.h"
+
+tensor_quant_params tensor_quant_params_from_range(f32 min, f32 max) {
+    f32 lo = MIN(min, 0.0f);
+    f32 hi = MAX(max, 0.0f);
+
+    f32 scale = (hi - lo) / (f32)QGEMM_A_MAX;
+    if (!(scale > 0.0f) || !isfinite(scale)) {
+        return (tensor_quant_params){ .scale = 1.0f, .zero_point = 0 };
+    }
+
+    f32 zero_point = roundf(-lo / scale);
+    zero_point = MIN(MAX(zero_point, 0.0f), (f32)QGEMM_A_MAX);
+
+    return (tensor_quant_params){ .scale = scale, .zero_point = (i32)zero_point };
+}
+
+tensor_quant_params tensor_quant_calibrate(const tensor* t) {
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot calibrate quantization: tensor must be f32");
+        return tensor_quant_params_from_range(0.0f, 0.0f);
+    }
+
+    u64 size = (u64)t->shape.width * t->shape.height * t->shape.depth;
+    const f32* data = (const f32*)t->data;
+
+    f32 lo = 0.0f;
+    f32 hi = 0.0f;
+
+    for (u64 i = 0; i < size; i++) {
+        lo = MIN(lo, data[i]);
+        hi = MAX(hi, data[i]);
+    }
+
+    return tensor_quant_params_from_range(lo, hi);
+}
+
+static tensor_quantized* _quantized_create(mg_arena* arena, u32 rows, u32 cols) {
+    tensor_quantized* out = MGA_PUSH_ZERO_STRUCT(arena, tensor_quantized);
+    out->rows = rows;
+    out->cols = cols;
+    out->scales = MGA_PUSH_ARRAY(arena, f32, cols);
+    out->col_sums = MGA_PUSH_ARRAY(arena, i32, cols);
+    out->data = MGA_PUSH_ARRAY_ALIGNED(arena, i8, qgemm_packed_b_size(cols, rows), TENSOR_ALIGN);
+
+    return out;
+}
+
+tensor_quantized* tensor_quantize(mg_arena* arena, const tensor* t, b32 transpose) {
+    if (t->shape.depth != 1) {
+        ERR(ERR_BAD_SHAPE, "Cannot quantize tensor: tensor must be 2D");
+        return NULL;
+    }
+
+    half_to_f32_func* to_f32 = half_get_to_f32(t->dtype);
+    if (t->dtype != TENSOR_DTYPE_F32 && to_f32 == NULL) {
+        ERR(ERR_INVALID_INPUT, "Cannot quantize tensor: tensor must be f32, f16 or bf16");
+        return NULL;
+    }
+
+    u32 width = t->shape.width;
+    u32 rows = transpose ? t->shape.width : t->shape.height;
+    u32 cols = transpose ? t->shape.height : t->shape.width;
+
+    tensor_quantized* out = _quantized_create(arena, rows, cols);
+
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    u64 size = (u64)width * t->shape.height;
+    const f32* data = (const f32*)t->data;
+
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        f32* converted = MGA_PUSH_ARRAY(scratch.arena, f32, size);
+        to_f32(converted, (const u16*)t->data, size);
+        data = converted;
+    }
+
+    // Element (r, c) of the matrix being quantized
+    #define _QUANT_AT(r, c) (transpose ? data[(r) + (u64)(c) * width] : data[(c) + (u64)(r) * width])
+
+    for (u32 j = 0; j < cols; j++) {
+        f32 max_abs = 0.0f;
+        for (u32 p = 0; p < rows; p++) {
+            max_abs = MAX(max_abs, fabsf(_QUANT_AT(p, j)));
+        }
+
+        out->scales[j] = max_abs > 0.0f ? max_abs / (f32)QGEMM_B_MAX : 1.0f;
+    }
+
+    i8* values = MGA_PUSH_ARRAY(scratch.arena, i8, (u64)rows * cols);
+
+    for (u32 p = 0; p < rows; p++) {
+        for (u32 j = 0; j < cols; j++) {
+            f32 q = nearbyintf(_QUANT_AT(p, j) / out->scales[j]);
+            q = MIN(MAX(q, (f32)-QGEMM_B_MAX), (f32)QGEMM_B_MAX);
+
+            values[j + (u64)p * cols] = (i8)q;
+        }
+    }
+
+    #undef _QUANT_AT
+
+    qgemm_pack_b(out->data, out->col_sums, cols, rows, values, cols);
+
+    mga_scratch_release(scratch);
+
+    return out;
+}
+
+typedef struct {
+    // Quantized op(a), row major with a stride of k
+    const u8* a;
+    u32 k;
+} _quant_dot_ctx;
+
+static void _quant_dot_pack_a(void* ctx, u8* a, u32 lda, u32 i0, u32 rows) {
+    const _quant_dot_ctx* dot = (const _quant_dot_ctx*)ctx;
+
+    for (u32 r = 0; r < rows; r++) {
+        memcpy(a + (u64)r * lda, dot->a + (u64)(i0 + r) * dot->k, dot->k);
+    }
+}
+
+b32 tensor_dot_quantized_ip(
+    tensor* out, b32 transpose_a, const tensor* a,
+    tensor_quant_params a_params, const tensor_quantized* b
+) {
+    u32 a_width = transpose_a ? a->shape.height : a->shape.width;
+    u32 a_height = transpose_a ? a->shape.width : a->shape.height;
+
+    if (out->dtype != TENSOR_DTYPE_F32 || a->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: out and a must be f32");
+        return false;
+    }
+
+    if (a->shape.depth != 1 || a_width != b->rows) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: a.width does not equal b.height");
+        return false;
+    }
+
+    u32 m = a_height;
+    u32 n = b->cols;
+    u32 k = a_width;
+
+    if (out->alloc < (u64)m * n) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    // Quantizing all of a up front also makes it safe for out to alias a
+    u8* a_q = MGA_PUSH_ARRAY(scratch.arena, u8, (u64)m * k);
+
+    if (transpose_a) {
+        f32* column = MGA_PUSH_ARRAY(scratch.arena, f32, k);
+
+        for (u32 i = 0; i < m; i++) {
+            for (u32 p = 0; p < k; p++) {
+                column[p] = ((const f32*)a->data)[i + (u64)p * a->shape.width];
+            }
+
+            qgemm_quantize_a(a_q + (u64)i * k, column, k, a_params.scale, a_params.zero_point);
+        }
+    } else {
+        qgemm_quantize_a(a_q, (const f32*)a->data, (u64)m * k, a_params.scale, a_params.zero_point);
+    }
+
+    _quant_dot_ctx ctx = { .a = a_q, .k = k };
+
+    qgemm_desc desc = {
+        .m = m, .n = n, .k = k,
+        .pack_a = _quant_dot_pack_a,
+        .pack_a_ctx = &ctx,
+        .a_scale = a_params.scale,
+        .a_zero_point = a_params.zero_point,
+        .packed_b = b->data,
+        .b_col_sums = b->col_sums,
+        .b_scales = b->scales,
+        .c = (f32*)out->data,
+        .ldc = n,
+        .transpose_c = false
+    };
+
+    qgemm_u8s8(&desc);
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, 1 };
+
+    return true;
+}
+
+// int8 values are saved four to an f32, so a saved matrix is a quarter of the size of an f32 one
+#define _QUANT_VALUES_PER_F32 4
+// Fills the missing rows of the last group of four. Quantized values are never below -QGEMM_B_MAX
+#define _QUANT_PAD_VALUE (-QGEMM_B_MAX - 1)
+
+tensor* tensor_quantized_to_tensor(mg_arena* arena, const tensor_quantized* q) {
+    u32 packed_rows = (q->rows + _QUANT_VALUES_PER_F32 - 1) / _QUANT_VALUES_PER_F32;
+
+    tensor* out = tensor_create_uninit(arena, (tensor_shape){ q->cols, packed_rows + 1, 1 });
+    i8* bytes = (i8*)out->data;
+
+    for (u32 r = 0; r < packed_rows; r++) {
+        for (u32 j = 0; j < q->cols; j++) {
+            i8* element = bytes + ((u64)r * q->cols + j) * _QUANT_VALUES_PER_F32;
+
+            for (u32 b = 0; b < _QUANT_VALUES_PER_F32; b++) {
+                u32 p = r * _QUANT_VALUES_PER_F32 + b;
+                element[b] = p < q->rows ? qgemm_packed_b_get(q->data, q->rows, p, j) : _QUANT_PAD_VALUE;
+            }
+        }
+    }
+
+    memcpy((f32*)out->data + (u64)packed_rows * q->cols, q->scales, sizeof(f32) * q->cols);
+
+    return out;
+}
+
+tensor_quantized* tensor_quantized_from_tensor(mg_arena* arena, const tensor* t) {
+    if (t->dtype != TENSOR_DTYPE_F32 || t->shape.depth != 1 || t->shape.height == 0) {
+        ERR(ERR_BAD_SHAPE, "Cannot load quantized tensor: tensor must be a 2D f32 tensor");
+        return NULL;
+    }
+
+    u32 packed_rows = t->shape.height - 1;
+    u32 cols = t->shape.width;
+    const i8* bytes = (const i8*)t->data;
+
+    // The padding of the last group is the same in every column, so column 0 gives the row count
+    u32 num_pad = 0;
+    if (packed_rows > 0) {
+        const i8* last = bytes + (u64)(packed_rows - 1) * cols * _QUANT_VALUES_PER_F32;
+
+        while (num_pad < _QUANT_VALUES_PER_F32 - 1 &&
+            last[_QUANT_VALUES_PER_F32 - 1 - num_pad] == _QUANT_PAD_VALUE) {
+            num_pad++;
+        }
+    }
+
+    u32 rows = packed_rows * _QUANT_VALUES_PER_F32 - num_pad;
+    u64 num_bytes = (u64)packed_rows * cols * _QUANT_VALUES_PER_F32;
+
+    for (u64 i = 0; i < num_bytes; i++) {
+        u32 p = (u32)(i / ((u64)cols * _QUANT_VALUES_PER_F32)) * _QUANT_VALUES_PER_F32 +
+            (u32)(i % _QUANT_VALUES_PER_F32);
+
+        if ((bytes[i] == _QUANT_PAD_VALUE) != (p >= rows)) {
+            ERR(ERR_INVALID_INPUT, "Cannot load quantized tensor: values must be in [-127, 127]");
+            return NULL;
+        }
+    }
+
+    tensor_quantized* out = _quantized_create(arena, rows, cols);
+
+    mga_temp scratch = mga_scratch_get(&arena, 1);
+
+    i8* values = MGA_PUSH_ARRAY(scratch.arena, i8, (u64)rows * cols);
+    for (u32 p = 0; p < rows; p++) {
+        for (u32 j = 0; j < cols; j++) {
+            u64 element = (u64)(p / _QUANT_VALUES_PER_F32) * cols + j;
+            values[j + (u64)p * cols] = bytes[element * _QUANT_VALUES_PER_F32 + p % _QUANT_VALUES_PER_F32];
+        }
+    }
+
+    qgemm_pack_b(out->data, out->col_sums, cols, rows, values, cols);
+    memcpy(out->scales, (const f32*)t->data + (u64)packed_rows * cols, sizeof(f32) * cols);
+
+    mga_scratch_release(scratch);
+
+    return out;
+}
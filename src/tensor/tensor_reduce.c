@@ -0,0 +1,82 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <math.h>
+
+#include "reduce.h"
+
+static u64 _reduce_size(const tensor* t) {
+    return (u64)t->shape.width * t->shape.height * t->shape.depth;
+}
+
+static b32 _reduce_is_f32(const tensor* t) {
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot reduce tensor: tensor must be f32");
+        return false;
+    }
+
+    return true;
+}
+
+f32 tensor_sum(const tensor* t) {
+    if (!_reduce_is_f32(t)) {
+        return 0.0f;
+    }
+
+    return reduce_kernels_get()->sum((const f32*)t->data, _reduce_size(t));
+}
+
+f32 tensor_mean(const tensor* t) {
+    u64 size = _reduce_size(t);
+
+    if (size == 0 || !_reduce_is_f32(t)) {
+        return 0.0f;
+    }
+
+    return reduce_kernels_get()->sum((const f32*)t->data, size) / (f32)size;
+}
+
+f32 tensor_max(const tensor* t) {
+    u64 size = _reduce_size(t);
+
+    if (size == 0 || !_reduce_is_f32(t)) {
+        return 0.0f;
+    }
+
+    return reduce_kernels_get()->max((const f32*)t->data, size);
+}
+
+f32 tensor_min(const tensor* t) {
+    u64 size = _reduce_size(t);
+
+    if (size == 0 || !_reduce_is_f32(t)) {
+        return 0.0f;
+    }
+
+    return reduce_kernels_get()->min((const f32*)t->data, size);
+}
+
+f32 tensor_l2_norm(const tensor* t) {
+    if (!_reduce_is_f32(t)) {
+        return 0.0f;
+    }
+
+    return sqrtf(reduce_kernels_get()->sum_squares((const f32*)t->data, _reduce_size(t)));
+}
+
+f32 tensor_inner_product(const tensor* a, const tensor* b) {
+    if (!tensor_shape_eq(a->shape, b->shape)) {
+        ERR(ERR_BAD_SHAPE, "Cannot compute inner product: shapes do not align");
+        return 0.0f;
+    }
+
+    if (!_reduce_is_f32(a) || !_reduce_is_f32(b)) {
+        return 0.0f;
+    }
+
+    return reduce_kernels_get()->dot((const f32*)a->data, (const f32*)b->data, _reduce_size(a));
+}
@@ -0,0 +1,156 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+
+b32 tensor_sparse_from_dense(tensor_sparse* out, const tensor* t, u32 max_nnz) {
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot create sparse vector: tensor must be f32");
+        return false;
+    }
+
+    u64 size = (u64)t->shape.width * t->shape.height * t->shape.depth;
+    const f32* data = (const f32*)t->data;
+
+    u32 nnz = 0;
+    for (u64 i = 0; i < size; i++) {
+        if (data[i] == 0.0f) {
+            continue;
+        }
+
+        if (nnz == max_nnz) {
+            return false;
+        }
+
+        out->indices[nnz] = (u32)i;
+        out->values[nnz] = data[i];
+        nnz++;
+    }
+
+    out->size = (u32)size;
+    out->nnz = nnz;
+
+    return true;
+}
+
+static b32 _sparse_indices_valid(const tensor_sparse* s) {
+    for (u32 i = 0; i < s->nnz; i++) {
+        if (s->indices[i] >= s->size) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+b32 tensor_outer_sparse_add_ip(tensor* out, const tensor* x, const tensor_sparse* d) {
+    u64 x_size = x == NULL ? 1 : (u64)x->shape.width * x->shape.height * x->shape.depth;
+
+    if (out->dtype != TENSOR_DTYPE_F32 || (x != NULL && x->dtype != TENSOR_DTYPE_F32)) {
+        ERR(ERR_INVALID_INPUT, "Cannot add sparse outer product: out and x must be f32");
+        return false;
+    }
+
+    if (out->shape.width != d->size || (u64)out->shape.height * out->shape.depth != x_size) {
+        ERR(ERR_BAD_SHAPE, "Cannot add sparse outer product: out must be (d.size, size of x)");
+        return false;
+    }
+
+    if (!_sparse_indices_valid(d)) {
+        ERR(ERR_INVALID_INPUT, "Cannot add sparse outer product: index out of range");
+        return false;
+    }
+
+    f32* out_data = (f32*)out->data;
+    u32 width = out->shape.width;
+
+    if (x == NULL) {
+        for (u32 i = 0; i < d->nnz; i++) {
+            out_data[d->indices[i]] += d->values[i];
+        }
+
+        return true;
+    }
+
+    const f32* x_data = (const f32*)x->data;
+
+    for (u64 p = 0; p < x_size; p++) {
+        if (x_data[p] == 0.0f) {
+            continue;
+        }
+
+        f32* row = out_data + p * width;
+
+        for (u32 i = 0; i < d->nnz; i++) {
+            row[d->indices[i]] += x_data[p] * d->values[i];
+        }
+    }
+
+    return true;
+}
+
+b32 tensor_dot_sparse_ip(tensor* out, const tensor_sparse* a, b32 transpose_b, const tensor* b) {
+    u32 b_width = transpose_b ? b->shape.height : b->shape.width;
+    u32 b_height = transpose_b ? b->shape.width : b->shape.height;
+
+    if (out->dtype != TENSOR_DTYPE_F32 || b->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: out and b must be f32");
+        return false;
+    }
+
+    if (b->shape.depth != 1 || a->size != b_height) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot tensors: a.size does not equal b.height");
+        return false;
+    }
+
+    if (!_sparse_indices_valid(a)) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot tensors: sparse index out of range");
+        return false;
+    }
+
+    if (out->alloc < b_width) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot tensors: not enough space in out");
+#endif
+        return false;
+    }
+
+    f32* out_data = (f32*)out->data;
+    const f32* b_data = (const f32*)b->data;
+    u32 ldb = b->shape.width;
+
+    if (transpose_b) {
+        // Row j of op(b) is column j of b, so each output is a short gather from one row of b
+        for (u32 p = 0; p < b_width; p++) {
+            const f32* row = b_data + (u64)p * ldb;
+
+            f32 sum = 0.0f;
+            for (u32 i = 0; i < a->nnz; i++) {
+                sum += a->values[i] * row[a->indices[i]];
+            }
+
+            out_data[p] = sum;
+        }
+    } else {
+        for (u32 p = 0; p < b_width; p++) {
+            out_data[p] = 0.0f;
+        }
+
+        for (u32 i = 0; i < a->nnz; i++) {
+            const f32* row = b_data + (u64)a->indices[i] * ldb;
+            f32 value = a->values[i];
+
+            for (u32 p = 0; p < b_width; p++) {
+                out_data[p] += value * row[p];
+            }
+        }
+    }
+
+    out->shape = (tensor_shape){ b_width, 1, 1 };
+
+    return true;
+}
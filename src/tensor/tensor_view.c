@@ -0,0 +1,255 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "../../include/tensorNew.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "elementwise.h"
+#include "gemm.h"
+#include "overlap.h"
+
+// Offset of one past the last element of `view`
+static u64 _view_extent(const tensor_view* view) {
+    return (u64)(view->shape.depth - 1) * view->slice_stride +
+        (u64)(view->shape.height - 1) * view->row_stride + view->shape.width;
+}
+
+tensor_view tensor_view_from(const tensor* t) {
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot create view: tensor must be f32");
+        return (tensor_view){ 0 };
+    }
+
+    return (tensor_view){
+        .shape = t->shape,
+        .row_stride = t->shape.width,
+        .slice_stride = (u64)t->shape.width * t->shape.height,
+        .data = t->data
+    };
+}
+
+b32 tensor_view_slice(tensor_view* out, const tensor_view* view, tensor_index start, tensor_shape shape) {
+    if (shape.width == 0 || shape.height == 0 || shape.depth == 0) {
+        ERR(ERR_BAD_SHAPE, "Cannot slice view: shape must be at least 1 in every dim");
+        return false;
+    }
+
+    if (
+        (u64)start.x + shape.width > view->shape.width ||
+        (u64)start.y + shape.height > view->shape.height ||
+        (u64)start.z + shape.depth > view->shape.depth
+    ) {
+        ERR(ERR_BAD_SHAPE, "Cannot slice view: slice goes past the end of the view");
+        return false;
+    }
+
+    u64 offset = start.x + start.y * view->row_stride + start.z * view->slice_stride;
+
+    *out = (tensor_view){
+        .shape = shape,
+        .row_stride = view->row_stride,
+        .slice_stride = view->slice_stride,
+        .data = (f32*)view->data + offset
+    };
+
+    return true;
+}
+
+b32 tensor_view_is_contiguous(const tensor_view* view) {
+    b32 rows = view->shape.height == 1 || view->row_stride == view->shape.width;
+    b32 slices = view->shape.depth == 1 ||
+        view->slice_stride == (u64)view->shape.width * view->shape.height;
+
+    return rows && slices;
+}
+
+b32 tensor_view_as_tensor(tensor* out, const tensor_view* view) {
+    if (!tensor_view_is_contiguous(view)) {
+        return false;
+    }
+
+    *out = (tensor){
+        .shape = view->shape,
+        .alloc = (u64)view->shape.width * view->shape.height * view->shape.depth,
+        .data = view->data
+    };
+
+    return true;
+}
+
+b32 tensor_view_copy_ip(tensor* out, const tensor_view* view) {
+    tensor_shape shape = view->shape;
+    u64 size = (u64)shape.width * shape.height * shape.depth;
+
+    if (out->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot copy view: out must be f32");
+        return false;
+    }
+
+    if (out->alloc < size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot copy view: not enough space in out");
+#endif
+        return false;
+    }
+
+    f32* out_data = (f32*)out->data;
+    const f32* in_data = (const f32*)view->data;
+
+    if (tensor_view_is_contiguous(view)) {
+        memcpy(out_data, in_data, sizeof(f32) * size);
+    } else {
+        for (u32 z = 0; z < shape.depth; z++) {
+            for (u32 y = 0; y < shape.height; y++) {
+                memcpy(
+                    out_data + ((u64)y + (u64)z * shape.height) * shape.width,
+                    in_data + y * view->row_stride + z * view->slice_stride,
+                    sizeof(f32) * shape.width
+                );
+            }
+        }
+    }
+
+    out->shape = shape;
+
+    return true;
+}
+
+// Runs `func` on every row, or once over everything if all three views are contiguous
+static b32 _view_binary(
+    tensor_view* out, const tensor_view* a, const tensor_view* b,
+    elementwise_binary_func* func
+) {
+    if (!tensor_shape_eq(out->shape, a->shape) || !tensor_shape_eq(out->shape, b->shape)) {
+        ERR(ERR_BAD_SHAPE, "Cannot apply elementwise op to views: shapes do not align");
+        return false;
+    }
+
+    tensor_shape shape = out->shape;
+
+    if (tensor_view_is_contiguous(out) && tensor_view_is_contiguous(a) && tensor_view_is_contiguous(b)) {
+        func((f32*)out->data, (const f32*)a->data, (const f32*)b->data, (u64)shape.width * shape.height * shape.depth);
+        return true;
+    }
+
+    for (u32 z = 0; z < shape.depth; z++) {
+        for (u32 y = 0; y < shape.height; y++) {
+            func(
+                (f32*)out->data + y * out->row_stride + z * out->slice_stride,
+                (const f32*)a->data + y * a->row_stride + z * a->slice_stride,
+                (const f32*)b->data + y * b->row_stride + z * b->slice_stride,
+                shape.width
+            );
+        }
+    }
+
+    return true;
+}
+
+b32 tensor_view_add_ip(tensor_view* out, const tensor_view* a, const tensor_view* b) {
+    return _view_binary(out, a, b, elementwise_kernels_get()->add);
+}
+
+b32 tensor_view_sub_ip(tensor_view* out, const tensor_view* a, const tensor_view* b) {
+    return _view_binary(out, a, b, elementwise_kernels_get()->sub);
+}
+
+b32 tensor_view_component_mul_ip(tensor_view* out, const tensor_view* a, const tensor_view* b) {
+    return _view_binary(out, a, b, elementwise_kernels_get()->mul);
+}
+
+b32 tensor_view_component_div_ip(tensor_view* out, const tensor_view* a, const tensor_view* b) {
+    return _view_binary(out, a, b, elementwise_kernels_get()->div);
+}
+
+b32 tensor_view_scale_ip(tensor_view* out, const tensor_view* view, f32 s) {
+    if (!tensor_shape_eq(out->shape, view->shape)) {
+        ERR(ERR_BAD_SHAPE, "Cannot scale view: shapes do not align");
+        return false;
+    }
+
+    tensor_shape shape = out->shape;
+    elementwise_scalar_func* scale = elementwise_kernels_get()->scale;
+
+    if (tensor_view_is_contiguous(out) && tensor_view_is_contiguous(view)) {
+        scale((f32*)out->data, (const f32*)view->data, s, (u64)shape.width * shape.height * shape.depth);
+        return true;
+    }
+
+    for (u32 z = 0; z < shape.depth; z++) {
+        for (u32 y = 0; y < shape.height; y++) {
+            scale(
+                (f32*)out->data + y * out->row_stride + z * out->slice_stride,
+                (const f32*)view->data + y * view->row_stride + z * view->slice_stride,
+                s, shape.width
+            );
+        }
+    }
+
+    return true;
+}
+
+b32 tensor_view_dot_ip(tensor* out, b32 transpose_a, b32 transpose_b, const tensor_view* a, const tensor_view* b) {
+    if (a->shape.depth != 1 || b->shape.depth != 1) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot views: views must be 2D");
+        return false;
+    }
+
+    if (a->row_stride > UINT32_MAX || b->row_stride > UINT32_MAX) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot views: row stride is too large");
+        return false;
+    }
+
+    u32 m = transpose_a ? a->shape.width : a->shape.height;
+    u32 k = transpose_a ? a->shape.height : a->shape.width;
+    u32 b_height = transpose_b ? b->shape.width : b->shape.height;
+    u32 n = transpose_b ? b->shape.height : b->shape.width;
+
+    if (k != b_height) {
+        ERR(ERR_BAD_SHAPE, "Cannot dot views: a.width does not equal b.height");
+        return false;
+    }
+
+    if (out->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot dot views: out must be f32");
+        return false;
+    }
+
+    if (out->alloc < (u64)m * n) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot dot views: not enough space in out");
+#endif
+        return false;
+    }
+
+    const f32* a_start = (const f32*)a->data;
+    const f32* b_start = (const f32*)b->data;
+    b32 aliased = tensor_overlaps_range(out, a_start, a_start + _view_extent(a)) ||
+        tensor_overlaps_range(out, b_start, b_start + _view_extent(b));
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    f32* c = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, (u64)m * n) : (f32*)out->data;
+
+    gemm_f32(
+        transpose_a, transpose_b, m, n, k,
+        (const f32*)a->data, (u32)a->row_stride,
+        (const f32*)b->data, (u32)b->row_stride,
+        c, n, false
+    );
+
+    if (aliased) {
+        memcpy(out->data, c, sizeof(f32) * (u64)m * n);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ n, m, 1 };
+
+    return true;
+}
@@ -0,0 +1,268 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "transpose.h"
+#include "../../include/err.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../mg/mg_arena.h"
+#include "simd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+// 64 x 64 f32s in and out is 32 KiB, which fits in L1 along with the TLB entries of 64 rows
+#define _TRANSPOSE_LEAF 64
+#define _TRANSPOSE_MAX_TILE 8
+
+// Transposes one tile x tile register tile
+typedef void (_transpose_tile_func)(f32* out, u32 ld_out, const f32* in, u32 ld_in);
+
+typedef struct {
+    u32 tile;
+    _transpose_tile_func* func;
+} _transpose_kernel;
+
+static void _transpose_tile_scalar(f32* out, u32 ld_out, const f32* in, u32 ld_in) {
+    for (u32 i = 0; i < 4; i++) {
+        for (u32 j = 0; j < 4; j++) {
+            out[(u64)j * ld_out + i] = in[(u64)i * ld_in + j];
+        }
+    }
+}
+
+#if SIMD_X86
+
+SIMD_TARGET_SSE static void _transpose_tile_sse(f32* out, u32 ld_out, const f32* in, u32 ld_in) {
+    __m128 r0 = _mm_loadu_ps(in);
+    __m128 r1 = _mm_loadu_ps(in + ld_in);
+    __m128 r2 = _mm_loadu_ps(in + 2 * (u64)ld_in);
+    __m128 r3 = _mm_loadu_ps(in + 3 * (u64)ld_in);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(out, r0);
+    _mm_storeu_ps(out + ld_out, r1);
+    _mm_storeu_ps(out + 2 * (u64)ld_out, r2);
+    _mm_storeu_ps(out + 3 * (u64)ld_out, r3);
+}
+
+SIMD_TARGET_AVX2 static void _transpose_tile_avx2(f32* out, u32 ld_out, const f32* in, u32 ld_in) {
+    __m256 r0 = _mm256_loadu_ps(in);
+    __m256 r1 = _mm256_loadu_ps(in + ld_in);
+    __m256 r2 = _mm256_loadu_ps(in + 2 * (u64)ld_in);
+    __m256 r3 = _mm256_loadu_ps(in + 3 * (u64)ld_in);
+    __m256 r4 = _mm256_loadu_ps(in + 4 * (u64)ld_in);
+    __m256 r5 = _mm256_loadu_ps(in + 5 * (u64)ld_in);
+    __m256 r6 = _mm256_loadu_ps(in + 6 * (u64)ld_in);
+    __m256 r7 = _mm256_loadu_ps(in + 7 * (u64)ld_in);
+
+    // Interleave pairs of rows
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    // 4x4 transposes within each 128-bit lane
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    // Swap the off diagonal 4x4 blocks across lanes
+    _mm256_storeu_ps(out, _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(out + ld_out, _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(out + 2 * (u64)ld_out, _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(out + 3 * (u64)ld_out, _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(out + 4 * (u64)ld_out, _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(out + 5 * (u64)ld_out, _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(out + 6 * (u64)ld_out, _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(out + 7 * (u64)ld_out, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+#endif // SIMD_X86
+
+static _transpose_kernel _transpose_get_kernel(void) {
+#if SIMD_X86
+    simd_level level = simd_get_level();
+
+    if (level >= SIMD_LEVEL_AVX2) {
+        return (_transpose_kernel){ 8, _transpose_tile_avx2 };
+    }
+    if (level >= SIMD_LEVEL_SSE) {
+        return (_transpose_kernel){ 4, _transpose_tile_sse };
+    }
+#endif
+
+    return (_transpose_kernel){ 4, _transpose_tile_scalar };
+}
+
+// Block that fits in L1: full register tiles, then scalar edges
+static void _transpose_leaf(
+    const _transpose_kernel* kernel,
+    f32* out, u32 ld_out, const f32* in, u32 ld_in, u32 rows, u32 cols
+) {
+    u32 tile = kernel->tile;
+    u32 full_rows = rows - rows % tile;
+    u32 full_cols = cols - cols % tile;
+
+    // Column tiles outside, so each output row is written contiguously
+    for (u32 j = 0; j < full_cols; j += tile) {
+        for (u32 i = 0; i < full_rows; i += tile) {
+            kernel->func(out + (u64)j * ld_out + i, ld_out, in + (u64)i * ld_in + j, ld_in);
+        }
+    }
+
+    for (u32 i = 0; i < full_rows; i++) {
+        for (u32 j = full_cols; j < cols; j++) {
+            out[(u64)j * ld_out + i] = in[(u64)i * ld_in + j];
+        }
+    }
+
+    for (u32 i = full_rows; i < rows; i++) {
+        for (u32 j = 0; j < cols; j++) {
+            out[(u64)j * ld_out + i] = in[(u64)i * ld_in + j];
+        }
+    }
+}
+
+// Cache oblivious: halves the longer side (on a tile boundary) until the block is a leaf
+static void _transpose_rec(
+    const _transpose_kernel* kernel,
+    f32* out, u32 ld_out, const f32* in, u32 ld_in, u32 rows, u32 cols
+) {
+    if (rows <= _TRANSPOSE_LEAF && cols <= _TRANSPOSE_LEAF) {
+        _transpose_leaf(kernel, out, ld_out, in, ld_in, rows, cols);
+        return;
+    }
+
+    if (rows >= cols) {
+        u32 half = rows / 2 / kernel->tile * kernel->tile;
+
+        _transpose_rec(kernel, out, ld_out, in, ld_in, half, cols);
+        _transpose_rec(kernel, out + half, ld_out, in + (u64)half * ld_in, ld_in, rows - half, cols);
+    } else {
+        u32 half = cols / 2 / kernel->tile * kernel->tile;
+
+        _transpose_rec(kernel, out, ld_out, in, ld_in, rows, half);
+        _transpose_rec(kernel, out + (u64)half * ld_out, ld_out, in + half, ld_in, rows, cols - half);
+    }
+}
+
+void transpose_f32(f32* out, u32 ld_out, const f32* in, u32 ld_in, u32 rows, u32 cols) {
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+
+    _transpose_kernel kernel = _transpose_get_kernel();
+
+    _transpose_rec(&kernel, out, ld_out, in, ld_in, rows, cols);
+}
+
+void transpose_f32_square_ip(f32* data, u32 n, u32 ld) {
+    _transpose_kernel kernel = _transpose_get_kernel();
+
+    u32 tile = kernel.tile;
+    u32 full = n - n % tile;
+
+    f32 tmp[_TRANSPOSE_MAX_TILE * _TRANSPOSE_MAX_TILE];
+
+    // Tile pairs (i, j) and (j, i) are swapped through `tmp`, leaf sized block pair by block pair
+    for (u32 bi = 0; bi < full; bi += _TRANSPOSE_LEAF) {
+        u32 bi_end = MIN(bi + _TRANSPOSE_LEAF, full);
+
+        for (u32 bj = bi; bj < full; bj += _TRANSPOSE_LEAF) {
+            u32 bj_end = MIN(bj + _TRANSPOSE_LEAF, full);
+
+            for (u32 i = bi; i < bi_end; i += tile) {
+                for (u32 j = (bi == bj ? i : bj); j < bj_end; j += tile) {
+                    f32* upper = data + (u64)i * ld + j;
+                    f32* lower = data + (u64)j * ld + i;
+
+                    if (i == j) {
+                        kernel.func(tmp, tile, upper, ld);
+
+                        for (u32 r = 0; r < tile; r++) {
+                            memcpy(upper + (u64)r * ld, tmp + r * tile, sizeof(f32) * tile);
+                        }
+
+                        continue;
+                    }
+
+                    kernel.func(tmp, tile, upper, ld);
+                    kernel.func(upper, ld, lower, ld);
+
+                    for (u32 r = 0; r < tile; r++) {
+                        memcpy(lower + (u64)r * ld, tmp + r * tile, sizeof(f32) * tile);
+                    }
+                }
+            }
+        }
+    }
+
+    // Last n % tile rows and columns
+    for (u32 i = 0; i < n; i++) {
+        for (u32 j = MAX(full, i + 1); j < n; j++) {
+            f32 upper = data[(u64)i * ld + j];
+
+            data[(u64)i * ld + j] = data[(u64)j * ld + i];
+            data[(u64)j * ld + i] = upper;
+        }
+    }
+}
+
+void transpose_tensor_ip(tensor* t) {
+    if (t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot transpose tensor: tensor must be f32");
+        return;
+    }
+
+    u32 width = t->shape.width;
+    u32 height = t->shape.height;
+
+    // Row and column vectors have the same data layout
+    if (width == height) {
+        transpose_f32_square_ip((f32*)t->data, width, width);
+    } else if (width != 1 && height != 1) {
+        mga_temp scratch = mga_scratch_get(NULL, 0);
+
+        f32* tmp = MGA_PUSH_ARRAY(scratch.arena, f32, (u64)width * height);
+
+        transpose_f32(tmp, height, (const f32*)t->data, width, height, width);
+        memcpy(t->data, tmp, sizeof(f32) * (u64)width * height);
+
+        mga_scratch_release(scratch);
+    }
+
+    t->shape = (tensor_shape){ height, width, 1 };
+}
+
+void transpose_tensor(tensor* out, const tensor* t) {
+    if (out->dtype != TENSOR_DTYPE_F32 || t->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot transpose tensor: out and t must be f32");
+        return;
+    }
+
+    u32 width = t->shape.width;
+    u32 height = t->shape.height;
+
+    if (width == 1 || height == 1) {
+        memcpy(out->data, t->data, sizeof(f32) * (u64)width * height);
+    } else {
+        transpose_f32((f32*)out->data, height, (const f32*)t->data, width, height, width);
+    }
+
+    out->shape = (tensor_shape){ height, width, 1 };
+}
@@ -0,0 +1,57 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file transpose.h
+ * @brief Blocked matrix transpose (CPU backend of `tensor_transpose_ip` and `tensor_transpose`)
+ *
+ * Matrices are recursively split in half along their longer side until a block fits in L1,
+ * then transposed one SIMD register tile at a time (8x8 with AVX2, 4x4 with SSE)
+ */
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include "../../include/base_defs.h"
+#include "../../include/tensorNew.h"
+
+/**
+ * @brief `out = in^T`
+ *
+ * `out` cannot overlap `in`
+ *
+ * @param out Output matrix (cols x rows)
+ * @param ld_out Row stride of `out` in elements
+ * @param in Input matrix (rows x cols)
+ * @param ld_in Row stride of `in` in elements
+ * @param rows Rows of `in`
+ * @param cols Columns of `in`
+ */
+void transpose_f32(f32* out, u32 ld_out, const f32* in, u32 ld_in, u32 rows, u32 cols);
+
+/**
+ * @brief Transposes an n x n matrix in place
+ *
+ * @param data Matrix data
+ * @param n Rows and columns of the matrix
+ * @param ld Row stride in elements
+ */
+void transpose_f32_square_ip(f32* data, u32 n, u32 ld);
+
+/**
+ * @brief CPU backend of `tensor_transpose_ip`
+ *
+ * Square tensors are transposed in place, rectangular ones through the scratch arena.
+ * `t` must already be validated as 2D. Half tensors are left unchanged with an error
+ */
+void transpose_tensor_ip(tensor* t);
+
+/**
+ * @brief CPU backend of `tensor_transpose`
+ *
+ * `out` must be big enough and cannot overlap `t`. Half tensors are left unchanged with an error
+ */
+void transpose_tensor(tensor* out, const tensor* t);
+
+#endif // TRANSPOSE_H
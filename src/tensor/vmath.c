@@ -0,0 +1,391 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "vmath.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Every instruction set defines the same primitives (`_vm_<isa>_<op>`),
+ * then `_VM_ALL` generates the functions and kernels from them.
+ * The scalar primitives work on single f32s, and the scalar functions finish the tails of the SIMD kernels.
+ *
+ * `sel_lt(a, b, t, f)` is `a < b ? t : f` per lane (false for NaN), same for `sel_eq`.
+ * `ldexp(p, n)` is `p * 2^n` for integral n in [-150, 128], scaling in two steps so denormals and inf come out right.
+ * `ldexp_fast` scales in one step, so n has to be in [-126, 127].
+ * `frexp(x, &e)` returns the mantissa in [0.5, 1) of a positive normal x
+ *
+ * exp, log and tanh are the Cephes single precision algorithms
+ */
+
+#define _VM(isa, op) _vm_##isa##_##op
+
+// exp: x = n ln2 + r, with ln2 split in two so that n ln2 is exact
+#define _VM_LOG2E 1.44269504088896341f
+#define _VM_LN2_HI 0.693359375f
+#define _VM_LN2_LO -2.12194440e-4f
+
+// Accurate exp clamp. Below -104 everything rounds to 0 and above 88.8 everything is inf
+#define _VM_EXP_MIN -104.0f
+#define _VM_EXP_MAX 88.8f
+// Fast exp clamp, keeps n within the normal exponents
+#define _VM_EXP_FAST_MIN -87.33f
+#define _VM_EXP_FAST_MAX 88.37f
+
+#define _VM_SQRTHF 0.707106781186547524f
+#define _VM_TANH_SMALL 0.625f
+
+/*
+ * Scalar primitives
+ */
+
+static inline u32 _vm_f32_bits(f32 x) { u32 b; memcpy(&b, &x, sizeof(b)); return b; }
+static inline f32 _vm_bits_f32(u32 b) { f32 x; memcpy(&x, &b, sizeof(x)); return x; }
+
+static inline f32 _vm_scalar_set1(f32 x) { return x; }
+static inline f32 _vm_scalar_add(f32 a, f32 b) { return a + b; }
+static inline f32 _vm_scalar_sub(f32 a, f32 b) { return a - b; }
+static inline f32 _vm_scalar_mul(f32 a, f32 b) { return a * b; }
+static inline f32 _vm_scalar_div(f32 a, f32 b) { return a / b; }
+static inline f32 _vm_scalar_fmadd(f32 a, f32 b, f32 c) { return a * b + c; }
+static inline f32 _vm_scalar_fnmadd(f32 a, f32 b, f32 c) { return c - a * b; }
+// Same operand order as maxps/minps: NaN in b is returned
+static inline f32 _vm_scalar_max(f32 a, f32 b) { return a > b ? a : b; }
+static inline f32 _vm_scalar_min(f32 a, f32 b) { return a < b ? a : b; }
+static inline f32 _vm_scalar_round(f32 x) { return rintf(x); }
+static inline f32 _vm_scalar_abs(f32 x) { return fabsf(x); }
+static inline f32 _vm_scalar_sel_lt(f32 a, f32 b, f32 t, f32 f) { return a < b ? t : f; }
+static inline f32 _vm_scalar_sel_eq(f32 a, f32 b, f32 t, f32 f) { return a == b ? t : f; }
+static inline f32 _vm_scalar_ldexp(f32 p, f32 n) {
+    // p is already NaN if n is
+    i32 ni = n == n ? (i32)n : 0;
+    i32 h = ni >> 1;
+
+    return p * _vm_bits_f32((u32)(h + 127) << 23) * _vm_bits_f32((u32)(ni - h + 127) << 23);
+}
+static inline f32 _vm_scalar_ldexp_fast(f32 p, f32 n) {
+    i32 ni = n == n ? (i32)n : 0;
+
+    return p * _vm_bits_f32((u32)(ni + 127) << 23);
+}
+static inline f32 _vm_scalar_frexp(f32 x, f32* e) {
+    u32 bits = _vm_f32_bits(x);
+
+    *e = (f32)((i32)((bits >> 23) & 0xff) - 126);
+
+    return _vm_bits_f32((bits & 0x807fffff) | 0x3f000000);
+}
+
+/*
+ * Generic functions and kernels
+ */
+
+#define _VM_FUNCS(isa, attr, vec) \
+    attr static inline vec _vm_exp_##isa(vec x) { \
+        x = _VM(isa, min)(_VM(isa, set1)(_VM_EXP_MAX), _VM(isa, max)(_VM(isa, set1)(_VM_EXP_MIN), x)); \
+        vec n = _VM(isa, round)(_VM(isa, mul)(x, _VM(isa, set1)(_VM_LOG2E))); \
+        vec r = _VM(isa, fnmadd)(n, _VM(isa, set1)(_VM_LN2_HI), x); \
+        r = _VM(isa, fnmadd)(n, _VM(isa, set1)(_VM_LN2_LO), r); \
+        vec z = _VM(isa, mul)(r, r); \
+        vec y = _VM(isa, fmadd)(_VM(isa, set1)(1.9875691500e-4f), r, _VM(isa, set1)(1.3981999507e-3f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(8.3334519073e-3f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(4.1665795894e-2f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(1.6666665459e-1f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(5.0000001201e-1f)); \
+        y = _VM(isa, fmadd)(y, z, r); \
+        y = _VM(isa, add)(y, _VM(isa, set1)(1.0f)); \
+        return _VM(isa, ldexp)(y, n); \
+    } \
+    attr static inline vec _vm_exp_fast_##isa(vec x) { \
+        x = _VM(isa, min)(_VM(isa, set1)(_VM_EXP_FAST_MAX), _VM(isa, max)(_VM(isa, set1)(_VM_EXP_FAST_MIN), x)); \
+        vec n = _VM(isa, round)(_VM(isa, mul)(x, _VM(isa, set1)(_VM_LOG2E))); \
+        vec r = _VM(isa, fnmadd)(n, _VM(isa, set1)(_VM_LN2_HI), x); \
+        r = _VM(isa, fnmadd)(n, _VM(isa, set1)(_VM_LN2_LO), r); \
+        /* Degree 4 minimax polynomial of exp(r) (relative error) */ \
+        vec y = _VM(isa, fmadd)(_VM(isa, set1)(4.1457531e-2f), r, _VM(isa, set1)(1.6790813e-1f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(5.0004364e-1f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(9.9996347e-1f)); \
+        y = _VM(isa, fmadd)(y, r, _VM(isa, set1)(9.9999926e-1f)); \
+        return _VM(isa, ldexp_fast)(y, n); \
+    } \
+    attr static inline vec _vm_log_##isa(vec x) { \
+        vec denormal_scale = _VM(isa, sel_lt)(x, _VM(isa, set1)(FLT_MIN), _VM(isa, set1)(8388608.0f), _VM(isa, set1)(1.0f)); \
+        vec denormal_exp = _VM(isa, sel_lt)(x, _VM(isa, set1)(FLT_MIN), _VM(isa, set1)(23.0f), _VM(isa, set1)(0.0f)); \
+        vec e; \
+        vec m = _VM(isa, frexp)(_VM(isa, mul)(x, denormal_scale), &e); \
+        e = _VM(isa, sub)(e, denormal_exp); \
+        vec t = _VM(isa, sel_lt)(m, _VM(isa, set1)(_VM_SQRTHF), _VM(isa, set1)(1.0f), _VM(isa, set1)(0.0f)); \
+        e = _VM(isa, sub)(e, t); \
+        m = _VM(isa, sub)(_VM(isa, fmadd)(m, t, m), _VM(isa, set1)(1.0f)); \
+        vec z = _VM(isa, mul)(m, m); \
+        vec y = _VM(isa, fmadd)(_VM(isa, set1)(7.0376836292e-2f), m, _VM(isa, set1)(-1.1514610310e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(1.1676998740e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(-1.2420140846e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(1.4249322787e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(-1.6668057665e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(2.0000714765e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(-2.4999993993e-1f)); \
+        y = _VM(isa, fmadd)(y, m, _VM(isa, set1)(3.3333331174e-1f)); \
+        y = _VM(isa, mul)(_VM(isa, mul)(y, m), z); \
+        y = _VM(isa, fmadd)(e, _VM(isa, set1)(_VM_LN2_LO), y); \
+        y = _VM(isa, fnmadd)(_VM(isa, set1)(0.5f), z, y); \
+        vec out = _VM(isa, add)(m, y); \
+        out = _VM(isa, fmadd)(e, _VM(isa, set1)(_VM_LN2_HI), out); \
+        /* x - x is NaN for inf and NaN, then inf, negatives and zero are fixed up */ \
+        out = _VM(isa, add)(out, _VM(isa, sub)(x, x)); \
+        out = _VM(isa, sel_eq)(x, _VM(isa, set1)(INFINITY), _VM(isa, set1)(INFINITY), out); \
+        out = _VM(isa, sel_lt)(x, _VM(isa, set1)(0.0f), _VM(isa, set1)(NAN), out); \
+        out = _VM(isa, sel_eq)(x, _VM(isa, set1)(0.0f), _VM(isa, set1)(-INFINITY), out); \
+        return out; \
+    } \
+    attr static inline vec _vm_tanh_##isa(vec x) { \
+        vec a = _VM(isa, abs)(x); \
+        vec z = _VM(isa, mul)(x, x); \
+        vec small = _VM(isa, fmadd)(_VM(isa, set1)(-5.70498872745e-3f), z, _VM(isa, set1)(2.06390887954e-2f)); \
+        small = _VM(isa, fmadd)(small, z, _VM(isa, set1)(-5.37397155531e-2f)); \
+        small = _VM(isa, fmadd)(small, z, _VM(isa, set1)(1.33314422036e-1f)); \
+        small = _VM(isa, fmadd)(small, z, _VM(isa, set1)(-3.33332819422e-1f)); \
+        small = _VM(isa, fmadd)(_VM(isa, mul)(small, z), x, x); \
+        /* 1 - 2 / (exp(2|x|) + 1), with the sign of x */ \
+        vec large = _vm_exp_##isa(_VM(isa, add)(a, a)); \
+        large = _VM(isa, div)(_VM(isa, set1)(2.0f), _VM(isa, add)(large, _VM(isa, set1)(1.0f))); \
+        large = _VM(isa, sub)(_VM(isa, set1)(1.0f), large); \
+        large = _VM(isa, sel_lt)(x, _VM(isa, set1)(0.0f), _VM(isa, sub)(_VM(isa, set1)(0.0f), large), large); \
+        return _VM(isa, sel_lt)(a, _VM(isa, set1)(_VM_TANH_SMALL), small, large); \
+    } \
+    attr static inline vec _vm_tanh_fast_##isa(vec x) { \
+        vec e = _vm_exp_fast_##isa(_VM(isa, add)(x, x)); \
+        e = _VM(isa, div)(_VM(isa, set1)(2.0f), _VM(isa, add)(e, _VM(isa, set1)(1.0f))); \
+        return _VM(isa, sub)(_VM(isa, set1)(1.0f), e); \
+    } \
+    attr static inline vec _vm_sigmoid_##isa(vec x) { \
+        /* e = exp(-|x|) never overflows, and exp(x) / (1 + exp(x)) keeps the tiny results of negative x */ \
+        vec e = _vm_exp_##isa(_VM(isa, sub)(_VM(isa, set1)(0.0f), _VM(isa, abs)(x))); \
+        vec num = _VM(isa, sel_lt)(x, _VM(isa, set1)(0.0f), e, _VM(isa, set1)(1.0f)); \
+        return _VM(isa, div)(num, _VM(isa, add)(e, _VM(isa, set1)(1.0f))); \
+    } \
+    attr static inline vec _vm_sigmoid_fast_##isa(vec x) { \
+        vec e = _vm_exp_fast_##isa(_VM(isa, sub)(_VM(isa, set1)(0.0f), x)); \
+        return _VM(isa, div)(_VM(isa, set1)(1.0f), _VM(isa, add)(e, _VM(isa, set1)(1.0f))); \
+    }
+
+#define _VM_ARRAY(name, attr, w, load, store, vfunc, sfunc) \
+    attr static void name(f32* out, const f32* in, u64 size) { \
+        u64 i = 0; \
+        for (; i + (w) <= size; i += (w)) { store(out + i, vfunc(load(in + i))); } \
+        for (; i < size; i++) { out[i] = sfunc(in[i]); } \
+    }
+
+#define _VM_ALL(isa, attr, vec, w, load, store) \
+    _VM_FUNCS(isa, attr, vec) \
+    _VM_ARRAY(_vm_exp_array_##isa, attr, w, load, store, _vm_exp_##isa, _vm_exp_scalar) \
+    _VM_ARRAY(_vm_exp_fast_array_##isa, attr, w, load, store, _vm_exp_fast_##isa, _vm_exp_fast_scalar) \
+    _VM_ARRAY(_vm_log_array_##isa, attr, w, load, store, _vm_log_##isa, _vm_log_scalar) \
+    _VM_ARRAY(_vm_tanh_array_##isa, attr, w, load, store, _vm_tanh_##isa, _vm_tanh_scalar) \
+    _VM_ARRAY(_vm_tanh_fast_array_##isa, attr, w, load, store, _vm_tanh_fast_##isa, _vm_tanh_fast_scalar) \
+    _VM_ARRAY(_vm_sigmoid_array_##isa, attr, w, load, store, _vm_sigmoid_##isa, _vm_sigmoid_scalar) \
+    _VM_ARRAY(_vm_sigmoid_fast_array_##isa, attr, w, load, store, _vm_sigmoid_fast_##isa, _vm_sigmoid_fast_scalar) \
+    static const vmath_kernels _vm_kernels_##isa[VMATH_COUNT] = { \
+        [VMATH_ACCURATE] = { \
+            .exp = _vm_exp_array_##isa, \
+            .log = _vm_log_array_##isa, \
+            .tanh = _vm_tanh_array_##isa, \
+            .sigmoid = _vm_sigmoid_array_##isa, \
+        }, \
+        [VMATH_FAST] = { \
+            .exp = _vm_exp_fast_array_##isa, \
+            .log = _vm_log_array_##isa, \
+            .tanh = _vm_tanh_fast_array_##isa, \
+            .sigmoid = _vm_sigmoid_fast_array_##isa, \
+        }, \
+    };
+
+#define _VM_NO_ATTR
+#define _VM_S_LOAD(p) (*(p))
+#define _VM_S_STORE(p, v) (*(p) = (v))
+
+_VM_ALL(scalar, _VM_NO_ATTR, f32, 1, _VM_S_LOAD, _VM_S_STORE)
+
+#if SIMD_X86
+
+/*
+ * SSE primitives
+ */
+
+SIMD_TARGET_SSE static inline __m128 _vm_sse_set1(f32 x) { return _mm_set1_ps(x); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_fmadd(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_fnmadd(__m128 a, __m128 b, __m128 c) {
+    return _mm_sub_ps(c, _mm_mul_ps(a, b));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_max(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_min(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+SIMD_TARGET_SSE static inline __m128 _vm_sse_round(__m128 x) {
+    return _mm_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_abs(__m128 x) {
+    return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_sel_lt(__m128 a, __m128 b, __m128 t, __m128 f) {
+    return _mm_blendv_ps(f, t, _mm_cmplt_ps(a, b));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_sel_eq(__m128 a, __m128 b, __m128 t, __m128 f) {
+    return _mm_blendv_ps(f, t, _mm_cmpeq_ps(a, b));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_pow2(__m128i n) {
+    return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_ldexp(__m128 p, __m128 n) {
+    __m128i ni = _mm_cvtps_epi32(n);
+    __m128i h = _mm_srai_epi32(ni, 1);
+
+    return _mm_mul_ps(_mm_mul_ps(p, _vm_sse_pow2(h)), _vm_sse_pow2(_mm_sub_epi32(ni, h)));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_ldexp_fast(__m128 p, __m128 n) {
+    return _mm_mul_ps(p, _vm_sse_pow2(_mm_cvtps_epi32(n)));
+}
+SIMD_TARGET_SSE static inline __m128 _vm_sse_frexp(__m128 x, __m128* e) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128i exp = _mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff));
+
+    *e = _mm_cvtepi32_ps(_mm_sub_epi32(exp, _mm_set1_epi32(126)));
+
+    bits = _mm_and_si128(bits, _mm_set1_epi32((i32)0x807fffff));
+    return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f000000)));
+}
+
+/*
+ * AVX2 + FMA primitives
+ */
+
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_set1(f32 x) { return _mm256_set1_ps(x); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_fmadd(__m256 a, __m256 b, __m256 c) {
+    return _mm256_fmadd_ps(a, b, c);
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_fnmadd(__m256 a, __m256 b, __m256 c) {
+    return _mm256_fnmadd_ps(a, b, c);
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_min(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_round(__m256 x) {
+    return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_abs(__m256 x) {
+    return _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_sel_lt(__m256 a, __m256 b, __m256 t, __m256 f) {
+    return _mm256_blendv_ps(f, t, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_sel_eq(__m256 a, __m256 b, __m256 t, __m256 f) {
+    return _mm256_blendv_ps(f, t, _mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_pow2(__m256i n) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_ldexp(__m256 p, __m256 n) {
+    __m256i ni = _mm256_cvtps_epi32(n);
+    __m256i h = _mm256_srai_epi32(ni, 1);
+
+    return _mm256_mul_ps(_mm256_mul_ps(p, _vm_avx2_pow2(h)), _vm_avx2_pow2(_mm256_sub_epi32(ni, h)));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_ldexp_fast(__m256 p, __m256 n) {
+    return _mm256_mul_ps(p, _vm_avx2_pow2(_mm256_cvtps_epi32(n)));
+}
+SIMD_TARGET_AVX2 static inline __m256 _vm_avx2_frexp(__m256 x, __m256* e) {
+    __m256i bits = _mm256_castps_si256(x);
+    __m256i exp = _mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff));
+
+    *e = _mm256_cvtepi32_ps(_mm256_sub_epi32(exp, _mm256_set1_epi32(126)));
+
+    bits = _mm256_and_si256(bits, _mm256_set1_epi32((i32)0x807fffff));
+    return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f000000)));
+}
+
+/*
+ * AVX-512 primitives
+ */
+
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_set1(f32 x) { return _mm512_set1_ps(x); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_add(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_sub(__m512 a, __m512 b) { return _mm512_sub_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_mul(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_div(__m512 a, __m512 b) { return _mm512_div_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_fmadd(__m512 a, __m512 b, __m512 c) {
+    return _mm512_fmadd_ps(a, b, c);
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_fnmadd(__m512 a, __m512 b, __m512 c) {
+    return _mm512_fnmadd_ps(a, b, c);
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_max(__m512 a, __m512 b) { return _mm512_max_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_min(__m512 a, __m512 b) { return _mm512_min_ps(a, b); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_round(__m512 x) {
+    return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_abs(__m512 x) { return _mm512_abs_ps(x); }
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_sel_lt(__m512 a, __m512 b, __m512 t, __m512 f) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), f, t);
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_sel_eq(__m512 a, __m512 b, __m512 t, __m512 f) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ), f, t);
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_pow2(__m512i n) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(127)), 23));
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_ldexp(__m512 p, __m512 n) {
+    __m512i ni = _mm512_cvtps_epi32(n);
+    __m512i h = _mm512_srai_epi32(ni, 1);
+
+    return _mm512_mul_ps(_mm512_mul_ps(p, _vm_avx512_pow2(h)), _vm_avx512_pow2(_mm512_sub_epi32(ni, h)));
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_ldexp_fast(__m512 p, __m512 n) {
+    return _mm512_mul_ps(p, _vm_avx512_pow2(_mm512_cvtps_epi32(n)));
+}
+SIMD_TARGET_AVX512 static inline __m512 _vm_avx512_frexp(__m512 x, __m512* e) {
+    __m512i bits = _mm512_castps_si512(x);
+    __m512i exp = _mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff));
+
+    *e = _mm512_cvtepi32_ps(_mm512_sub_epi32(exp, _mm512_set1_epi32(126)));
+
+    bits = _mm512_and_si512(bits, _mm512_set1_epi32((i32)0x807fffff));
+    return _mm512_castsi512_ps(_mm512_or_si512(bits, _mm512_set1_epi32(0x3f000000)));
+}
+
+_VM_ALL(sse, SIMD_TARGET_SSE, __m128, 4, _mm_loadu_ps, _mm_storeu_ps)
+_VM_ALL(avx2, SIMD_TARGET_AVX2, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps)
+_VM_ALL(avx512, SIMD_TARGET_AVX512, __m512, 16, _mm512_loadu_ps, _mm512_storeu_ps)
+
+#endif // SIMD_X86
+
+const vmath_kernels* vmath_kernels_get_level(simd_level level, vmath_tier tier) {
+    level = MIN(level, simd_get_supported_level());
+    tier = MIN(tier, VMATH_FAST);
+
+    switch (level) {
+#if SIMD_X86
+        case SIMD_LEVEL_AVX512: return &_vm_kernels_avx512[tier];
+        case SIMD_LEVEL_AVX2: return &_vm_kernels_avx2[tier];
+        case SIMD_LEVEL_SSE: return &_vm_kernels_sse[tier];
+#endif
+        default: return &_vm_kernels_scalar[tier];
+    }
+}
+
+const vmath_kernels* vmath_kernels_get(vmath_tier tier) {
+    return vmath_kernels_get_level(simd_get_level(), tier);
+}
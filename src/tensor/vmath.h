@@ -0,0 +1,64 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+/**
+ * @file vmath.h
+ * @brief Vectorized exp, log, tanh and sigmoid
+ *
+ * Every function does a range reduction followed by a polynomial,
+ * so a whole vector is computed without calling libm.
+ * The scalar level and the tails of the SIMD kernels use the same algorithm,
+ * so every level returns the same results up to FMA rounding. <br>
+ * `out` may be the same pointer as `in`, but they cannot partially overlap
+ *
+ * Maximum errors of the accurate tier, measured over every f32 input:
+ *  - `exp`: 1.01 ULP. Results below `FLT_MIN` are denormal, above `FLT_MAX` are inf
+ *  - `log`: 0.83 ULP. `log(0)` is -inf, negative inputs are NaN
+ *  - `tanh`: 1.33 ULP
+ *  - `sigmoid`: 2.40 ULP
+ *
+ * The fast tier is meant for inference, where a few extra bits of error do not change the output.
+ * It uses a degree 4 `exp` polynomial, and clamps the input of `exp` to [-87.33, 88.37]
+ * so results never reach denormals or inf:
+ *  - `exp`: 2.8e-6 relative error
+ *  - `tanh`: 1.5e-6 absolute error
+ *  - `sigmoid`: 2.8e-6 relative error
+ *  - `log` is the same as the accurate tier
+ */
+
+#ifndef VMATH_H
+#define VMATH_H
+
+#include "../../include/base_defs.h"
+#include "simd.h"
+
+/// Precision tier of the vmath kernels
+typedef enum {
+    /// Within a couple ULP of the exact result
+    VMATH_ACCURATE = 0,
+    /// Faster, with around 1e-6 error. Only use it for inference
+    VMATH_FAST,
+
+    /// Number of tiers
+    VMATH_COUNT
+} vmath_tier;
+
+/// `out[i] = op(in[i])`
+typedef void (vmath_func)(f32* out, const f32* in, u64 size);
+
+/// Table of vmath kernels for one `simd_level` and `vmath_tier`
+typedef struct {
+    vmath_func* exp;
+    vmath_func* log;
+    vmath_func* tanh;
+    /// `1 / (1 + exp(-x))`
+    vmath_func* sigmoid;
+} vmath_kernels;
+
+/// Returns the kernels of `tier` for the active `simd_level` (see `simd_get_level`)
+const vmath_kernels* vmath_kernels_get(vmath_tier tier);
+/// Returns the kernels of `tier` for a specific `simd_level`, clamped to what the CPU supports
+const vmath_kernels* vmath_kernels_get_level(simd_level level, vmath_tier tier);
+
+#endif // VMATH_H
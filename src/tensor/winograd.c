@@ -0,0 +1,381 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+#include "conv.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "../../include/err.h"
+#include "../mg/mg_arena.h"
+#include "gemm.h"
+#include "overlap.h"
+
+/*
+ * Winograd minimal filtering F(m x m, 3 x 3) (Lavin & Gray)
+ *
+ * For an (m + 2) x (m + 2) input tile d and a 3 x 3 kernel g,
+ * the m x m output tile is Y = A^T [ (G g G^T) .* (B^T d B) ] A
+ *
+ * The elementwise product summed over input channels turns into
+ * (m + 2)^2 independent GEMMs, one per transform coordinate:
+ * M[xi] (out_c x tiles) = U[xi] (out_c x in_c) * V[xi] (in_c x tiles)
+ */
+
+// Upper bound on the transformed input + output block, in f32s (2 MiB)
+#define _WINO_BLOCK_SIZE (1 << 19)
+#define _WINO_MAX_ALPHA 6
+// Offsets each transform coordinate by a cache line,
+// so that the (tile + 2)^2 streams of a tile do not alias in L1
+#define _WINO_COORD_PAD 16
+
+typedef struct {
+    u32 m;
+    u32 alpha;
+
+    // alpha x 3, B^T and A^T are hardcoded in the 1D transforms below
+    const f32* g;
+} _wino_transform;
+
+static const f32 _f2_g[4 * 3] = {
+    1.0f,  0.0f, 0.0f,
+    0.5f,  0.5f, 0.5f,
+    0.5f, -0.5f, 0.5f,
+    0.0f,  0.0f, 1.0f,
+};
+static const f32 _f4_g[6 * 3] = {
+     1.0f / 4.0f,   0.0f,          0.0f,
+    -1.0f / 6.0f,  -1.0f / 6.0f,  -1.0f / 6.0f,
+    -1.0f / 6.0f,   1.0f / 6.0f,  -1.0f / 6.0f,
+     1.0f / 24.0f,  1.0f / 12.0f,  1.0f / 6.0f,
+     1.0f / 24.0f, -1.0f / 12.0f,  1.0f / 6.0f,
+     0.0f,          0.0f,          1.0f,
+};
+
+static b32 _wino_transform_get(_wino_transform* out, u32 tile_size) {
+    switch (tile_size) {
+        case 2: {
+            *out = (_wino_transform){ .m = 2, .alpha = 4, .g = _f2_g };
+        } return true;
+        case 4: {
+            *out = (_wino_transform){ .m = 4, .alpha = 6, .g = _f4_g };
+        } return true;
+        default: break;
+    }
+
+    ERR(ERR_INVALID_INPUT, "Winograd tile_size must be 2 or 4");
+    return false;
+}
+
+// out (r x c) = x (r x n) * y^T (c x n)
+static void _wino_mul_bt(f32* out, const f32* x, const f32* y, u32 r, u32 n, u32 c) {
+    for (u32 i = 0; i < r; i++) {
+        for (u32 j = 0; j < c; j++) {
+            f32 sum = 0.0f;
+            for (u32 l = 0; l < n; l++) {
+                sum += x[i * n + l] * y[j * n + l];
+            }
+            out[i * c + j] = sum;
+        }
+    }
+}
+
+// out (r x c) = x (r x n) * y (n x c)
+static void _wino_mul(f32* out, const f32* x, const f32* y, u32 r, u32 n, u32 c) {
+    for (u32 i = 0; i < r; i++) {
+        for (u32 j = 0; j < c; j++) {
+            f32 sum = 0.0f;
+            for (u32 l = 0; l < n; l++) {
+                sum += x[i * n + l] * y[l * c + j];
+            }
+            out[i * c + j] = sum;
+        }
+    }
+}
+
+// B^T x for F(2x2, 3x3), strided so that it handles rows and columns
+static inline void _wino_f2_input_1d(f32* out, u32 os, const f32* x, u32 xs) {
+    f32 x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs];
+
+    out[0]      = x0 - x2;
+    out[os]     = x1 + x2;
+    out[2 * os] = x2 - x1;
+    out[3 * os] = x1 - x3;
+}
+
+// A^T x for F(2x2, 3x3)
+static inline void _wino_f2_output_1d(f32* out, u32 os, const f32* x, u32 xs) {
+    f32 x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs];
+
+    out[0]  = x0 + x1 + x2;
+    out[os] = x1 - x2 - x3;
+}
+
+// B^T x for F(4x4, 3x3)
+static inline void _wino_f4_input_1d(f32* out, u32 os, const f32* x, u32 xs) {
+    f32 x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs], x4 = x[4 * xs], x5 = x[5 * xs];
+
+    out[0]      = 4.0f * x0 - 5.0f * x2 + x4;
+    out[os]     = (x3 + x4) - 4.0f * (x1 + x2);
+    out[2 * os] = (x4 - x3) + 4.0f * (x1 - x2);
+    out[3 * os] = (x4 - x2) + 2.0f * (x3 - x1);
+    out[4 * os] = (x4 - x2) + 2.0f * (x1 - x3);
+    out[5 * os] = 4.0f * x1 - 5.0f * x3 + x5;
+}
+
+// A^T x for F(4x4, 3x3)
+static inline void _wino_f4_output_1d(f32* out, u32 os, const f32* x, u32 xs) {
+    f32 x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs], x4 = x[4 * xs], x5 = x[5 * xs];
+    f32 p12 = x1 + x2, m12 = x1 - x2;
+    f32 p34 = x3 + x4, m34 = x3 - x4;
+
+    out[0]      = x0 + p12 + p34;
+    out[os]     = m12 + 2.0f * m34;
+    out[2 * os] = p12 + 4.0f * p34;
+    out[3 * os] = m12 + 8.0f * m34 + x5;
+}
+
+// out = B^T d B, both alpha x alpha and row major
+static void _wino_input_tile(const _wino_transform* tr, f32* out, const f32* d) {
+    f32 tmp[_WINO_MAX_ALPHA * _WINO_MAX_ALPHA];
+    u32 a = tr->alpha;
+
+    if (tr->m == 2) {
+        for (u32 i = 0; i < a; i++) { _wino_f2_input_1d(tmp + i, a, d + i, a); }
+        for (u32 i = 0; i < a; i++) { _wino_f2_input_1d(out + i * a, 1, tmp + i * a, 1); }
+    } else {
+        for (u32 i = 0; i < a; i++) { _wino_f4_input_1d(tmp + i, a, d + i, a); }
+        for (u32 i = 0; i < a; i++) { _wino_f4_input_1d(out + i * a, 1, tmp + i * a, 1); }
+    }
+}
+
+// out = A^T m A, where m is alpha x alpha and out is tile x tile
+static void _wino_output_tile(const _wino_transform* tr, f32* out, const f32* m) {
+    f32 tmp[_WINO_MAX_ALPHA * _WINO_MAX_ALPHA];
+    u32 a = tr->alpha;
+
+    if (tr->m == 2) {
+        for (u32 i = 0; i < a; i++) { _wino_f2_output_1d(tmp + i, a, m + i, a); }
+        for (u32 i = 0; i < tr->m; i++) { _wino_f2_output_1d(out + i * tr->m, 1, tmp + i * a, 1); }
+    } else {
+        for (u32 i = 0; i < a; i++) { _wino_f4_output_1d(tmp + i, a, m + i, a); }
+        for (u32 i = 0; i < tr->m; i++) { _wino_f4_output_1d(out + i * tr->m, 1, tmp + i * a, 1); }
+    }
+}
+
+b32 conv_2d_winograd_supported(u32 kernel_size, u32 stride) {
+    return kernel_size == 3 && stride == 1;
+}
+
+b32 conv_2d_winograd_kernels_ip(tensor* out, const tensor* kernels, u32 tile_size) {
+    _wino_transform tr = { 0 };
+    if (!_wino_transform_get(&tr, tile_size)) {
+        return false;
+    }
+
+    if (kernels->shape.width != 9) {
+        ERR(ERR_BAD_SHAPE, "Cannot transform kernels: Winograd needs 3x3 kernels");
+        return false;
+    }
+
+    if (out->dtype != TENSOR_DTYPE_F32 || kernels->dtype != TENSOR_DTYPE_F32) {
+        ERR(ERR_INVALID_INPUT, "Cannot transform kernels: out and kernels must be f32");
+        return false;
+    }
+
+    u32 in_channels = kernels->shape.height;
+    u32 out_channels = kernels->shape.depth;
+    u32 aa = tr.alpha * tr.alpha;
+    u64 channel_pairs = (u64)in_channels * out_channels;
+
+    if (out->alloc < channel_pairs * aa) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot transform kernels: not enough space in out");
+#endif
+        return false;
+    }
+
+    const f32* k_data = (const f32*)kernels->data;
+    f32* u_data = (f32*)out->data;
+
+    f32 tmp[_WINO_MAX_ALPHA * 3];
+    f32 u[_WINO_MAX_ALPHA * _WINO_MAX_ALPHA];
+
+    // Kernel (c, o) is at k_data + (c + o * in_channels) * 9, which is also its index in each U[xi]
+    for (u64 i = 0; i < channel_pairs; i++) {
+        // U = G g G^T
+        _wino_mul(tmp, tr.g, k_data + i * 9, tr.alpha, 3, 3);
+        _wino_mul_bt(u, tmp, tr.g, tr.alpha, 3, tr.alpha);
+
+        for (u32 xi = 0; xi < aa; xi++) {
+            u_data[xi * channel_pairs + i] = u[xi];
+        }
+    }
+
+    out->shape = (tensor_shape){ in_channels, out_channels, aa };
+
+    return true;
+}
+
+b32 conv_2d_winograd_forward_ip(
+    tensor* out, const tensor* input, const tensor* transformed_kernels,
+    u32 tile_size, u32 padding
+) {
+    _wino_transform tr = { 0 };
+    if (!_wino_transform_get(&tr, tile_size)) {
+        return false;
+    }
+
+    u32 in_w = input->shape.width;
+    u32 in_h = input->shape.height;
+    u32 in_c = input->shape.depth;
+    u32 out_c = transformed_kernels->shape.height;
+    u32 aa = tr.alpha * tr.alpha;
+
+    if (transformed_kernels->shape.width != in_c || transformed_kernels->shape.depth != aa) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: transformed kernels do not match input or tile_size");
+        return false;
+    }
+
+    if (
+        out->dtype != TENSOR_DTYPE_F32 || input->dtype != TENSOR_DTYPE_F32 ||
+        transformed_kernels->dtype != TENSOR_DTYPE_F32
+    ) {
+        ERR(ERR_INVALID_INPUT, "Cannot convolve: out, input and transformed kernels must be f32");
+        return false;
+    }
+
+    if (in_w + 2 * padding < 3 || in_h + 2 * padding < 3) {
+        ERR(ERR_BAD_SHAPE, "Cannot convolve: kernel is larger than padded input");
+        return false;
+    }
+
+    u32 out_w = in_w + 2 * padding - 2;
+    u32 out_h = in_h + 2 * padding - 2;
+    u64 out_size = (u64)out_w * out_h * out_c;
+
+    if (out->alloc < out_size) {
+#if TENSOR_IP_ALLOC_ERRORS
+        ERR(ERR_ALLOC_SIZE, "Cannot convolve: not enough space in out");
+#endif
+        return false;
+    }
+
+    u32 tiles_x = (out_w + tr.m - 1) / tr.m;
+    u32 tiles_y = (out_h + tr.m - 1) / tr.m;
+    u32 num_tiles = tiles_x * tiles_y;
+
+    u32 block_tiles = MAX(1, _WINO_BLOCK_SIZE / (aa * (in_c + out_c)));
+    block_tiles = MIN(block_tiles, num_tiles);
+
+    mga_temp scratch = mga_scratch_get(NULL, 0);
+
+    u64 v_stride = (u64)in_c * block_tiles + _WINO_COORD_PAD;
+    u64 m_stride = (u64)out_c * block_tiles + _WINO_COORD_PAD;
+    f32* v = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, aa * v_stride, TENSOR_ALIGN);
+    f32* mm = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, aa * m_stride, TENSOR_ALIGN);
+
+    // Layers convolve in place on `in_out`
+    b32 aliased = tensor_overlaps(out, input);
+    f32* y_data = aliased ? MGA_PUSH_ARRAY(scratch.arena, f32, out_size) : (f32*)out->data;
+
+    const f32* in_data = (const f32*)input->data;
+    const f32* u_data = (const f32*)transformed_kernels->data;
+    u64 plane_size = (u64)in_w * in_h;
+
+    // U[xi] is the same for every block of tiles, so each one is packed once
+    u64 packed_u_size = gemm_packed_a_size(out_c, in_c);
+    f32* packed_u = MGA_PUSH_ARRAY_ALIGNED(scratch.arena, f32, aa * packed_u_size, TENSOR_ALIGN);
+
+    for (u32 xi = 0; xi < aa; xi++) {
+        gemm_pack_a_full(packed_u + xi * packed_u_size, false, out_c, in_c, u_data + (u64)xi * in_c * out_c, in_c);
+    }
+
+    f32 d[_WINO_MAX_ALPHA * _WINO_MAX_ALPHA];
+    f32 t[_WINO_MAX_ALPHA * _WINO_MAX_ALPHA];
+
+    for (u32 t0 = 0; t0 < num_tiles; t0 += block_tiles) {
+        u32 nt = MIN(block_tiles, num_tiles - t0);
+
+        // V[xi] (in_c x nt) = B^T d B for every channel and tile
+        for (u32 c = 0; c < in_c; c++) {
+            const f32* plane = in_data + c * plane_size;
+
+            for (u32 ti = 0; ti < nt; ti++) {
+                u32 tile = t0 + ti;
+                i32 x0 = (i32)((tile % tiles_x) * tr.m) - (i32)padding;
+                i32 y0 = (i32)((tile / tiles_x) * tr.m) - (i32)padding;
+
+                b32 interior = x0 >= 0 && y0 >= 0 &&
+                    x0 + (i32)tr.alpha <= (i32)in_w && y0 + (i32)tr.alpha <= (i32)in_h;
+
+                if (interior) {
+                    const f32* src = plane + (u32)x0 + (u64)(u32)y0 * in_w;
+
+                    for (u32 dy = 0; dy < tr.alpha; dy++) {
+                        memcpy(d + dy * tr.alpha, src + (u64)dy * in_w, sizeof(f32) * tr.alpha);
+                    }
+                } else {
+                    for (u32 dy = 0; dy < tr.alpha; dy++) {
+                        for (u32 dx = 0; dx < tr.alpha; dx++) {
+                            i32 x = x0 + (i32)dx;
+                            i32 y = y0 + (i32)dy;
+
+                            b32 in_bounds = x >= 0 && y >= 0 && x < (i32)in_w && y < (i32)in_h;
+                            d[dy * tr.alpha + dx] = in_bounds ? plane[(u32)x + (u64)(u32)y * in_w] : 0.0f;
+                        }
+                    }
+                }
+
+                _wino_input_tile(&tr, t, d);
+
+                for (u32 xi = 0; xi < aa; xi++) {
+                    v[xi * v_stride + (u64)c * nt + ti] = t[xi];
+                }
+            }
+        }
+
+        for (u32 xi = 0; xi < aa; xi++) {
+            gemm_f32_packed_a(
+                out_c, nt, in_c, packed_u + xi * packed_u_size,
+                false, v + xi * v_stride, nt,
+                mm + xi * m_stride, nt,
+                false
+            );
+        }
+
+        // Y = A^T M A, clipped to the output
+        for (u32 o = 0; o < out_c; o++) {
+            f32* out_plane = y_data + (u64)o * out_w * out_h;
+
+            for (u32 ti = 0; ti < nt; ti++) {
+                u32 tile = t0 + ti;
+                u32 ox0 = (tile % tiles_x) * tr.m;
+                u32 oy0 = (tile / tiles_x) * tr.m;
+
+                for (u32 xi = 0; xi < aa; xi++) {
+                    d[xi] = mm[xi * m_stride + (u64)o * nt + ti];
+                }
+
+                _wino_output_tile(&tr, t, d);
+
+                for (u32 iy = 0; iy < tr.m && oy0 + iy < out_h; iy++) {
+                    for (u32 ix = 0; ix < tr.m && ox0 + ix < out_w; ix++) {
+                        out_plane[(ox0 + ix) + (u64)(oy0 + iy) * out_w] = t[iy * tr.m + ix];
+                    }
+                }
+            }
+        }
+    }
+
+    if (aliased) {
+        memcpy(out->data, y_data, sizeof(f32) * out_size);
+    }
+
+    mga_scratch_release(scratch);
+
+    out->shape = (tensor_shape){ out_w, out_h, out_c };
+
+    return true;
+}
@@ -0,0 +1,183 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+// Measures the blocked GEMM against a plain triple loop in GFLOP/s.
+// The loop uses i-k-j order, so the inner loop is contiguous and the compiler
+// can vectorize it, which makes it a fair baseline without any blocking.
+// Checks the result against the loop first (every transpose combination on the smaller shapes),
+// so it can also run as a test
+//
+// Usage: bench_gemm [reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mlframework/mg_arena.h>
+#include <mlframework/os.h>
+
+// Internal backend, found through the private include directory of the target
+#include "gemm.h"
+
+typedef struct {
+    u32 m;
+    u32 n;
+    u32 k;
+} _bench_shape;
+
+static const _bench_shape _bench_shapes[] = {
+    // Dense layers of the mnist example with a batch of 64
+    { 64, 128, 784 },
+    { 64, 10, 128 },
+    // Sizes that are not multiples of the micro-kernel
+    { 100, 100, 100 },
+    { 257, 129, 301 },
+    { 256, 256, 256 },
+    { 512, 512, 512 },
+    { 1024, 1024, 1024 },
+};
+
+// Larger shapes only check the untransposed product, the strided loops of the others are slow
+#define _CHECK_TRANSPOSES_MAX_WORK (1 << 24)
+
+// Element (r, c) of op(X), where X is stored with a row stride of ld
+#define _OP_AT(x, transpose, r, c, ld) ((transpose) ? (x)[(r) + (u64)(c) * (ld)] : (x)[(c) + (u64)(r) * (ld)])
+
+// C = op(A) * op(B) without any blocking or packing
+static void _gemm_naive(
+    b32 transpose_a, b32 transpose_b,
+    u32 m, u32 n, u32 k,
+    const f32* a, u32 lda,
+    const f32* b, u32 ldb,
+    f32* c
+) {
+    memset(c, 0, sizeof(f32) * m * n);
+
+    for (u32 i = 0; i < m; i++) {
+        f32* c_row = c + (u64)i * n;
+
+        for (u32 p = 0; p < k; p++) {
+            f32 a_ip = _OP_AT(a, transpose_a, i, p, lda);
+
+            if (transpose_b) {
+                for (u32 j = 0; j < n; j++) {
+                    c_row[j] += a_ip * b[p + (u64)j * ldb];
+                }
+            } else {
+                const f32* b_row = b + (u64)p * ldb;
+
+                for (u32 j = 0; j < n; j++) {
+                    c_row[j] += a_ip * b_row[j];
+                }
+            }
+        }
+    }
+}
+
+// Both add the same products in a different order, so the error grows with k
+static b32 _check_gemm(const f32* out, const f32* expected, u64 size, u32 k) {
+    f32 tolerance = 1e-5f * (f32)k;
+
+    for (u64 i = 0; i < size; i++) {
+        if (fabsf(out[i] - expected[i]) > tolerance * MAX(1.0f, fabsf(expected[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static f64 _gflops(const _bench_shape* shape, u64 usec) {
+    return 2.0 * shape->m * shape->n * shape->k / (f64)MAX(usec, 1) * 1e-3;
+}
+
+static void _fill(f32* data, u64 size, u32 seed) {
+    for (u64 i = 0; i < size; i++) {
+        data[i] = (f32)((i * 7 + seed) % 17) / 8.0f - 1.0f;
+    }
+}
+
+int main(int argc, char** argv) {
+    u32 reps = argc > 1 ? (u32)atoi(argv[1]) : 5;
+    reps = MAX(reps, 1);
+
+    time_init();
+
+    mga_desc desc = { .desired_max_size = MGA_MiB(256), .desired_block_size = MGA_MiB(4) };
+    mg_arena* arena = mga_create(&desc);
+
+    b32 passed = true;
+    u32 num_shapes = sizeof(_bench_shapes) / sizeof(_bench_shapes[0]);
+
+    printf("%-16s %12s %12s %8s\n", "m x n x k", "naive GF/s", "blocked", "speedup");
+
+    for (u32 i = 0; i < num_shapes; i++) {
+        mga_temp temp = mga_temp_begin(arena);
+
+        const _bench_shape* shape = &_bench_shapes[i];
+        u32 m = shape->m;
+        u32 n = shape->n;
+        u32 k = shape->k;
+
+        f32* a = MGA_PUSH_ARRAY(arena, f32, (u64)m * k);
+        f32* b = MGA_PUSH_ARRAY(arena, f32, (u64)k * n);
+        f32* expected = MGA_PUSH_ARRAY(arena, f32, (u64)m * n);
+        f32* out = MGA_PUSH_ARRAY(arena, f32, (u64)m * n);
+
+        _fill(a, (u64)m * k, 1);
+        _fill(b, (u64)k * n, 5);
+
+        // The same data read as op(A) and op(B), so each combination has the same shape
+        u32 num_checks = (u64)m * n * k <= _CHECK_TRANSPOSES_MAX_WORK ? 4 : 1;
+
+        for (u32 t = 0; t < num_checks; t++) {
+            b32 transpose_a = (t & 1) != 0;
+            b32 transpose_b = (t & 2) != 0;
+
+            u32 lda = transpose_a ? m : k;
+            u32 ldb = transpose_b ? k : n;
+
+            _gemm_naive(transpose_a, transpose_b, m, n, k, a, lda, b, ldb, expected);
+            gemm_f32(transpose_a, transpose_b, m, n, k, a, lda, b, ldb, out, n, false);
+
+            if (!_check_gemm(out, expected, (u64)m * n, k)) {
+                printf("FAIL %ux%ux%u: gemm_f32 is wrong (transpose_a %u, transpose_b %u)\n",
+                    m, n, k, transpose_a, transpose_b);
+                passed = false;
+            }
+        }
+
+        u64 best_naive = UINT64_MAX;
+        u64 best_blocked = UINT64_MAX;
+
+        for (u32 r = 0; r < reps; r++) {
+            u64 start = now_usec();
+            _gemm_naive(false, false, m, n, k, a, k, b, n, expected);
+            u64 naive_end = now_usec();
+            gemm_f32(false, false, m, n, k, a, k, b, n, out, n, false);
+            u64 blocked_end = now_usec();
+
+            best_naive = MIN(best_naive, naive_end - start);
+            best_blocked = MIN(best_blocked, blocked_end - naive_end);
+        }
+
+        char shape_str[32];
+        snprintf(shape_str, sizeof(shape_str), "%ux%ux%u", m, n, k);
+
+        printf(
+            "%-16s %12.2f %12.2f %7.1fx\n", shape_str,
+            _gflops(shape, best_naive),
+            _gflops(shape, best_blocked),
+            (f64)MAX(best_naive, 1) / (f64)MAX(best_blocked, 1)
+        );
+
+        mga_temp_end(temp);
+    }
+
+    mga_destroy(arena);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+// Measures the blocked transpose against memcpy of the same bytes, which is the
+// bandwidth bound it should approach. Checks the out of place and in place results first,
+// so it can also run as a test
+//
+// Usage: bench_transpose [reps]
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mlframework/mg_arena.h>
+#include <mlframework/os.h>
+#include <mlframework/tensorNew.h>
+
+// Internal backend, found through the private include directory of the target
+#include "transpose.h"
+
+typedef struct {
+    u32 rows;
+    u32 cols;
+} _bench_shape;
+
+static const _bench_shape _bench_shapes[] = {
+    { 784, 128 },
+    { 128, 784 },
+    { 1024, 1024 },
+    { 1000, 1000 },
+    { 3000, 1000 },
+    { 4096, 4096 },
+};
+
+// Reads and writes every element once
+static f64 _gb_per_sec(u64 num_elems, u64 usec) {
+    return (f64)(2 * sizeof(f32) * num_elems) / (f64)MAX(usec, 1) * 1e-3;
+}
+
+static b32 _check_transpose(const f32* out, const f32* in, u32 rows, u32 cols) {
+    for (u32 y = 0; y < rows; y++) {
+        for (u32 x = 0; x < cols; x++) {
+            if (out[(u64)x * rows + y] != in[(u64)y * cols + x]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Resets `work` to a copy of `in`, since every in place transpose changes it
+static void _reset_copy(tensor* work, const tensor* in, u64 size) {
+    memcpy(work->data, in->data, sizeof(f32) * size);
+    work->shape = in->shape;
+}
+
+int main(int argc, char** argv) {
+    u32 reps = argc > 1 ? (u32)atoi(argv[1]) : 10;
+    reps = MAX(reps, 1);
+
+    time_init();
+
+    mga_desc desc = { .desired_max_size = MGA_MiB(512), .desired_block_size = MGA_MiB(4) };
+    mg_arena* arena = mga_create(&desc);
+
+    b32 passed = true;
+    u32 num_shapes = sizeof(_bench_shapes) / sizeof(_bench_shapes[0]);
+
+    printf("%-12s %12s %12s %12s\n", "shape", "memcpy GB/s", "blocked", "in place");
+
+    for (u32 i = 0; i < num_shapes; i++) {
+        mga_temp temp = mga_temp_begin(arena);
+
+        u32 rows = _bench_shapes[i].rows;
+        u32 cols = _bench_shapes[i].cols;
+        u64 size = (u64)rows * cols;
+
+        tensor* in = tensor_create(arena, (tensor_shape){ cols, rows, 1 });
+        tensor* out = tensor_create(arena, (tensor_shape){ rows, cols, 1 });
+        tensor* work = tensor_create(arena, (tensor_shape){ cols, rows, 1 });
+        f32* in_data = (f32*)in->data;
+
+        for (u64 j = 0; j < size; j++) {
+            in_data[j] = (f32)j;
+        }
+
+        transpose_tensor(out, in);
+
+        if (!_check_transpose((const f32*)out->data, in_data, rows, cols)) {
+            printf("FAIL %ux%u: transpose_tensor is wrong\n", rows, cols);
+            passed = false;
+        }
+
+        // Square shapes stay in place, others go through the scratch arena
+        _reset_copy(work, in, size);
+        transpose_tensor_ip(work);
+
+        if (
+            work->shape.width != rows || work->shape.height != cols ||
+            !_check_transpose((const f32*)work->data, in_data, rows, cols)
+        ) {
+            printf("FAIL %ux%u: transpose_tensor_ip is wrong\n", rows, cols);
+            passed = false;
+        }
+
+        u64 best_memcpy = UINT64_MAX;
+        u64 best_blocked = UINT64_MAX;
+        u64 best_ip = UINT64_MAX;
+
+        for (u32 r = 0; r < reps; r++) {
+            _reset_copy(work, in, size);
+
+            u64 start = now_usec();
+            memcpy(out->data, in->data, sizeof(f32) * size);
+            u64 memcpy_end = now_usec();
+            transpose_f32((f32*)out->data, rows, in_data, cols, rows, cols);
+            u64 blocked_end = now_usec();
+            transpose_tensor_ip(work);
+            u64 ip_end = now_usec();
+
+            best_memcpy = MIN(best_memcpy, memcpy_end - start);
+            best_blocked = MIN(best_blocked, blocked_end - memcpy_end);
+            best_ip = MIN(best_ip, ip_end - blocked_end);
+        }
+
+        char shape_str[32];
+        snprintf(shape_str, sizeof(shape_str), "%ux%u", rows, cols);
+
+        printf(
+            "%-12s %12.1f %12.1f %12.1f\n", shape_str,
+            _gb_per_sec(size, best_memcpy),
+            _gb_per_sec(size, best_blocked),
+            _gb_per_sec(size, best_ip)
+        );
+
+        mga_temp_end(temp);
+    }
+
+    mga_destroy(arena);
+
+    return passed ? 0 : 1;
+}
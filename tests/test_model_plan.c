@@ -0,0 +1,185 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+// Checks the activation planner of model_compile: matrices with overlapping
+// lifetimes get disjoint ranges, disjoint lifetimes share memory, OUTPUT and
+// COST are not overwritten by the backward pass, vars in no program still get
+// storage, and the planned forward pass matches the same math done by hand
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "memory_mngmnt/arena.h"
+#include "model/program/modelPlan.h"
+#include "model/program/modelProgram.h"
+#include "model/train/train.h"
+
+// A multiple of MODEL_PLAN_ALIGN, so that naive_size and size count the same floats
+#define _INPUT_SIZE 32
+
+static u32 _num_failed = 0;
+
+static void _check(b32 passed, const char* name) {
+    printf("%s %s\n", passed ? "ok  " : "FAIL", name);
+
+    if (!passed) {
+        _num_failed++;
+    }
+}
+
+static const model_plan_binding* _find_binding(const model_plan* plan, const matrix* mat) {
+    for (u32 i = 0; i < plan->num_bindings; i++) {
+        if (plan->bindings[i].mat == mat) {
+            return &plan->bindings[i];
+        }
+    }
+
+    return NULL;
+}
+
+static u64 _binding_size(const model_plan_binding* binding) {
+    return ALIGN_UP_POW2((u64)binding->mat->rows * binding->mat->cols, MODEL_PLAN_ALIGN);
+}
+
+// True if both matrices are planned and their ranges of the buffer do not overlap
+static b32 _disjoint(const model_plan* plan, const matrix* a, const matrix* b) {
+    const model_plan_binding* ba = _find_binding(plan, a);
+    const model_plan_binding* bb = _find_binding(plan, b);
+
+    if (ba == NULL || bb == NULL) {
+        return false;
+    }
+
+    return ba->offset + _binding_size(ba) <= bb->offset || bb->offset + _binding_size(bb) <= ba->offset;
+}
+
+// True if `mat` overlaps no grad of the program, which it must not when it is read after the backward pass
+static b32 _disjoint_from_grads(const model_plan* plan, const matrix* mat, model_var** vars, u32 num_vars) {
+    for (u32 i = 0; i < num_vars; i++) {
+        if (vars[i]->grad != NULL && _find_binding(plan, vars[i]->grad) != NULL &&
+            !_disjoint(plan, mat, vars[i]->grad)) {
+            return false;
+        }
+    }
+
+    return _find_binding(plan, mat) != NULL;
+}
+
+int main(void) {
+    mem_arena* arena = arena_create(MiB(16), KiB(64));
+    model_context* model = model_create(arena);
+
+    model_var* input = mv_create(arena, model, _INPUT_SIZE, 1, MV_FLAG_INPUT);
+    model_var* bias = mv_create(arena, model, _INPUT_SIZE, 1, MV_FLAG_PARAMETER | MV_FLAG_REQUIRES_GRAD);
+
+    // A chain, each link is dead once the next one is computed
+    model_var* a = mv_add(arena, model, input, bias, MV_FLAG_NONE);
+    model_var* b = mv_relu(arena, model, a, MV_FLAG_NONE);
+    model_var* c = mv_relu(arena, model, b, MV_FLAG_NONE);
+    model_var* d = mv_relu(arena, model, c, MV_FLAG_NONE);
+
+    // b and d are both read by the add, c is read by the sub after it
+    model_var* e = mv_add(arena, model, b, d, MV_FLAG_NONE);
+    model_var* f = mv_sub(arena, model, e, c, MV_FLAG_NONE);
+    model_var* output = mv_softmax(arena, model, f, MV_FLAG_OUTPUT);
+
+    model_var* desired = mv_create(arena, model, _INPUT_SIZE, 1, MV_FLAG_DESIRED_OUTPUT);
+    model_var* cost = mv_cross_entropy(arena, model, desired, output, MV_FLAG_COST);
+
+    // Not an input of anything, so neither program computes it
+    model_var* unused = mv_relu(arena, model, input, MV_FLAG_NONE);
+
+    model_compile(arena, model);
+
+    const model_plan* forward = &model->forward_prog.plan;
+    const model_plan* cost_plan = &model->cost_prog.plan;
+
+    _check(forward->size < forward->naive_size, "forward: disjoint lifetimes share memory");
+    _check(
+        _disjoint(forward, b->val, d->val) && _disjoint(forward, b->val, e->val) &&
+        _disjoint(forward, d->val, e->val),
+        "forward: inputs and output of one step do not overlap"
+    );
+    _check(_disjoint(forward, c->val, e->val), "forward: a val read later does not overlap one computed before");
+
+    model_var** cost_vars = model->cost_prog.vars;
+    u32 num_cost_vars = model->cost_prog.size;
+
+    _check(_disjoint_from_grads(cost_plan, output->val, cost_vars, num_cost_vars), "cost: OUTPUT is not reused by a grad");
+    _check(_disjoint_from_grads(cost_plan, cost->val, cost_vars, num_cost_vars), "cost: COST is not reused by a grad");
+    _check(
+        _disjoint(cost_plan, b->val, b->grad) && _disjoint(cost_plan, a->val, b->grad),
+        "cost: a grad does not overlap the vals its backward step reads"
+    );
+
+    _check(
+        unused->val->data != NULL && _find_binding(forward, unused->val) == NULL &&
+        _find_binding(cost_plan, unused->val) == NULL,
+        "var in no program gets its own storage"
+    );
+
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        input->val->data[i] = (f32)i - 3.5f;
+        bias->val->data[i] = 0.25f * (f32)(i % 3);
+    }
+
+    model_feedforward(model);
+
+    // Same math without the planner
+    f32 expected[_INPUT_SIZE];
+    f32 max_f = -1e30f;
+
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        f32 av = input->val->data[i] + bias->val->data[i];
+        f32 bv = MAX(0, av);
+
+        expected[i] = (bv + bv) - bv;
+        max_f = MAX(max_f, expected[i]);
+    }
+
+    f32 sum = 0.0f;
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        expected[i] = expf(expected[i] - max_f);
+        sum += expected[i];
+    }
+
+    b32 matches = true;
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        f32 diff = output->val->data[i] - expected[i] / sum;
+        matches &= diff < 1e-6f && diff > -1e-6f;
+    }
+
+    _check(matches, "planned forward pass matches the reference");
+
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        desired->val->data[i] = i == 3 ? 1.0f : 0.0f;
+    }
+
+    model_prog_compute(&model->cost_prog);
+
+    f32 output_before[_INPUT_SIZE];
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        output_before[i] = output->val->data[i];
+    }
+    f32 cost_before = cost->val->data[0];
+
+    model_prog_compute_grads(&model->cost_prog);
+
+    b32 kept = cost->val->data[0] == cost_before;
+    for (u32 i = 0; i < _INPUT_SIZE; i++) {
+        kept &= output->val->data[i] == output_before[i];
+    }
+
+    _check(kept, "cost: OUTPUT and COST survive the backward pass");
+
+    arena_destroy(arena);
+
+    if (_num_failed != 0) {
+        printf("%u plan checks failed\n", _num_failed);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+//
+// Created by Vishal Jha on 16/10/26.
+//
+
+// Checks conv_2d_winograd_forward_ip against conv_2d_forward_ip
+// on odd sizes, both paddings and both tile sizes
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <mlframework/mg_arena.h>
+#include <mlframework/tensorNew.h>
+
+// Internal backend, found through the private include directory of the target
+#include "conv.h"
+
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 in_channels;
+    u32 out_channels;
+} _wino_test_case;
+
+static const _wino_test_case _test_cases[] = {
+    { 3, 3, 1, 1 },
+    { 5, 5, 1, 2 },
+    { 7, 9, 3, 4 },
+    { 11, 13, 8, 5 },
+    { 17, 15, 16, 16 },
+    { 31, 29, 7, 9 },
+};
+
+static u32 _rand_state = 1;
+
+// Deterministic values in [-0.5, 0.5)
+static f32 _rand_f32(void) {
+    _rand_state = _rand_state * 1664525u + 1013904223u;
+    return (f32)(_rand_state >> 8) / (f32)(1u << 24) - 0.5f;
+}
+
+static void _fill_random(tensor* t) {
+    u64 size = (u64)t->shape.width * t->shape.height * t->shape.depth;
+    f32* data = (f32*)t->data;
+
+    for (u64 i = 0; i < size; i++) {
+        data[i] = _rand_f32();
+    }
+}
+
+// Returns true if the Winograd output matches the reference within tolerance
+static b32 _test_case(mg_arena* arena, const _wino_test_case* tc, u32 padding, u32 tile_size) {
+    mga_temp temp = mga_temp_begin(arena);
+
+    u32 out_w = tc->width + 2 * padding - 2;
+    u32 out_h = tc->height + 2 * padding - 2;
+    u32 aa = (tile_size + 2) * (tile_size + 2);
+
+    tensor* input = tensor_create(arena, (tensor_shape){ tc->width, tc->height, tc->in_channels });
+    tensor* kernels = tensor_create(arena, (tensor_shape){ 9, tc->in_channels, tc->out_channels });
+    tensor* transformed = tensor_create(arena, (tensor_shape){ tc->in_channels, tc->out_channels, aa });
+    tensor* ref = tensor_create(arena, (tensor_shape){ out_w, out_h, tc->out_channels });
+    tensor* out = tensor_create(arena, (tensor_shape){ out_w, out_h, tc->out_channels });
+
+    _fill_random(input);
+    _fill_random(kernels);
+
+    b32 ok =
+        conv_2d_forward_ip(ref, input, kernels, 3, 1, padding) &&
+        conv_2d_winograd_kernels_ip(transformed, kernels, tile_size) &&
+        conv_2d_winograd_forward_ip(out, input, transformed, tile_size, padding);
+
+    if (!ok) {
+        printf(
+            "FAIL %ux%ux%u -> %u, padding %u, F(%u, 3): convolution returned false\n",
+            tc->width, tc->height, tc->in_channels, tc->out_channels, padding, tile_size
+        );
+
+        mga_temp_end(temp);
+        return false;
+    }
+
+    u64 size = (u64)out_w * out_h * tc->out_channels;
+    const f32* ref_data = (const f32*)ref->data;
+    const f32* out_data = (const f32*)out->data;
+
+    f32 max_ref = 0.0f;
+    f32 max_err = 0.0f;
+
+    for (u64 i = 0; i < size; i++) {
+        max_ref = fmaxf(max_ref, fabsf(ref_data[i]));
+        max_err = fmaxf(max_err, fabsf(out_data[i] - ref_data[i]));
+    }
+
+    // F(4x4, 3x3) has larger transform constants, so it loses more precision
+    f32 tolerance = (tile_size == 2 ? 1e-6f : 1e-5f) * fmaxf(max_ref, 1.0f) * (f32)tc->in_channels;
+
+    b32 passed =
+        out->shape.width == out_w && out->shape.height == out_h &&
+        out->shape.depth == tc->out_channels && max_err <= tolerance;
+
+    printf(
+        "%s %ux%ux%u -> %u, padding %u, F(%u, 3): max error %g (tolerance %g)\n",
+        passed ? "ok  " : "FAIL", tc->width, tc->height, tc->in_channels, tc->out_channels,
+        padding, tile_size, max_err, tolerance
+    );
+
+    mga_temp_end(temp);
+
+    return passed;
+}
+
+int main(void) {
+    mga_desc desc = { .desired_max_size = MGA_MiB(256), .desired_block_size = MGA_MiB(4) };
+    mg_arena* arena = mga_create(&desc);
+
+    u32 num_failed = 0;
+    u32 num_cases = sizeof(_test_cases) / sizeof(_test_cases[0]);
+
+    for (u32 i = 0; i < num_cases; i++) {
+        for (u32 padding = 0; padding <= 1; padding++) {
+            for (u32 tile_size = 2; tile_size <= 4; tile_size += 2) {
+                if (!_test_case(arena, &_test_cases[i], padding, tile_size)) {
+                    num_failed++;
+                }
+            }
+        }
+    }
+
+    mga_destroy(arena);
+
+    if (num_failed != 0) {
+        printf("%u Winograd cases failed\n", num_failed);
+        return 1;
+    }
+
+    return 0;
+}